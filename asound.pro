@@ -5,6 +5,7 @@
 #-------------------------------------------------
 
 QT       -= gui
+QT       += concurrent
 
 CONFIG(debug, debug|release){
     TARGET = asound_d
@@ -0,0 +1,184 @@
+//-----------------------------------------------------------------------------
+//
+//      Банк звуков - единый файл с индексом и PCM данными
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Банк звуков - единый файл с индексом и PCM данными
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ *
+ *  Формат файла банка (little-endian):
+ *  - заголовок asound_bank_header_t;
+ *  - таблица записей asound_bank_entry_t;
+ *  - таблица меток asound_bank_label_t;
+ *  - таблица имён (UTF-8, без завершающих нулей);
+ *  - PCM данные звуков, каждый выровнен на ASOUND_BANK_ALIGN байт.
+ */
+
+#ifndef ASOUND_BANK_H
+#define ASOUND_BANK_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QSharedPointer>
+
+#include "asound-global.h"
+#include "asound-wave.h"
+
+/// Сигнатура файла банка
+#define ASOUND_BANK_MAGIC "ASBK"
+/// Версия формата банка
+const uint32_t ASOUND_BANK_VERSION = 2;
+/// Выравнивание PCM данных в банке
+const uint64_t ASOUND_BANK_ALIGN = 16;
+/// Суффикс имени упрощённого варианта звука в банке (далее - номер уровня)
+#define ASOUND_BANK_LOD_SUFFIX "@lod"
+
+#pragma pack(push, 1)
+/*!
+ * \struct asound_bank_header_t
+ * \brief Заголовок файла банка
+ */
+struct asound_bank_header_t
+{
+    char            magic[4];       ///< Сигнатура "ASBK"
+    uint32_t        version;        ///< Версия формата
+    uint32_t        entriesCount;   ///< Количество звуков
+    uint32_t        labelsCount;    ///< Общее количество меток
+    uint64_t        stringsOffset;  ///< Смещение таблицы имён
+    uint64_t        stringsSize;    ///< Размер таблицы имён
+// Конструктор
+    asound_bank_header_t()
+    {
+        memcpy(magic, ASOUND_BANK_MAGIC, 4);
+        version = ASOUND_BANK_VERSION;
+        entriesCount = 0;
+        labelsCount = 0;
+        stringsOffset = 0;
+        stringsSize = 0;
+    }
+};
+
+/*!
+ * \struct asound_bank_entry_t
+ * \brief Запись индекса банка: формат и разбиение звука на блоки
+ */
+struct asound_bank_entry_t
+{
+    uint32_t        nameOffset;     ///< Смещение имени в таблице имён
+    uint32_t        nameSize;       ///< Длина имени, байт
+    wave_info_fmt_t info;           ///< Формат данных
+    uint64_t        dataOffset;     ///< Смещение PCM данных от начала файла
+    uint64_t        dataSize;       ///< Размер PCM данных
+    uint64_t        blockSize[BUFFER_BLOCKS]; ///< Размеры блоков (старт, цикл, остановка)
+    uint32_t        blocksCount;    ///< Количество блоков
+    uint32_t        firstLabel;     ///< Индекс первой метки в таблице меток
+    uint32_t        labelsCount;    ///< Количество меток звука
+    sound_analysis_t analysis;      ///< Результаты анализа PCM данных
+// Конструктор
+    asound_bank_entry_t()
+    {
+        nameOffset = 0;
+        nameSize = 0;
+        dataOffset = 0;
+        dataSize = 0;
+        for (int i = 0; i < BUFFER_BLOCKS; ++i)
+            blockSize[i] = 0;
+        blocksCount = 0;
+        firstLabel = 0;
+        labelsCount = 0;
+    }
+};
+
+/*!
+ * \struct asound_bank_label_t
+ * \brief Метка звука в банке
+ */
+struct asound_bank_label_t
+{
+    uint32_t        nameOffset;     ///< Смещение имени в таблице имён
+    uint32_t        nameSize;       ///< Длина имени, байт
+    uint64_t        offset;         ///< Смещение метки в данных звука, байт
+// Конструктор
+    asound_bank_label_t()
+    {
+        nameOffset = 0;
+        nameSize = 0;
+        offset = 0;
+    }
+};
+#pragma pack(pop)
+
+class ASoundBankStorage;
+
+/*!
+ * \class ASoundBank
+ * \brief Банк звуков. Файл отображается в память целиком, звуки банка
+ * ссылаются на отображение без копирования PCM данных
+ */
+class ASOUNDSHARED_EXPORT ASoundBank
+{
+public:
+    /*!
+     * \brief Конструктор - открывает и отображает в память файл банка
+     * \param bankname - имя файла банка
+     */
+    explicit ASoundBank(const QString &bankname);
+    /// Деструктор
+    ~ASoundBank();
+
+    /// Открыт ли банк
+    bool isOpen() const;
+
+    /// Вернуть последнюю ошибку
+    QString getLastError() const;
+
+    /// Вернуть имена всех звуков банка
+    QStringList getNames() const;
+
+    /// Есть ли звук в банке
+    bool contains(const QString &soundname) const;
+
+    /*!
+     * \brief Вернуть данные звука. Блоки указывают в отображение файла,
+     * которое живёт, пока на него ссылается хотя бы один звук
+     * \param soundname - имя звука в банке
+     * \return данные звука или пустой указатель, если звука нет
+     */
+    QSharedPointer<ASoundData> getSound(const QString &soundname) const;
+
+    /*!
+     * \brief Собрать банк из WAVE файлов. Файлы читаются дважды: сначала
+     * разметка для индекса, затем PCM данные по одному звуку за раз
+     * \param bankname - имя создаваемого файла банка
+     * \param baseDir - каталог, относительно которого формируются имена звуков
+     * \param files - список WAVE файлов
+     * \param error - текст ошибки
+     * \param lodLevels - сколько упрощённых вариантов добавить к каждому
+     * звуку (записываются под именем звука с суффиксом "@lod<уровень>")
+     * \return успешность записи
+     */
+    static bool write(const QString &bankname, const QString &baseDir,
+                      const QStringList &files, QString &error, int lodLevels = 0);
+
+private:
+    Q_DISABLE_COPY(ASoundBank)
+
+    /// Отображение файла банка
+    QSharedPointer<ASoundBankStorage> storage_;
+
+    /// Индекс звуков (имя, номер записи)
+    QMap<QString, int> index_;
+
+    /// Последняя ошибка
+    QString lastError_;
+
+    /// Проверка и разбор индекса банка
+    bool readIndex_();
+};
+
+#endif // ASOUND_BANK_H
@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------------
+//
+//      Кэш разобранных метаданных WAVE файлов
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Кэш разобранных метаданных WAVE файлов
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_CACHE_H
+#define ASOUND_CACHE_H
+
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+#include "asound-global.h"
+#include "asound-wave.h"
+
+/*!
+ * \class ASoundMetaCache
+ * \brief Дисковый кэш метаданных (формат, смещение секции data, разбиение
+ * на блоки, метки). Запись действительна, пока у файла не изменились
+ * размер и время модификации. Пока файл кэша не задан, кэш отключён
+ */
+class ASOUNDSHARED_EXPORT ASoundMetaCache
+{
+public:
+    /// Статический метод запрещающий повторное создание экземпляра класса
+    static ASoundMetaCache &getInstance();
+
+    /*!
+     * \brief Включить кэш и загрузить его из файла (если файл есть)
+     * \param filename - имя файла кэша
+     * \return успешность загрузки (отсутствующий файл - не ошибка)
+     */
+    bool open(const QString &filename);
+
+    /// Сохранить кэш в файл, если были изменения
+    bool save();
+
+    /// Включён ли кэш
+    bool isEnabled();
+
+    /*!
+     * \brief Найти метаданные файла
+     * \param soundname - имя аудиофайла
+     * \param data - куда записать метаданные (блоки не заполняются)
+     * \return найдена ли действительная запись
+     */
+    bool lookup(const QString &soundname, ASoundData &data);
+
+    /// Сохранить метаданные разобранного файла
+    void store(const QString &soundname, const ASoundData &data);
+
+    /// Удалить запись о файле
+    void remove(const QString &soundname);
+
+private:
+    /// Конструктор (private!)
+    ASoundMetaCache();
+    /// Деструктор - сохраняет изменения
+    ~ASoundMetaCache();
+
+    Q_DISABLE_COPY(ASoundMetaCache)
+
+    /*!
+     * \struct sound_meta_t
+     * \brief Запись кэша
+     */
+    struct sound_meta_t
+    {
+        qint64      fileSize;   ///< Размер файла
+        qint64      fileTime;   ///< Время модификации файла, мс
+        ASoundData  data;       ///< Метаданные (без PCM)
+    };
+
+    /// Блокировка (звуки могут загружаться в фоновых потоках)
+    QMutex mutex_;
+
+    /// Имя файла кэша
+    QString filename_;
+
+    /// Флаг наличия несохранённых изменений
+    bool dirty_;
+
+    /// Записи кэша (абсолютный путь, метаданные)
+    QMap<QString, sound_meta_t> entries_;
+
+    /// Ключ записи для файла
+    static QString key_(const QString &soundname);
+};
+
+#endif // ASOUND_CACHE_H
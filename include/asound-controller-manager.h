@@ -0,0 +1,194 @@
+//-----------------------------------------------------------------------------
+//
+//      Пакетное управление очередями запуска звуков
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Пакетное управление очередями запуска звуков
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_CONTROLLER_MANAGER_H
+#define ASOUND_CONTROLLER_MANAGER_H
+
+#include <QObject>
+#include <QVector>
+#include <QStringList>
+#include <QElapsedTimer>
+
+#include "asound-global.h"
+
+class QTimer;
+class ASound;
+
+/*!
+ * \class ASoundControllerManager
+ * \brief Менеджер множества очередей запуска (аналог ASoundController:
+ * запуск - процесс работы - остановка). Состояние всех очередей хранится
+ * в параллельных массивах, команды лишь меняют состояние и отмечают
+ * очередь как изменённую. Один шаг (tick) обходит только изменённые и
+ * запускающиеся очереди и отправляет все их изменения одним пакетом
+ */
+class ASOUNDSHARED_EXPORT ASoundControllerManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Конструктор
+    explicit ASoundControllerManager(QObject* parent = Q_NULLPTR);
+    /// Деструктор
+    ~ASoundControllerManager();
+
+    /*!
+     * \brief Добавить очередь запуска
+     * \param soundBegin - звук запуска
+     * \param soundsRunning - звуки процесса работы
+     * \param soundEnd - звук остановки
+     * \param loadFlags - флаги загрузки (ASoundLoadFlag)
+     * \return идентификатор очереди или -1, если звуки не загружены
+     */
+    int addController(QString soundBegin, QStringList soundsRunning,
+                      QString soundEnd, int loadFlags = LOAD_DEFAULT);
+
+    /// Удалить очередь (идентификатор больше не используется)
+    void removeController(int id);
+
+    /// Количество очередей (включая удалённые)
+    int count() const;
+
+    /// Запустить алгоритм воспроизведения (запуск устройства)
+    void begin(int id);
+
+    /// Завершить алгоритм воспроизведения (остановка устройства)
+    void end(int id);
+
+    /// Аварийно завершить алгоритм воспроизведения
+    void forcedStop(int id);
+
+    /// Установить звук процесса работы
+    void switchRunningSound(int id, int index);
+
+    /// Установить скорость воспроизведения
+    void setPitch(int id, float pitch);
+
+    /// Установить громкость 0 - 100
+    void setVolume(int id, int volume);
+
+    /*!
+     * \brief Установить скорости воспроизведения множества очередей
+     * \param ids - идентификаторы очередей
+     * \param pitches - скорости воспроизведения
+     * \param count - количество очередей
+     */
+    void setPitches(const int* ids, const float* pitches, int count);
+
+    /// Работает ли очередь (процесс работы)
+    bool isRunning(int id) const;
+
+    /*!
+     * \brief Установить задержку автоматического шага, мс. Команды,
+     * поданные за это время, попадают в один пакет. По умолчанию 0 -
+     * шаг при ближайшем возврате в цикл событий; -1 - шаг только по tick()
+     */
+    void setTickInterval(int ms);
+
+public slots:
+    /// Шаг: применить все накопленные изменения одним пакетом
+    void tick();
+
+private:
+    /// Фаза очереди
+    enum
+    {
+        PHASE_IDLE      = 0,    ///< Остановлена
+        PHASE_BEGINNING = 1,    ///< Звучит звук запуска
+        PHASE_RUNNING   = 2,    ///< Процесс работы
+        PHASE_REMOVED   = 3     ///< Удалена
+    };
+
+    /// Отложенные действия очереди
+    enum
+    {
+        ACT_PLAY_BEGIN  = 0x01, ///< Запустить звук запуска
+        ACT_STOP_BEGIN  = 0x02, ///< Остановить звук запуска
+        ACT_PLAY_END    = 0x04, ///< Запустить звук остановки
+        ACT_PITCH       = 0x08, ///< Применить скорость воспроизведения
+        ACT_VOLUME      = 0x10, ///< Применить громкость
+        ACT_STOP_ALL    = 0x20, ///< Остановить все звуки процесса работы
+        ACT_QUEUED      = 0x80  ///< Очередь уже в списке изменённых
+    };
+
+    /// Фазы очередей
+    QVector<quint8> phase_;
+
+    /// Отложенные действия очередей
+    QVector<quint8> actions_;
+
+    /// Требуемый звук процесса работы
+    QVector<int> current_;
+
+    /// Звучащий звук процесса работы (-1 - нет)
+    QVector<int> playing_;
+
+    /// Скорости воспроизведения
+    QVector<float> pitch_;
+
+    /// Громкости
+    QVector<int> volume_;
+
+    /// Длительности звуков запуска, мс
+    QVector<int> beginDuration_;
+
+    /// Моменты окончания звуков запуска, мс
+    QVector<qint64> beginDeadline_;
+
+    /// Звуки запуска
+    QVector<ASound*> soundBegin_;
+
+    /// Звуки остановки
+    QVector<ASound*> soundEnd_;
+
+    /// Первый звук процесса работы очереди в runningSounds_
+    QVector<int> runningFirst_;
+
+    /// Количество звуков процесса работы очереди
+    QVector<int> runningCount_;
+
+    /// Звуки процесса работы всех очередей подряд
+    QVector<ASound*> runningSounds_;
+
+    /// Очереди с отложенными действиями
+    QVector<int> dirty_;
+
+    /// Очереди, ожидающие окончания звука запуска
+    QVector<int> waiting_;
+
+    /// Часы менеджера
+    QElapsedTimer clock_;
+
+    /// Таймер автоматического шага
+    QTimer* timer_;
+
+    /// Задержка автоматического шага, мс
+    int tickInterval_;
+
+    /// Корректен ли идентификатор
+    bool isValid_(int id) const;
+
+    /// Отметить очередь как изменённую
+    void markDirty_(int id, quint8 actions);
+
+    /// Применить изменения очереди
+    void apply_(int id);
+
+    /// Запланировать автоматический шаг
+    void schedule_();
+
+    /// Загрузить звук; Q_NULLPTR при ошибке
+    ASound* loadSound_(const QString &soundname, int loadFlags);
+};
+
+#endif // ASOUND_CONTROLLER_MANAGER_H
@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------------
+//
+//      Контроль подключения устройств вывода и их переоткрытие
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Контроль подключения устройств вывода и их переоткрытие
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_DEVICE_H
+#define ASOUND_DEVICE_H
+
+#include <QObject>
+#include <QList>
+#include <QSet>
+#include <QElapsedTimer>
+
+#include "asound-global.h"
+
+class QTimer;
+class ASound;
+class AListener;
+
+/// Период проверки подключения устройств по умолчанию, мс
+const int DEF_DEVICE_CHECK_INTERVAL = 250;
+
+/*!
+ * \class ASoundDeviceMonitor
+ * \brief Контроль подключения устройств вывода (ALC_EXT_disconnect).
+ * Пока устройство подключено, периодически запоминает состояние и позицию
+ * воспроизведения его звуков. При потере устройство переоткрывается
+ * (ALC_SOFT_reopen_device - с сохранением буферов и источников, иначе
+ * пересозданием контекста, буферы заполняются из уже разобранных данных),
+ * после чего звуки продолжают играть с расчётной позиции. Неудачное
+ * переоткрытие повторяется при каждой проверке (переподключение устройства)
+ */
+class ASOUNDSHARED_EXPORT ASoundDeviceMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Статический метод запрещающий повторное создание экземпляра класса
+    static ASoundDeviceMonitor &getInstance();
+
+    /// Установить период проверки, мс (0 - проверка только по check())
+    void setInterval(int ms);
+
+    /// Добавить звук под восстановление
+    void add(ASound* sound);
+
+    /// Удалить звук
+    void remove(ASound* sound);
+
+    /*!
+     * \brief Переоткрыть устройство и восстановить его звуки
+     * \return удалось ли открыть устройство
+     */
+    bool reopen(AListener* output);
+
+    /// Время по часам монитора, мс
+    qint64 now() const;
+
+public slots:
+    /// Проверить подключение всех устройств
+    void check();
+
+signals:
+    /// Устройство потеряно
+    void deviceLost(AListener* output);
+
+    /// Устройство переоткрыто, звуки восстановлены
+    void deviceRestored(AListener* output);
+
+private:
+    /// Конструктор (private!)
+    ASoundDeviceMonitor();
+
+    /// Таймер проверки
+    QTimer* timer_;
+
+    /// Период проверки, мс
+    int interval_;
+
+    /// Часы монитора
+    QElapsedTimer clock_;
+
+    /// Звуки под восстановлением
+    QList<ASound*> sounds_;
+
+    /// Потерянные и ещё не переоткрытые устройства
+    QSet<AListener*> lost_;
+};
+
+#endif // ASOUND_DEVICE_H
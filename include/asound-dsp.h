@@ -0,0 +1,209 @@
+//-----------------------------------------------------------------------------
+//
+//      Подпрограммы обработки PCM данных при загрузке звуков
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Подпрограммы обработки PCM данных при загрузке звуков
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_DSP_H
+#define ASOUND_DSP_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * \struct sound_level_t
+ * \brief Уровни участка PCM данных (доли полной шкалы)
+ */
+struct sound_level_t
+{
+    float           peak;           ///< Пиковый уровень
+    float           rms;            ///< Среднеквадратичный уровень
+    float           loudness;       ///< Интегральная громкость (ITU-R BS.1770), LUFS
+    float           slope;          ///< Средний модуль приращения отсчётов
+// Конструктор
+    sound_level_t()
+    {
+        peak = 0.0f;
+        rms = 0.0f;
+        loudness = -70.0f;
+        slope = 0.0f;
+    }
+};
+
+/// Полос генератора полосового шума (по одной на дорожку SSE2)
+#define NOISE_LANES 4
+
+/*!
+ * \struct noise_lanes_t
+ * \brief Состояние полос генератора полосового шума
+ */
+struct noise_lanes_t
+{
+    alignas(16) uint32_t seed[NOISE_LANES]; ///< Генераторы белого шума (xorshift32)
+    alignas(16) float b0[NOISE_LANES];      ///< Коэффициенты фильтров (b1 = 0, b2 = -b0)
+    alignas(16) float a1[NOISE_LANES];
+    alignas(16) float a2[NOISE_LANES];
+    alignas(16) float z1[NOISE_LANES];      ///< Состояние фильтров
+    alignas(16) float z2[NOISE_LANES];
+    alignas(16) float gain[NOISE_LANES];    ///< Текущие громкости полос
+    alignas(16) float step[NOISE_LANES];    ///< Приращения громкостей за отсчёт
+// Конструктор
+    noise_lanes_t()
+    {
+        for (int l = 0; l < NOISE_LANES; ++l)
+        {
+            seed[l] = 1u;
+            b0[l] = a1[l] = a2[l] = 0.0f;
+            z1[l] = z2[l] = 0.0f;
+            gain[l] = step[l] = 0.0f;
+        }
+    }
+};
+
+/*!
+ * \namespace ASoundDSP
+ * \brief Векторизованные (SSE2) ядра обработки PCM данных с резервной
+ * скалярной реализацией
+ */
+namespace ASoundDSP
+{
+    /*!
+     * \brief Разрешить или запретить векторные ветки ядер (по умолчанию
+     * разрешены). Для сверки векторных и скалярных ветвей между собой
+     */
+    void setSimdEnabled(bool enabled);
+
+    /// Включены ли векторные ветки ядер (false, если сборка без SSE2)
+    bool isSimdEnabled();
+
+    /*!
+     * \brief Свести 16-битный стерео сигнал в моно
+     * \param src - чередующиеся отсчёты L/R
+     * \param dst - выходной буфер на frames отсчётов
+     * \param frames - количество кадров
+     */
+    void downmixStereo16(const int16_t* src, int16_t* dst, size_t frames);
+
+    /*!
+     * \brief Свести 8-битный (беззнаковый) стерео сигнал в моно
+     * \param src - чередующиеся отсчёты L/R
+     * \param dst - выходной буфер на frames отсчётов
+     * \param frames - количество кадров
+     */
+    void downmixStereo8(const uint8_t* src, uint8_t* dst, size_t frames);
+
+    /*!
+     * \brief Преобразовать чередующиеся PCM отсчёты (8/16 бит) в каналы float
+     * \param src - исходные данные
+     * \param bits - бит в сэмпле (8 или 16)
+     * \param channels - количество каналов
+     * \param frames - количество кадров
+     * \param planes - массивы по каналам, каждый на frames отсчётов
+     */
+    void pcmToFloat(const unsigned char* src, int bits, int channels,
+                    size_t frames, float* const* planes);
+
+    /*!
+     * \brief Преобразовать каналы float в чередующиеся PCM отсчёты (8/16 бит)
+     * с ограничением амплитуды
+     */
+    void floatToPcm(const float* const* planes, int channels, size_t frames,
+                    int bits, unsigned char* dst);
+
+    /// Длина сигнала (в кадрах) после смены частоты дискретизации
+    size_t resampledLength(size_t frames, uint32_t srcRate, uint32_t dstRate);
+
+    /*!
+     * \brief Сменить частоту дискретизации одного канала (windowed-sinc,
+     * окно Кайзера). Длинные сигналы обрабатываются в нескольких потоках
+     * \param src - исходный канал
+     * \param srcFrames - количество исходных отсчётов
+     * \param dst - выходной канал на resampledLength() отсчётов
+     * \param srcRate - исходная частота дискретизации
+     * \param dstRate - требуемая частота дискретизации
+     */
+    void resample(const float* src, size_t srcFrames, float* dst,
+                  uint32_t srcRate, uint32_t dstRate);
+
+    /*!
+     * \brief Некриптографическая 64-битная свёртка данных (четыре 64-битные
+     * дорожки по 32 байта за шаг) для поиска одинаковых PCM данных.
+     * Результат не зависит от наличия SSE2; совпадение свёрток требует
+     * побайтного сравнения
+     * \param data - данные
+     * \param size - размер, байт
+     */
+    uint64_t hash64(const void* data, size_t size);
+
+    /// Громкость тишины (абсолютный порог стробирования), LUFS
+    const float LOUDNESS_SILENCE = -70.0f;
+
+    /*!
+     * \brief Измерить уровни участков сигнала за один проход. Участки
+     * делятся на куски по несколько секунд; длинные сигналы обрабатываются
+     * в нескольких потоках
+     * \param src - чередующиеся отсчёты (8/16 бит), участки лежат подряд
+     * \param bits - бит в сэмпле (8 или 16)
+     * \param channels - количество каналов
+     * \param rate - частота дискретизации
+     * \param frames - длины участков, кадров
+     * \param count - количество участков
+     * \param levels - уровни участков (count элементов)
+     * \param total - уровни всего сигнала (или nullptr)
+     */
+    void analyze(const unsigned char* src, int bits, int channels, uint32_t rate,
+                 const size_t* frames, int count,
+                 sound_level_t* levels, sound_level_t* total);
+
+    /*!
+     * \brief Оценить разрыв на стыке (переход с tail на head): отклонение
+     * первого кадра после стыка от линейного продолжения двух последних
+     * кадров до него, отнесённое к среднему приращению сигнала. Порядка
+     * единицы и меньше - стык не отличается от сигнала, много больше - щелчок
+     * \param tail - два последних кадра перед стыком
+     * \param head - первый кадр после стыка
+     * \param bits - бит в сэмпле (8 или 16)
+     * \param channels - количество каналов
+     * \param slope - средний модуль приращения (sound_level_t::slope)
+     */
+    float seamScore(const unsigned char* tail, const unsigned char* head,
+                    int bits, int channels, float slope);
+
+    /// Кадров сигнала частоты rate на отсчёт огибающей частоты envRate
+    size_t envelopeStep(uint32_t rate, uint32_t envRate);
+
+    /*!
+     * \brief Построить огибающую низких частот: среднее каналов через ФНЧ
+     * (Баттерворт 2-го порядка), среднеквадратичное значение по окнам
+     * из envelopeStep() кадров
+     * \param src - чередующиеся отсчёты (8/16 бит)
+     * \param bits - бит в сэмпле (8 или 16)
+     * \param channels - количество каналов
+     * \param rate - частота дискретизации
+     * \param frames - количество кадров
+     * \param cutoff - частота среза ФНЧ, Гц
+     * \param envRate - частота отсчётов огибающей, Гц
+     * \param dst - выход на (frames + step - 1) / step отсчётов (доли полной шкалы)
+     */
+    void lowEnvelope(const unsigned char* src, int bits, int channels, uint32_t rate,
+                     size_t frames, float cutoff, uint32_t envRate, float* dst);
+
+    /*!
+     * \brief Синтезировать сумму полос полосового шума: белый шум каждой
+     * полосы через свой полосовой фильтр, громкость полосы меняется на step
+     * за отсчёт. Векторная и скалярная ветки дают одинаковые отсчёты
+     * \param lanes - состояние полос (продолжается с прошлого вызова)
+     * \param dst - выход на count отсчётов (16 бит, с ограничением амплитуды)
+     * \param count - количество отсчётов
+     */
+    void noiseLanes(noise_lanes_t &lanes, int16_t* dst, size_t count);
+}
+
+#endif // ASOUND_DSP_H
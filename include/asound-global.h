@@ -0,0 +1,49 @@
+//-----------------------------------------------------------------------------
+//
+//      Общие определения библиотеки для работы с 3D звуком
+//      (c) РГУПС, ВЖД 24/03/2017
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Общие определения библиотеки для работы с 3D звуком
+ *  \copyright РГУПС, ВЖД
+ *  \date 24/03/2017
+ */
+
+#ifndef ASOUND_GLOBAL_H
+#define ASOUND_GLOBAL_H
+
+#include <QtGlobal>
+
+#if defined(ASOUND_LIBRARY)
+#  define ASOUNDSHARED_EXPORT Q_DECL_EXPORT
+#else
+#  define ASOUNDSHARED_EXPORT Q_DECL_IMPORT
+#endif
+
+#define BUFFER_BLOCKS 3
+
+/// Флаги обработки звука при загрузке
+enum ASoundLoadFlag
+{
+    LOAD_DEFAULT        = 0x00, ///< Загружать данные "как есть"
+    LOAD_DOWNMIX_MONO   = 0x01, ///< Сводить стерео в моно (для 3D источников)
+    LOAD_RESAMPLE       = 0x02, ///< Приводить к частоте микширования устройства
+    LOAD_LOD            = 0x04, ///< Строить упрощённые варианты для дальних источников
+    LOAD_ENVELOPE       = 0x08  ///< Строить огибающую низких частот (вибрация, индикация)
+};
+
+/// Количество уровней детализации (0 - исходный звук)
+#define ASOUND_LOD_LEVELS 3
+
+/// Минимальная частота дискретизации упрощённых вариантов, Гц
+const uint32_t ASOUND_LOD_MIN_RATE = 8000;
+
+/// Частота отсчётов огибающей низких частот (LOAD_ENVELOPE), Гц
+const uint32_t ASOUND_ENVELOPE_RATE = 100;
+
+/// Частота среза фильтра огибающей низких частот, Гц
+const float ASOUND_ENVELOPE_CUTOFF = 150.0f;
+
+#endif // ASOUND_GLOBAL_H
@@ -0,0 +1,167 @@
+//-----------------------------------------------------------------------------
+//
+//      Группы звуков (кабина, окружение, состав, фон, интерфейс)
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Группы звуков (кабина, окружение, состав, фон, интерфейс)
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_GROUP_H
+#define ASOUND_GROUP_H
+
+#include <QObject>
+#include <QList>
+#include <QVector>
+#include <AL/al.h>
+
+#include "asound-global.h"
+
+class ASound;
+
+/*!
+ * \class ASoundGroup
+ * \brief Группа звуков с общими громкостью, множителем скорости
+ * воспроизведения, заглушением и паузой. Группы образуют иерархию
+ * (например, "внешние" -> "состав"), итоговые значения перемножаются
+ * вдоль цепочки предков (для заглушения - доли прошедшего звука) и
+ * хранятся готовыми, так что звук получает их за O(1). Изменение группы
+ * применяется ко всем звукам поддерева одним пакетом изменений OpenAL,
+ * пауза и её снятие - одним вызовом alSourcePausev()/alSourcePlayv()
+ */
+class ASOUNDSHARED_EXPORT ASoundGroup : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Конструктор
+     * \param name - имя группы
+     * \param parentGroup - родительская группа (Q_NULLPTR - корневая)
+     */
+    explicit ASoundGroup(QString name, ASoundGroup* parentGroup = Q_NULLPTR,
+                         QObject* parent = Q_NULLPTR);
+    /// Деструктор - звуки и дочерние группы становятся независимыми
+    ~ASoundGroup();
+
+    /// Вернуть имя группы
+    QString getName() const;
+
+    /// Вернуть родительскую группу
+    ASoundGroup* getParentGroup() const;
+
+    /// Вернуть громкость группы (0.0 - 1.0)
+    float getGain() const;
+
+    /// Вернуть множитель скорости воспроизведения группы
+    float getPitch() const;
+
+    /// Приостановлена ли сама группа
+    bool isPaused() const;
+
+    /// Вернуть заглушение группы (0.0 - 1.0)
+    float getOcclusion() const;
+
+    /// Итоговая громкость с учётом родительских групп
+    float getEffectiveGain() const;
+
+    /// Итоговый множитель скорости с учётом родительских групп
+    float getEffectivePitch() const;
+
+    /// Приостановлена ли группа или кто-либо из её предков
+    bool isEffectivePaused() const;
+
+    /// Итоговое заглушение с учётом родительских групп
+    float getEffectiveOcclusion() const;
+
+    /// Вернуть звуки группы
+    QList<ASound*> getSounds() const;
+
+public slots:
+    /// Установить громкость группы (0.0 - 1.0)
+    void setGain(float gain);
+
+    /// Установить множитель скорости воспроизведения группы
+    void setPitch(float pitch);
+
+    /// Установить паузу группы
+    void setPaused(bool paused);
+
+    /// Установить заглушение прямого пути звуков группы (0.0 - 1.0)
+    void setOcclusion(float occlusion);
+
+    /// Приостановить группу
+    void pause();
+
+    /// Снять группу с паузы
+    void resume();
+
+private:
+    friend class ASound;
+
+    /// Имя группы
+    QString name_;
+
+    /// Родительская группа
+    ASoundGroup* parentGroup_;
+
+    /// Дочерние группы
+    QList<ASoundGroup*> children_;
+
+    /// Звуки группы
+    QList<ASound*> sounds_;
+
+    /// Громкость группы
+    float gain_;
+
+    /// Множитель скорости группы
+    float pitch_;
+
+    /// Пауза группы
+    bool paused_;
+
+    /// Заглушение группы
+    float occlusion_;
+
+    /// Итоговая громкость
+    float effectiveGain_;
+
+    /// Итоговый множитель скорости
+    float effectivePitch_;
+
+    /// Итоговая пауза
+    bool effectivePaused_;
+
+    /// Итоговое заглушение
+    float effectiveOcclusion_;
+
+    /// Звуки, приостановленные паузой группы или запущенные во время неё
+    QVector<ASound*> heldSources_;
+
+    /// Пересчитать итоговые значения поддерева и применить их к звукам
+    void update_(bool applyParams);
+
+    /// Рекурсивный пересчёт: собирает звуки для паузы и запуска
+    void updateTree_(bool applyParams, QVector<ASound*> &toPause, QVector<ASound*> &toPlay);
+
+    /// Приостановить или запустить звуки - одним вызовом на устройство
+    static void setSourcesState_(const QVector<ASound*> &sounds, bool play);
+
+    /// Добавить звук (вызывается из ASound::setGroup)
+    void addSound_(ASound* sound);
+
+    /// Удалить звук; возвращает, был ли его запуск отложен паузой
+    bool removeSound_(ASound* sound);
+
+    /// Отложить запуск источника звука до снятия паузы
+    void holdSource_(ASound* sound);
+
+    /// Отменить отложенный запуск источника звука
+    void releaseSource_(ASound* sound);
+};
+
+#endif // ASOUND_GROUP_H
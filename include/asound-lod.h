@@ -0,0 +1,90 @@
+//-----------------------------------------------------------------------------
+//
+//      Выбор уровня детализации звуков по расстоянию до слушателя
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Выбор уровня детализации звуков по расстоянию до слушателя
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_LOD_H
+#define ASOUND_LOD_H
+
+#include <QObject>
+#include <QList>
+#include <QVector>
+
+#include "asound-global.h"
+
+class QTimer;
+class ASound;
+
+/// Период пересчёта уровней детализации по умолчанию, мс
+const int DEF_LOD_INTERVAL = 200;
+
+/// Относительный запас возврата на более детальный уровень
+const float LOD_HYSTERESIS = 0.1f;
+
+/*!
+ * \class ASoundLodManager
+ * \brief Выбор уровня детализации звуков, загруженных с флагом LOAD_LOD.
+ * Периодически сравнивает расстояние от звука до слушателя (с учётом
+ * приоритета звука) с порогами уровней; звучащие звуки переключаются на
+ * границе цикла, молчащие - сразу
+ */
+class ASOUNDSHARED_EXPORT ASoundLodManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Статический метод запрещающий повторное создание экземпляра класса
+    static ASoundLodManager &getInstance();
+
+    /*!
+     * \brief Установить пороги уровней детализации
+     * \param distances - расстояния, начиная с которых действуют уровни
+     * 1, 2 ... (по возрастанию)
+     */
+    void setDistances(const QVector<float> &distances);
+
+    /// Вернуть пороги уровней детализации
+    QVector<float> getDistances() const;
+
+    /// Установить период пересчёта, мс (0 - пересчёт только по update())
+    void setInterval(int ms);
+
+    /// Добавить звук с вариантами детализации
+    void add(ASound* sound);
+
+    /// Удалить звук
+    void remove(ASound* sound);
+
+public slots:
+    /// Пересчитать уровни детализации всех звуков
+    void update();
+
+private:
+    /// Конструктор (private!)
+    ASoundLodManager();
+
+    /// Пороги уровней детализации
+    QVector<float> distances_;
+
+    /// Таймер пересчёта
+    QTimer* timer_;
+
+    /// Период пересчёта, мс
+    int interval_;
+
+    /// Звуки с вариантами детализации
+    QList<ASound*> sounds_;
+
+    /// Выбрать уровень звука по расстоянию
+    int selectLevel_(int current, int count, float distance) const;
+};
+
+#endif // ASOUND_LOD_H
@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+//
+//      Плавное изменение громкости и скорости воспроизведения
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Плавное изменение громкости и скорости воспроизведения
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_RAMP_H
+#define ASOUND_RAMP_H
+
+#include <QObject>
+#include <QList>
+#include <QElapsedTimer>
+
+#include "asound-global.h"
+
+class QTimer;
+class ASound;
+
+/*!
+ * \enum ASoundRampCurve
+ * \brief Закон плавного изменения параметра
+ */
+enum ASoundRampCurve
+{
+    RAMP_LINEAR         = 0,    ///< Линейный
+    RAMP_EXPONENTIAL    = 1,    ///< Экспоненциальный (равномерный в дБ/октавах)
+    RAMP_SMOOTH         = 2     ///< S-образный (плавные начало и конец)
+};
+
+/*!
+ * \class ASoundRamp
+ * \brief Плавное изменение одного параметра от начального значения к
+ * конечному за заданное время
+ */
+class ASOUNDSHARED_EXPORT ASoundRamp
+{
+public:
+    /// Конструктор
+    ASoundRamp();
+
+    /*!
+     * \brief Начать изменение
+     * \param from - начальное значение
+     * \param to - конечное значение
+     * \param now - текущее время, мс
+     * \param ms - длительность, мс
+     * \param curve - закон изменения (ASoundRampCurve)
+     */
+    void start(float from, float to, qint64 now, int ms, int curve);
+
+    /// Прервать изменение
+    void stop();
+
+    /// Идёт ли изменение
+    bool isActive() const;
+
+    /// Значение на момент now; по достижении конца изменение завершается
+    float step(qint64 now);
+
+private:
+    /// Флаг активности
+    bool active_;
+
+    /// Начальное значение
+    float from_;
+
+    /// Конечное значение
+    float to_;
+
+    /// Время начала, мс
+    qint64 start_;
+
+    /// Длительность, мс
+    qint64 duration_;
+
+    /// Закон изменения
+    int curve_;
+};
+
+/*!
+ * \class ASoundRamper
+ * \brief Общий таймер плавных изменений. Пока есть звуки с активными
+ * изменениями, с периодом обновления микшера (ALC_REFRESH) подаёт
+ * промежуточные значения всех звуков одним пакетом; между пакетами
+ * OpenAL сам сглаживает громкость внутри блока микширования
+ */
+class ASOUNDSHARED_EXPORT ASoundRamper : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Статический метод запрещающий повторное создание экземпляра класса
+    static ASoundRamper &getInstance();
+
+    /// Текущее время, мс
+    qint64 now() const;
+
+    /// Добавить звук с активными изменениями
+    void add(ASound* sound);
+
+    /// Удалить звук
+    void remove(ASound* sound);
+
+private slots:
+    /// Шаг изменений
+    void onTick();
+
+private:
+    /// Конструктор (private!)
+    ASoundRamper();
+
+    /// Часы изменений
+    QElapsedTimer clock_;
+
+    /// Таймер шага
+    QTimer* timer_;
+
+    /// Звуки с активными изменениями
+    QList<ASound*> sounds_;
+};
+
+#endif // ASOUND_RAMP_H
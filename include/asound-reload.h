@@ -0,0 +1,137 @@
+//-----------------------------------------------------------------------------
+//
+//      Перезагрузка изменившихся аудиофайлов без перезапуска
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Перезагрузка изменившихся аудиофайлов без перезапуска
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_RELOAD_H
+#define ASOUND_RELOAD_H
+
+#include <QObject>
+#include <QList>
+#include <QSet>
+#include <QVector>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+
+#include "asound-global.h"
+#include "asound-wave.h"
+
+class QTimer;
+class QFileSystemWatcher;
+class ASound;
+
+template <typename T> class QFutureWatcher;
+
+/// Задержка перезагрузки после последнего изменения файла по умолчанию, мс
+const int DEF_RELOAD_DELAY = 300;
+
+/*!
+ * \class ASoundReloader
+ * \brief Отслеживание аудиофайлов звуков во время разработки контента.
+ * Изменившийся файл (и только он) разбирается заново в пуле потоков -
+ * по разу на каждое сочетание флагов загрузки и частоты устройства, -
+ * после чего все звуки этого файла получают новые данные одним пакетом
+ * изменений OpenAL и продолжают играть с прежней позиции. Звуки из банков
+ * не отслеживаются. По умолчанию отслеживание выключено
+ */
+class ASOUNDSHARED_EXPORT ASoundReloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Статический метод запрещающий повторное создание экземпляра класса
+    static ASoundReloader &getInstance();
+
+    /// Включить или выключить отслеживание файлов
+    void setEnabled(bool enabled);
+
+    /// Включено ли отслеживание
+    bool isEnabled() const;
+
+    /// Установить задержку перезагрузки после последнего изменения, мс
+    void setDelay(int ms);
+
+    /// Добавить звук, загруженный из файла
+    void add(ASound* sound);
+
+    /// Удалить звук
+    void remove(ASound* sound);
+
+public slots:
+    /// Перезагрузить файл немедленно (и при выключенном отслеживании)
+    void reload(const QString &soundname);
+
+signals:
+    /// Файл перезагружен, звуки получили новые данные
+    void reloaded(QString soundname);
+
+    /// Ошибка разбора файла (звуки продолжают играть прежние данные)
+    void failed(QString soundname, QString error);
+
+private:
+    /// Конструктор (private!)
+    ASoundReloader();
+
+    /*!
+     * \struct reload_variant_t
+     * \brief Вариант обработки файла, используемый звуками
+     */
+    struct reload_variant_t
+    {
+        int                         loadFlags;  ///< Флаги загрузки
+        uint32_t                    deviceRate; ///< Частота устройства
+        QSharedPointer<ASoundData>  data;       ///< Новые данные
+        QString                     error;      ///< Текст ошибки
+
+        reload_variant_t()
+            : loadFlags(0)
+            , deviceRate(0)
+        {
+
+        }
+    };
+
+    /// Включено ли отслеживание
+    bool enabled_;
+
+    /// Наблюдатель файловой системы
+    QFileSystemWatcher* watcher_;
+
+    /// Таймер задержки перезагрузки
+    QTimer* timer_;
+
+    /// Часы для переноса позиции воспроизведения
+    QElapsedTimer clock_;
+
+    /// Звуки, загруженные из файлов
+    QList<ASound*> sounds_;
+
+    /// Изменившиеся файлы, ждущие перезагрузки
+    QSet<QString> pending_;
+
+    /// Файлы, разбираемые в данный момент
+    QSet<QString> busy_;
+
+    /// (слот) Файл изменился
+    void onFileChanged_(const QString &path);
+
+    /// (слот) Истекла задержка - перезагрузить изменившиеся файлы
+    void onTimer_();
+
+    /// Обработка завершения фонового разбора
+    void onReloaded_(const QString &soundname,
+                     QFutureWatcher<QVector<reload_variant_t> >* watcher);
+
+    /// Используется ли файл каким-либо звуком
+    bool isUsed_(const QString &soundname) const;
+};
+
+#endif // ASOUND_RELOAD_H
@@ -0,0 +1,102 @@
+//-----------------------------------------------------------------------------
+//
+//      Генератор шума качения колеса по рельсу
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Генератор шума качения колеса по рельсу
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_ROLLING_H
+#define ASOUND_ROLLING_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include "asound.h"
+
+/// Количество полос генератора (обрабатываются параллельно)
+#define ROLLING_LANES NOISE_LANES
+
+/// Размер блока пересчёта параметров, сэмплов
+const int ROLLING_BLOCK = 64;
+
+/*!
+ * \class ARollingNoise
+ * \brief Звук качения тележки, синтезируемый по скорости, кривизне пути и
+ * состоянию рельсов вместо набора записанных петель. Шум формируется
+ * четырьмя полосовыми фильтрами (качение, резонанс колеса и рельса,
+ * гребневый шум в кривых, низкочастотный гул), которые обрабатываются
+ * одним проходом по независимым полосам. Буфер наполняет микшер OpenAL
+ * через AL_SOFT_callback_buffer; управление громкостью, положением,
+ * группой и прочим - как у ASound
+ */
+class ASOUNDSHARED_EXPORT ARollingNoise : public ASound
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Конструктор
+     * \param output - устройство вывода (Q_NULLPTR - по умолчанию)
+     * \param seed - начальное значение генератора шума (у тележек одного
+     * состава должны различаться)
+     */
+    explicit ARollingNoise(QObject* parent = Q_NULLPTR, AListener* output = Q_NULLPTR,
+                           uint32_t seed = 1);
+    /// Деструктор
+    ~ARollingNoise();
+
+    /// Вернуть скорость, м/с
+    float getSpeed() const;
+
+    /// Вернуть кривизну пути, 1/м
+    float getCurvature() const;
+
+    /// Вернуть состояние рельсов (0.0 - изношенные, 1.0 - идеальные)
+    float getRailQuality() const;
+
+public slots:
+    /// Установить скорость, м/с
+    void setSpeed(float speed);
+
+    /// Установить кривизну пути (1 / радиус кривой), 1/м
+    void setCurvature(float curvature);
+
+    /// Установить состояние рельсов (0.0 - изношенные, 1.0 - идеальные)
+    void setRailQuality(float quality);
+
+private:
+    /// Скорость, м/с
+    std::atomic<float> speed_;
+
+    /// Кривизна пути, 1/м
+    std::atomic<float> curvature_;
+
+    /// Состояние рельсов
+    std::atomic<float> quality_;
+
+    /// Частота дискретизации, Гц
+    float rate_;
+
+    /// Состояние полос (поток микшера)
+    noise_lanes_t lanes_;
+
+    /// Наполнение буфера (вызывается микшером)
+    static ALsizei callback_(ALvoid* userptr, ALvoid* data, ALsizei size);
+
+    /// Синтезировать сэмплы
+    void render_(ALshort* out, int count);
+
+    /// Пересчитать фильтры и громкости полос по параметрам движения
+    void updateLanes_();
+
+    /// Настроить полосовой фильтр полосы
+    void setBand_(int lane, float frequency, float q);
+};
+
+#endif // ASOUND_ROLLING_H
@@ -0,0 +1,279 @@
+//-----------------------------------------------------------------------------
+//
+//      Общее хранилище загруженных звуков и их предзагрузка
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Общее хранилище загруженных звуков и их предзагрузка
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_STORE_H
+#define ASOUND_STORE_H
+
+#include <QObject>
+#include <QMap>
+#include <QMultiMap>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+#include "asound-global.h"
+#include "asound-wave.h"
+
+template <typename T> class QFutureWatcher;
+
+/*!
+ * \class ASoundStore
+ * \brief Хранилище загруженных (и обработанных по флагам) звуков.
+ * Звуки, используемые источниками, разделяются между ними; закреплённые
+ * звуки (например, предзагруженные) остаются в памяти и без источников.
+ * Одинаковые PCM данные разных файлов (копии одного звука в папках
+ * разных локомотивов) хранятся один раз: при загрузке они находятся по
+ * свёртке и сверяются побайтно, после чего звук ссылается на уже
+ * загруженную память, а источники получают общие буферы OpenAL
+ */
+class ASOUNDSHARED_EXPORT ASoundStore
+{
+public:
+    /// Статический метод запрещающий повторное создание экземпляра класса
+    static ASoundStore &getInstance();
+
+    /*!
+     * \brief Вернуть звук из хранилища или загрузить его. Одновременные
+     * запросы одного звука из разных потоков приводят к одной загрузке
+     * \param soundname - имя аудиофайла
+     * \param loadFlags - флаги загрузки (ASoundLoadFlag)
+     * \param deviceRate - частота микширования устройства
+     * \param error - текст ошибки
+     * \return данные звука или пустой указатель при ошибке
+     */
+    QSharedPointer<ASoundData> load(const QString &soundname, int loadFlags,
+                                    uint32_t deviceRate, QString &error);
+
+    /*!
+     * \brief Вернуть звук, если он уже загружен
+     * \param deviceRate - частота микширования устройства (0 - устройство
+     * по умолчанию); учитывается только для LOAD_RESAMPLE
+     */
+    QSharedPointer<ASoundData> find(const QString &soundname, int loadFlags,
+                                    uint32_t deviceRate = 0);
+
+    /*!
+     * \brief Вернуть упрощённый вариант звука (общий для всех источников)
+     * или построить его
+     * \param soundname - имя аудиофайла
+     * \param loadFlags - флаги загрузки исходного звука
+     * \param level - уровень детализации
+     * \param data - исходные данные звука
+     * \return вариант или пустой указатель, если упрощать нечего
+     */
+    QSharedPointer<ASoundData> lodVariant(const QString &soundname, int loadFlags,
+                                          int level, QSharedPointer<ASoundData> data);
+
+    /*!
+     * \brief Перечитать изменившийся файл и заменить им данные хранилища.
+     * Закреплённый звук остаётся закреплённым, упрощённые варианты
+     * сбрасываются; источники получают новые данные через ASoundReloader
+     * \return новые данные или пустой указатель при ошибке (прежние
+     * данные тогда остаются в силе)
+     */
+    QSharedPointer<ASoundData> reload(const QString &soundname, int loadFlags,
+                                      uint32_t deviceRate, QString &error);
+
+    /// Закрепить звук в памяти
+    void pin(const QString &soundname, int loadFlags, uint32_t deviceRate = 0);
+
+    /// Снять закрепление (данные живут, пока их используют источники)
+    void unpin(const QString &soundname, int loadFlags, uint32_t deviceRate = 0);
+
+    /// Снять все закрепления
+    void unpinAll();
+
+    /*!
+     * \brief Задать пул для PCM данных последующих загрузок (например, на
+     * время загрузки звуков единицы подвижного состава). Пустой указатель -
+     * отдельный массив в куче на звук. Пул освобождается разом, когда
+     * удалены все звуки с его данными и сам указатель на него
+     */
+    void setArena(QSharedPointer<ASoundArena> arena);
+
+    /// Вернуть пул для PCM данных загрузок
+    QSharedPointer<ASoundArena> getArena();
+
+private:
+    /// Конструктор (private!)
+    ASoundStore();
+
+    Q_DISABLE_COPY(ASoundStore)
+
+    /*!
+     * \struct store_entry_t
+     * \brief Запись хранилища
+     */
+    struct store_entry_t
+    {
+        QSharedPointer<ASoundData>  pinned; ///< Закреплённые данные
+        QWeakPointer<ASoundData>    shared; ///< Данные, используемые источниками
+    };
+
+    /// Блокировка
+    QMutex mutex_;
+
+    /// Ожидание завершения загрузки, начатой другим потоком
+    QWaitCondition loaded_;
+
+    /// Записи хранилища
+    QMap<QString, store_entry_t> entries_;
+
+    /// Пул для PCM данных загрузок
+    QSharedPointer<ASoundArena> arena_;
+
+    /*!
+     * \struct pcm_entry_t
+     * \brief Загруженные PCM данные, доступные для разделения
+     */
+    struct pcm_entry_t
+    {
+        QWeakPointer<ASoundStorage> storage;    ///< Владелец памяти
+        const unsigned char*        pcm;        ///< Начало PCM данных
+        uint64_t                    size;       ///< Размер, байт
+        wave_info_fmt_t             info;       ///< Формат данных
+    };
+
+    /// PCM данные по свёртке
+    QMultiMap<uint64_t, pcm_entry_t> pcm_;
+
+    /// Загружаемые в данный момент звуки
+    QSet<QString> loading_;
+
+    /*!
+     * \brief Ключ записи. Ресемплированные данные различаются для устройств
+     * с разной частотой микширования, прочие - общие для всех устройств
+     */
+    static QString key_(const QString &soundname, int loadFlags, uint32_t deviceRate);
+
+    /// Найти действующие данные (под блокировкой)
+    QSharedPointer<ASoundData> findLocked_(const QString &key);
+
+    /*!
+     * \brief Перевести ещё не разделённые данные звука на уже загруженные
+     * PCM данные того же содержимого (без блокировки; либо запомнить
+     * данные звука как доступные для разделения)
+     */
+    void share_(QSharedPointer<ASoundData> data);
+};
+
+
+
+/*!
+ * \class ASoundPrefetcher
+ * \brief Предзагрузка звуков по маршруту. Каждый запрос содержит
+ * координату, в которой звук понадобится (путь или время - единица на
+ * усмотрение приложения, важно лишь её возрастание по ходу движения).
+ * Звуки загружаются в фоне в порядке приближения срока, звуки,
+ * оставшиеся позади, выгружаются из хранилища
+ */
+class ASOUNDSHARED_EXPORT ASoundPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Конструктор
+    explicit ASoundPrefetcher(QObject* parent = Q_NULLPTR);
+    /// Деструктор
+    ~ASoundPrefetcher();
+
+    /*!
+     * \brief Запросить предзагрузку звука
+     * \param soundname - имя аудиофайла
+     * \param neededAt - координата, в которой звук понадобится
+     * \param loadFlags - флаги загрузки (ASoundLoadFlag)
+     */
+    void prefetch(const QString &soundname, double neededAt,
+                  int loadFlags = LOAD_DEFAULT);
+
+    /// Отменить запрос и снять закрепление звука
+    void release(const QString &soundname, int loadFlags = LOAD_DEFAULT);
+
+    /// Загружен ли звук
+    bool isReady(const QString &soundname, int loadFlags = LOAD_DEFAULT);
+
+    /// Установить глубину упреждения: дальше position + lookahead не грузим
+    void setLookahead(double lookahead);
+
+    /// Установить запас позади: раньше position - margin звуки выгружаются
+    void setEvictMargin(double margin);
+
+    /// Установить количество одновременных фоновых загрузок
+    void setMaxLoads(int count);
+
+public slots:
+    /// Установить текущую координату (положение поезда или время)
+    void setPosition(double position);
+
+signals:
+    /// Звук загружен и закреплён в хранилище
+    void loaded(QString soundname);
+
+    /// Ошибка предзагрузки
+    void failed(QString soundname, QString error);
+
+private:
+    /*!
+     * \struct prefetch_request_t
+     * \brief Запрос предзагрузки
+     */
+    struct prefetch_request_t
+    {
+        QString     soundname;  ///< Имя аудиофайла
+        int         loadFlags;  ///< Флаги загрузки
+        double      neededAt;   ///< Координата, в которой звук понадобится
+        bool        ready;      ///< Звук загружен и закреплён
+        bool        loading;    ///< Звук загружается
+    };
+
+    /*!
+     * \struct prefetch_result_t
+     * \brief Результат фоновой загрузки
+     */
+    struct prefetch_result_t
+    {
+        QSharedPointer<ASoundData>  data;   ///< Данные звука
+        QString                     error;  ///< Текст ошибки
+    };
+
+    /// Текущая координата
+    double position_;
+
+    /// Глубина упреждения
+    double lookahead_;
+
+    /// Запас позади
+    double evictMargin_;
+
+    /// Максимум одновременных загрузок
+    int maxLoads_;
+
+    /// Текущее количество загрузок
+    int activeLoads_;
+
+    /// Запросы (ключ хранилища, запрос)
+    QMap<QString, prefetch_request_t> requests_;
+
+    /// Запуск загрузок в порядке срока
+    void schedule_();
+
+    /// Обработка завершения фоновой загрузки
+    void onLoaded_(const QString &key, QFutureWatcher<prefetch_result_t>* watcher);
+
+    /// Ключ запроса
+    static QString key_(const QString &soundname, int loadFlags);
+};
+
+#endif // ASOUND_STORE_H
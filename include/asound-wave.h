@@ -0,0 +1,596 @@
+//-----------------------------------------------------------------------------
+//
+//      Чтение и хранение данных WAVE файлов
+//      (c) РГУПС, ВЖД 24/03/2017
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Чтение и хранение данных WAVE файлов
+ *  \copyright РГУПС, ВЖД
+ *  \date 24/03/2017
+ */
+
+#ifndef ASOUND_WAVE_H
+#define ASOUND_WAVE_H
+
+#include <QMap>
+#include <QList>
+#include <QVector>
+#include <QMutex>
+#include <QString>
+#include <QSharedPointer>
+#include <cstdint>
+#include <cstring>
+
+#include "asound-global.h"
+#include "asound-dsp.h"
+
+class QFile;
+class QByteArray;
+
+
+//-----------------------------------------------------------------------------
+// Структуры формата WAVE
+//-----------------------------------------------------------------------------
+#pragma pack(push, 1)
+/*!
+ * \struct wave_info_header_t
+ * \brief Структура для хранения секции RIFF & WAVE файла
+ */
+struct wave_info_header_t
+{
+    char            chunkId[4];     ///< ID главного фрагмента "RIFF" или "RF64"
+    uint32_t        chunkSize;      ///< Размер первого фрагмента
+    char            format[4];      ///< Формат "WAVE"
+    wave_info_header_t()
+    {
+        strcpy(chunkId, "");
+        chunkSize = 0;
+        strcpy(format, "");
+    }
+};
+/*!
+ * \struct wave_info_t
+ * \brief Структура для хранения данных о wav файле
+ */
+struct wave_info_fmt_t
+{
+
+    char            subchunk1Id[4]; ///< ID первого подфрагмента "fmt"
+    uint32_t        subchunk1Size;  ///< Размер первого подфрагмента
+    short           audioFormat;    ///< Формат сжатия
+    short           numChannels;    ///< Количество каналов
+    uint32_t        sampleRate;     ///< Частота дискретизации (frequency)
+    uint32_t        byteRate;       ///< Байт в секунду
+    short           bytesPerSample; ///< Байт в одном сэмпле (blockAlign)
+    short           bitsPerSample;  ///< Бит в сэмпле
+// Constructor
+    wave_info_fmt_t()
+    {
+        strcpy(subchunk1Id, "");
+        subchunk1Size = 0;
+        audioFormat = 0;
+        numChannels = 0;
+        sampleRate = 0;
+        byteRate = 0;
+        bytesPerSample = 0;
+        bitsPerSample = 0;
+    }
+};
+
+/*!
+ * \struct wave_ds64_t
+ * \brief Структура для хранения фрагмента ds64 (RF64) без "шапки"
+ */
+struct wave_ds64_t
+{
+    uint64_t        riffSize;       ///< Размер фрагмента RF64
+    uint64_t        dataSize;       ///< Размер секции data
+    uint64_t        sampleCount;    ///< Количество отсчётов
+    uint32_t        tableLength;    ///< Количество записей таблицы размеров
+// Конструктор
+    wave_ds64_t()
+    {
+        riffSize = 0;
+        dataSize = 0;
+        sampleCount = 0;
+        tableLength = 0;
+    }
+};
+
+/*!
+ * \struct wave64_chunk_head_t
+ * \brief Структура для хранения "шапки" фрагмента Wave64
+ */
+struct wave64_chunk_head_t
+{
+    unsigned char   guid[16];       ///< GUID фрагмента
+    uint64_t        chunkSize;      ///< Размер фрагмента вместе с "шапкой"
+// Конструктор
+    wave64_chunk_head_t()
+    {
+        memset(guid, 0, sizeof(guid));
+        chunkSize = 0;
+    }
+};
+
+/*!
+ * \struct wave_cue_head_t
+ * \brief Структура для хранения "шапки" фрагмента CUE
+ */
+struct wave_cue_head_t
+{
+    char            cueChunckId[4]; ///< ID фрагмента CUE (4 байта) "0x63756520"
+    uint32_t        cueChunckSize;  ///< Размер фрагмента CUE (4 байта)
+    uint32_t        cueChunckPNum;  ///< Кол-во точек в CUE списке (4 байта)
+// Конструктор
+    wave_cue_head_t()
+    {
+        strcpy(cueChunckId, "");
+        cueChunckSize = 0;
+        cueChunckPNum = 0;
+    }
+};
+
+/*!
+ * \struct wave_cue_data_t
+ * \brief Структура для хранения данных фрагмента CUE
+ */
+struct wave_cue_data_t
+{
+    int32_t         ID;             ///< Уникальный идентификатор cue точки
+    uint32_t        position;       ///< Смещение выборки связанной с точкой cue
+    char            dataChunckId[4];///< "data"
+    uint32_t        chunckStart;    ///< Байтовое смещение в секции списка WAVE
+    uint32_t        blockStart;     ///< Смещение в секции data (начало блока)
+    uint32_t        sampleOffset;   ///< Смещение выборки в секцию data
+// Конструктор
+    wave_cue_data_t()
+    {
+        ID = 0;
+        position = 0;
+        strcpy(dataChunckId, "");
+        chunckStart = 0;
+        blockStart = 0;
+        sampleOffset = 0;
+    }
+};
+
+/*!
+ * \struct wave_list_head_t
+ * \brief Структура для хранения данных "шапки" фрагмента LIST
+ */
+struct wave_list_head_t
+{
+    char            chunckId[4];    ///< "LIST" или "list"
+    uint32_t        dataSize;       ///< Размер фрагмента LIST
+    char            typeID[4];      ///< ID связанного типа данных "adtl"
+// Конструктор
+    wave_list_head_t()
+    {
+        strcpy(chunckId, "");
+        dataSize = 0;
+        strcpy(typeID, "");
+    }
+};
+#pragma pack(pop)
+
+/*!
+ * \struct sound_analysis_t
+ * \brief Результаты анализа PCM данных при загрузке: уровни блоков
+ * (старт, цикл, остановка) и оценки разрыва на стыках зацикливания
+ * (ASoundDSP::seamScore)
+ */
+struct sound_analysis_t
+{
+    bool            valid;          ///< Анализ выполнен
+    sound_level_t   total;          ///< Уровни всего звука
+    sound_level_t   region[BUFFER_BLOCKS]; ///< Уровни блоков
+    float           loopSeam;       ///< Стык цикла по меткам (конец блока цикла - его начало)
+    float           wrapSeam;       ///< Стык зацикливания всего звука (конец - начало)
+// Конструктор
+    sound_analysis_t()
+    {
+        valid = false;
+        loopSeam = 0.0f;
+        wrapSeam = 0.0f;
+    }
+};
+
+/// Формат контейнера WAVE файла
+enum WaveContainer
+{
+    WAVE_RIFF = 0,  ///< Классический RIFF (до 4 Гб)
+    WAVE_RF64 = 1,  ///< RF64 - 64-битные размеры во фрагменте ds64
+    WAVE_W64 = 2    ///< Sony Wave64 - фрагменты с GUID и 64-битным размером
+};
+
+
+//-----------------------------------------------------------------------------
+// Хранилище PCM данных
+//-----------------------------------------------------------------------------
+/*!
+ * \class ASoundStorage
+ * \brief Владелец памяти, в которой лежат блоки PCM данных звука
+ */
+class ASOUNDSHARED_EXPORT ASoundStorage
+{
+public:
+    /// Деструктор
+    virtual ~ASoundStorage();
+};
+
+/*!
+ * \class ASoundHeapStorage
+ * \brief PCM данные в куче (один непрерывный массив на звук)
+ */
+class ASOUNDSHARED_EXPORT ASoundHeapStorage : public ASoundStorage
+{
+public:
+    /// Конструктор
+    explicit ASoundHeapStorage(uint64_t size);
+    /// Деструктор
+    ~ASoundHeapStorage();
+
+    /// Вернуть указатель на данные
+    unsigned char* data();
+
+private:
+    Q_DISABLE_COPY(ASoundHeapStorage)
+
+    /// Данные
+    unsigned char* data_;
+};
+
+/// Выравнивание блоков в пуле PCM данных, байт (строка кэша, SIMD)
+const uint64_t ASOUND_ARENA_ALIGN = 64;
+
+/// Размер страницы пула PCM данных по умолчанию, байт
+const uint64_t DEF_ARENA_SLAB = 16 * 1024 * 1024;
+
+/// Наибольший блок PCM данных, который принимает буфер OpenAL (ALsizei), байт
+const uint64_t ASOUND_MAX_BLOCK = 0x7FFFFFFF;
+
+/*!
+ * \class ASoundArena
+ * \brief Пул PCM данных: крупные выровненные страницы, из которых данные
+ * звуков выделяются подряд без обращения к общей куче. Заводится на банк
+ * или на единицу подвижного состава; память страниц освобождается разом,
+ * когда удалены пул и все звуки, данные которых в нём лежат. Если живых
+ * блоков не осталось, пул начинает заполняться заново с сохранением страниц
+ */
+class ASOUNDSHARED_EXPORT ASoundArena
+{
+public:
+    /// Конструктор
+    explicit ASoundArena(uint64_t slabSize = DEF_ARENA_SLAB);
+    /// Деструктор
+    ~ASoundArena();
+
+    /// Вернуть занятый блоками объём, байт
+    uint64_t getUsed() const;
+
+    /// Вернуть объём страниц, байт
+    uint64_t getReserved() const;
+
+    /*!
+     * \brief Вернуть пул промежуточных данных загрузки текущего потока
+     * (исходные данные перед сведением и ресемплированием). Блоки пула
+     * живут только до конца загрузки, поэтому его страница используется
+     * повторно от звука к звуку, а крупные страницы сразу освобождаются
+     */
+    static QSharedPointer<ASoundArena> scratch();
+
+private:
+    friend class ASoundArenaStorage;
+
+    Q_DISABLE_COPY(ASoundArena)
+
+    /*!
+     * \struct arena_slab_t
+     * \brief Страница пула
+     */
+    struct arena_slab_t
+    {
+        unsigned char*  data;   ///< Начало страницы
+        uint64_t        size;   ///< Размер страницы
+        uint64_t        used;   ///< Занято от начала страницы
+    };
+
+    /// Блокировка (звуки грузятся из разных потоков)
+    mutable QMutex mutex_;
+
+    /// Размер страницы
+    uint64_t slabSize_;
+
+    /// Страницы (заполняется последняя)
+    QVector<arena_slab_t> slabs_;
+
+    /// Количество живых блоков
+    int live_;
+
+    /// Занятый блоками объём
+    uint64_t used_;
+
+    /// Выделить выровненный блок
+    unsigned char* allocate_(uint64_t size);
+
+    /*!
+     * \brief Освободить блок. Память последнего выделенного блока страницы
+     * возвращается сразу, прочая - когда живых блоков не останется; тогда
+     * же освобождаются все страницы, кроме одной страницы обычного размера
+     */
+    void release_(unsigned char* data, uint64_t size);
+};
+
+/*!
+ * \class ASoundArenaStorage
+ * \brief PCM данные в пуле ASoundArena (удерживают пул)
+ */
+class ASOUNDSHARED_EXPORT ASoundArenaStorage : public ASoundStorage
+{
+public:
+    /// Конструктор
+    ASoundArenaStorage(QSharedPointer<ASoundArena> arena, uint64_t size);
+    /// Деструктор
+    ~ASoundArenaStorage();
+
+    /// Вернуть указатель на данные
+    unsigned char* data();
+
+    /// Вернуть пул
+    QSharedPointer<ASoundArena> getArena() const;
+
+private:
+    Q_DISABLE_COPY(ASoundArenaStorage)
+
+    /// Пул
+    QSharedPointer<ASoundArena> arena_;
+
+    /// Данные
+    unsigned char* data_;
+
+    /// Размер данных
+    uint64_t size_;
+};
+
+/*!
+ * \struct sound_pcm_span_t
+ * \brief PCM данные только для чтения без копирования: указатель в общее
+ * хранилище или в отображение банка. Данные живы, пока жив span
+ */
+struct sound_pcm_span_t
+{
+    const unsigned char*    data;       ///< Первый кадр (nullptr - данных нет)
+    uint64_t                frames;     ///< Количество кадров
+    uint32_t                sampleRate; ///< Частота дискретизации, Гц
+    int                     channels;   ///< Количество каналов (отсчёты чередуются)
+    int                     bitsPerSample; ///< Бит в сэмпле (8 - без знака, 16 - со знаком)
+    int                     frameSize;  ///< Байт в кадре
+
+    /// Владелец памяти данных
+    QSharedPointer<ASoundStorage> storage;
+// Конструктор
+    sound_pcm_span_t()
+    {
+        data = nullptr;
+        frames = 0;
+        sampleRate = 0;
+        channels = 0;
+        bitsPerSample = 0;
+        frameSize = 0;
+    }
+};
+
+/*!
+ * \struct ASoundData
+ * \brief Разобранный звук: формат, метки и блоки PCM данных
+ * (старт, цикл, остановка). Не зависит от OpenAL и может разделяться
+ * несколькими источниками
+ */
+struct ASOUNDSHARED_EXPORT ASoundData
+{
+    QString                 name;       ///< Имя звука (путь к файлу)
+    wave_info_fmt_t         info;       ///< Формат данных
+    uint64_t                dataOffset; ///< Смещение секции data в файле
+    uint64_t                dataSize;   ///< Размер секции data, байт
+    QMap<QString, uint64_t> labels;     ///< Метки (имя, смещение в секции data)
+    int                     blocksCount;///< Количество непустых блоков
+    uint64_t                pcmHash;    ///< Свёртка PCM данных (ASoundDSP::hash64)
+    bool                    markersDropped; ///< Маркеры Sony Wave64 не разобраны (метки потеряны)
+    sound_analysis_t        analysis;   ///< Уровни и оценки стыков
+
+    /// Блоки PCM данных (старт, цикл, остановка)
+    const unsigned char*    block[BUFFER_BLOCKS];
+    /// Размеры блоков, байт
+    uint64_t                blockSize[BUFFER_BLOCKS];
+
+    /// Владелец памяти блоков
+    QSharedPointer<ASoundStorage> storage;
+
+    /// Огибающая низких частот (LOAD_ENVELOPE, иначе пустая)
+    QVector<float>          envelope;
+    /// Кадров PCM данных на отсчёт огибающей
+    uint32_t                envelopeStep;
+
+    /// Конструктор
+    ASoundData();
+
+    /*!
+     * \brief Вернуть PCM данные только для чтения без копирования
+     * \param index - номер блока (старт, цикл, остановка), -1 - весь звук
+     * \return данные или пустой span (data == nullptr), если PCM данных нет
+     */
+    sound_pcm_span_t span(int index = -1) const;
+};
+
+
+
+//-----------------------------------------------------------------------------
+// Чтение WAVE файла
+//-----------------------------------------------------------------------------
+/*!
+ * \class AWaveReader
+ * \brief Разбор WAVE файла в ASoundData и обработка данных при загрузке.
+ * Понимает контейнеры RIFF, RF64 и Sony Wave64; смещения и размеры - 64-битные.
+ * Не обращается к OpenAL, поэтому может работать в любом потоке
+ */
+class ASOUNDSHARED_EXPORT AWaveReader
+{
+public:
+    /// Конструктор
+    AWaveReader();
+    /// Деструктор
+    ~AWaveReader();
+
+    /*!
+     * \brief Прочитать WAVE файл
+     * \param soundname - имя аудиофайла (в т.ч. из ресурсов)
+     * \param withData - читать PCM данные (false - только формат и разметка:
+     * блоки и хранилище остаются пустыми, размеры блоков известны)
+     * \return данные звука или пустой указатель при ошибке
+     */
+    QSharedPointer<ASoundData> read(const QString &soundname, bool withData = true);
+
+    /// Вернуть последнюю ошибку
+    QString getLastError() const;
+
+    /// Задать пул для PCM данных (пустой указатель - массив в куче на звук)
+    void setArena(QSharedPointer<ASoundArena> arena);
+
+    /*!
+     * \brief Обработать данные согласно флагам загрузки (ASoundLoadFlag)
+     * \param data - исходные данные (не изменяются)
+     * \param loadFlags - флаги загрузки
+     * \param deviceRate - частота микширования устройства
+     * \param arena - пул для результата; промежуточные данные и исходные
+     * данные из пула потока (ASoundArena::scratch()) в него не попадают
+     * \return обработанные данные, либо исходные, если обработка не нужна
+     */
+    static QSharedPointer<ASoundData> process(QSharedPointer<ASoundData> data,
+                                              int loadFlags, uint32_t deviceRate,
+                                              QSharedPointer<ASoundArena> arena = QSharedPointer<ASoundArena>());
+
+    /*!
+     * \brief Построить упрощённый вариант звука для дальних источников:
+     * моно с частотой дискретизации, пониженной в 2^level раз
+     * (но не ниже ASOUND_LOD_MIN_RATE)
+     * \param data - исходные данные (не изменяются)
+     * \param level - уровень детализации (1 .. ASOUND_LOD_LEVELS - 1)
+     * \param arena - пул для варианта (пустой указатель - куча)
+     * \return вариант или пустой указатель, если упрощать нечего
+     */
+    static QSharedPointer<ASoundData> makeLodVariant(QSharedPointer<ASoundData> data,
+                                                     int level,
+                                                     QSharedPointer<ASoundArena> arena = QSharedPointer<ASoundArena>());
+
+    /*!
+     * \brief Будет ли у звука упрощённый вариант (makeLodVariant). Нужны
+     * только формат и размеры блоков - годится разметка без PCM данных
+     * \param data - данные звука
+     * \param level - уровень детализации (1 .. ASOUND_LOD_LEVELS - 1)
+     */
+    static bool hasLodVariant(const ASoundData &data, int level);
+
+    /// Вернуть пул, в котором лежат данные звука (пустой указатель - не в пуле)
+    static QSharedPointer<ASoundArena> arenaOf(QSharedPointer<ASoundData> data);
+
+private:
+    Q_DISABLE_COPY(AWaveReader)
+
+    // Можно продолжать работу с файлом
+    bool canDo_; ///< Флаг допуска к работе с файлом
+
+    // Имеет-ли файл секцию CUE
+    bool canCUE_; ///< Флаг наличия фрагмента CUE
+
+    // Имеет-ли файл секцию LABL
+    bool canLABL_; ///< Флаг наличия меток в файле
+
+    // Читать ли PCM данные
+    bool withData_; ///< Флаг чтения секции data
+
+    // Последняя ошибка
+    QString lastError_; ///< Текст последней ошибки
+
+    // Переменная для хранения файла
+    QFile* file_; ///< Контейнер файла
+
+    // Пул для PCM данных
+    QSharedPointer<ASoundArena> arena_; ///< Пул (пустой - куча)
+
+    // Информация формата входного звукового файла
+    wave_info_header_t wave_info_header_; ///< Структура информации формата файла [RIFF&&WAVE]
+
+    // Формат контейнера файла
+    int container_; ///< Формат контейнера (WaveContainer)
+
+    // Размер секции data из фрагмента ds64
+    uint64_t ds64DataSize_; ///< Размер секции data для RF64
+
+    // "шапка" списка CUE
+    wave_cue_head_t cue_head_; ///< Структура "шапка" CUE
+
+    // Список меток CUE
+    QList <wave_cue_data_t>cue_data_; ///< Структура информации списка CUE
+
+    // "шапка" списка меток
+    wave_list_head_t list_head_; ///< Структура "шапка" LIST
+
+    /// Загрузка файла (в т.ч. из ресурсов)
+    void loadFile_(const QString &soundname);
+
+    /// Чтение информации о файле .wav
+    void readWaveInfo_(ASoundData &data);
+
+    /// Чтение секции data по разметке из кэша метаданных
+    void readCachedData_(ASoundData &data);
+
+    /// Чтение формата файла
+    void readWaveHeader_();
+
+    /// Чтение "шапки" очередного фрагмента (id - FOURCC, size - размер данных)
+    bool readChunkHead_(char id[4], uint64_t &size);
+
+    /// Позиция фрагмента, следующего за данными с позиции start размером size
+    qint64 nextChunk_(qint64 start, uint64_t size) const;
+
+    /// Чтение фрагмента LIST ("шапки")
+    void readWaveListChunckHeader_(QByteArray &baseStr);
+
+    /// Анализ PCM данных (уровни блоков, стыки цикла); вернёт успешность
+    static bool analyze_(ASoundData &data);
+
+    /// Получение CUE фрагмента
+    void getCUE_(QByteArray &baseStr);
+
+    /// Получение списка меток (Labels)
+    void getLabels_(QByteArray &baseStr, ASoundData &data);
+
+    /// Метод проверки необходимых параметров
+    void checkValue(std::string baseStr, const char targStr[], QString err);
+
+    /// Выделить хранилище PCM данных в пуле или в куче
+    static QSharedPointer<ASoundStorage> allocate_(uint64_t size,
+                                                   QSharedPointer<ASoundArena> arena,
+                                                   unsigned char* &data);
+
+    /// Перенести данные из пула потока в заданный пул
+    static QSharedPointer<ASoundData> toArena_(QSharedPointer<ASoundData> data,
+                                               QSharedPointer<ASoundArena> arena);
+
+    /// Построение огибающей низких частот (PCM данные - общие с исходными)
+    static QSharedPointer<ASoundData> envelope_(QSharedPointer<ASoundData> data);
+
+    /// Сведение стерео в моно
+    static QSharedPointer<ASoundData> downmixToMono_(QSharedPointer<ASoundData> data,
+                                                     QSharedPointer<ASoundArena> arena);
+
+    /// Приведение к частоте микширования устройства
+    static QSharedPointer<ASoundData> resample_(QSharedPointer<ASoundData> data,
+                                                uint32_t dstRate,
+                                                QSharedPointer<ASoundArena> arena);
+};
+
+#endif // ASOUND_WAVE_H
@@ -0,0 +1,204 @@
+//-----------------------------------------------------------------------------
+//
+//      Зоны окружения (тоннели, станции, кабина) на эффектах EFX
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Зоны окружения (тоннели, станции, кабина) на эффектах EFX
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ */
+
+#ifndef ASOUND_ZONE_H
+#define ASOUND_ZONE_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <AL/al.h>
+
+#include "asound-global.h"
+
+class ASound;
+class AListener;
+
+/*!
+ * \struct zone_reverb_t
+ * \brief Параметры реверберации (AL_EFFECT_REVERB), по умолчанию - EFX
+ */
+struct zone_reverb_t
+{
+    float   density;            ///< Плотность отражений (0.0 - 1.0)
+    float   diffusion;          ///< Диффузность (0.0 - 1.0)
+    float   gain;               ///< Уровень (0.0 - 1.0)
+    float   gainHF;             ///< Уровень высоких частот (0.0 - 1.0)
+    float   decayTime;          ///< Время затухания, с
+    float   decayHFRatio;       ///< Отношение затухания высоких частот
+    float   reflectionsGain;    ///< Уровень ранних отражений
+    float   reflectionsDelay;   ///< Задержка ранних отражений, с
+    float   lateReverbGain;     ///< Уровень поздней реверберации
+    float   lateReverbDelay;    ///< Задержка поздней реверберации, с
+
+    zone_reverb_t()
+        : density(1.0f)
+        , diffusion(1.0f)
+        , gain(0.32f)
+        , gainHF(0.89f)
+        , decayTime(1.49f)
+        , decayHFRatio(0.83f)
+        , reflectionsGain(0.05f)
+        , reflectionsDelay(0.007f)
+        , lateReverbGain(1.26f)
+        , lateReverbDelay(0.011f)
+    {
+
+    }
+};
+
+/*!
+ * \struct zone_echo_t
+ * \brief Параметры эха (AL_EFFECT_ECHO), по умолчанию - EFX
+ */
+struct zone_echo_t
+{
+    float   delay;      ///< Задержка первого отражения, с
+    float   lrDelay;    ///< Задержка между левым и правым отражениями, с
+    float   damping;    ///< Затухание высоких частот (0.0 - 0.99)
+    float   feedback;   ///< Обратная связь (0.0 - 1.0)
+    float   spread;     ///< Разнос отражений (-1.0 - 1.0)
+
+    zone_echo_t()
+        : delay(0.1f)
+        , lrDelay(0.1f)
+        , damping(0.5f)
+        , feedback(0.5f)
+        , spread(-1.0f)
+    {
+
+    }
+};
+
+/*!
+ * \class ASoundZone
+ * \brief Зона окружения: один общий вспомогательный слот эффекта EFX
+ * (реверберация или эхо) на устройство вывода, в который звуки зоны
+ * отправляют сигнал посылом. Звук переходит между зонами плавно: старая и
+ * новая зоны занимают два посыла источника, громкости посылов меняются
+ * встречно. Зона может быть задана параллелепипедом - тогда звук
+ * относится к наименьшей зоне, содержащей его положение
+ */
+class ASOUNDSHARED_EXPORT ASoundZone : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Конструктор
+    explicit ASoundZone(QString name, QObject* parent = Q_NULLPTR);
+    /// Деструктор - звуки зоны остаются без эффекта
+    ~ASoundZone();
+
+    /// Вернуть имя зоны
+    QString getName() const;
+
+    /// Использовать реверберацию
+    void setReverb(const zone_reverb_t &reverb);
+
+    /// Использовать эхо
+    void setEcho(const zone_echo_t &echo);
+
+    /// Вернуть громкость эффекта зоны
+    float getGain() const;
+
+    /*!
+     * \brief Задать границы зоны
+     * \param min - минимальные координаты x, y, z
+     * \param max - максимальные координаты x, y, z
+     */
+    void setBox(const float min[3], const float max[3]);
+
+    /// Содержит ли зона точку (зона без границ не содержит ничего)
+    bool contains(float x, float y, float z) const;
+
+    /// Вернуть наименьшую зону, содержащую точку (Q_NULLPTR - нет такой)
+    static ASoundZone* find(float x, float y, float z);
+
+public slots:
+    /// Установить громкость эффекта зоны (AL_EFFECTSLOT_GAIN, 0.0 - 1.0)
+    void setGain(float gain);
+
+private:
+    friend class ASound;
+    friend class AListener;
+    friend class ASoundDeviceMonitor;
+
+    /*!
+     * \struct zone_slot_t
+     * \brief Объекты EFX зоны на устройстве вывода (нули - создать
+     * не удалось, повторно не пытаемся)
+     */
+    struct zone_slot_t
+    {
+        ALuint  slot;       ///< Вспомогательный слот
+        ALuint  effect;     ///< Эффект
+
+        zone_slot_t()
+            : slot(0)
+            , effect(0)
+        {
+
+        }
+    };
+
+    /// Все зоны
+    static QList<ASoundZone*> zones_;
+
+    /// Имя зоны
+    QString name_;
+
+    /// Тип эффекта (AL_EFFECT_REVERB, AL_EFFECT_ECHO)
+    ALenum effectType_;
+
+    /// Параметры реверберации
+    zone_reverb_t reverb_;
+
+    /// Параметры эха
+    zone_echo_t echo_;
+
+    /// Громкость эффекта
+    float gain_;
+
+    /// Заданы ли границы
+    bool hasBox_;
+
+    /// Минимальные координаты
+    float boxMin_[3];
+
+    /// Максимальные координаты
+    float boxMax_[3];
+
+    /// Слоты зоны по устройствам вывода
+    QMap<AListener*, zone_slot_t> slots_;
+
+    /// Звуки, посылающие сигнал в зону
+    QList<ASound*> sounds_;
+
+    /// Слот зоны на устройстве (создаётся при первом обращении; 0 - EFX нет
+    /// или слот создать не удалось)
+    ALuint slot_(AListener* output);
+
+    /// Передать параметры эффекта в слот
+    void applyEffect_(AListener* output, const zone_slot_t &slot);
+
+    /// Передать параметры эффекта во все слоты
+    void applyEffect_();
+
+    /*!
+     * \brief Забыть объекты EFX устройства всех зон
+     * \param destroy - удалить объекты (false - они уже утрачены с контекстом)
+     */
+    static void forgetOutput_(AListener* output, bool destroy);
+};
+
+#endif // ASOUND_ZONE_H
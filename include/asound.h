@@ -18,22 +18,23 @@
 
 #include <QObject>
 #include <QMap>
+#include <QPair>
+#include <QVector>
+#include <QStringList>
 #include <AL/al.h>
 #include <AL/alc.h>
+#include <AL/alext.h>
+#include <AL/efx.h>
 
+#include "asound-global.h"
+#include "asound-wave.h"
 #include "asound-log.h"
+#include "asound-ramp.h"
 
-class QFile;
 class QTimer;
-
-#if defined(ASOUND_LIBRARY)
-#  define ASOUNDSHARED_EXPORT Q_DECL_EXPORT
-#else
-#  define ASOUNDSHARED_EXPORT Q_DECL_IMPORT
-#endif
-
-#define BUFFER_BLOCKS 3
-
+class ASoundBank;
+class ASoundGroup;
+class ASoundZone;
 
 //-----------------------------------------------------------------------------
 // Класс AListener
@@ -45,9 +46,89 @@ const float DEF_LSN_VEL[3] = {0.0f, 0.0f, 0.0f};
 /// Направление слушателя по умолчанию
 const float DEF_LSN_ORI[6] = {0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f};
 
+/// Число уровней заглушения (общих фильтров прямого пути на устройство)
+const int OCCLUSION_LEVELS = 16;
+/// Громкость прямого пути при полном заглушении
+const float OCCLUSION_GAIN = 0.6f;
+/// Громкость высоких частот прямого пути при полном заглушении
+const float OCCLUSION_GAINHF = 0.05f;
+
+/// Способ вывода звука
+enum ASoundBackend
+{
+    BACKEND_OPENAL  = 0,    ///< Устройства OpenAL
+    BACKEND_NULL    = 1     ///< Без вывода: читается только разметка файлов,
+                            ///< состояние воспроизведения рассчитывается по часам
+};
+
+/// Частота микширования устройства без вывода по умолчанию, Гц
+const int DEF_NULL_FREQUENCY = 44100;
+
+/// Целевая громкость выравнивания по умолчанию, LUFS (EBU R128)
+const float DEF_LOUDNESS_TARGET = -23.0f;
+/// Наибольшее усиление при выравнивании громкости
+const float MAX_NORMALIZE_GAIN = 4.0f;
+
+/*!
+ * \struct output_config_t
+ * \brief Параметры контекста устройства вывода (0 - выбор реализации)
+ */
+struct output_config_t
+{
+    /// Частота микширования, Гц (ALC_FREQUENCY)
+    int     frequency;
+    /// Частота обновления микшера, Гц (ALC_REFRESH); период микширования -
+    /// frequency / refresh сэмплов
+    int     refresh;
+    /// Количество моно-источников (ALC_MONO_SOURCES)
+    int     monoSources;
+    /// Количество стерео-источников (ALC_STEREO_SOURCES)
+    int     stereoSources;
+    /// HRTF (ALC_SOFT_HRTF): -1 - выбор реализации, 0 - выключить, 1 - включить
+    int     hrtf;
+    /// Вспомогательных посылов на источник (ALC_MAX_AUXILIARY_SENDS);
+    /// смена зоны окружения плавно переводит звук между двумя посылами
+    int     auxSends;
+
+    output_config_t()
+        : frequency(0)
+        , refresh(0)
+        , monoSources(0)
+        , stereoSources(0)
+        , hrtf(-1)
+        , auxSends(2)
+    {
+
+    }
+};
+
+/*!
+ * \struct efx_functions_t
+ * \brief Функции расширения ALC_EXT_EFX
+ */
+struct efx_functions_t
+{
+    LPALGENEFFECTS                  alGenEffects;
+    LPALDELETEEFFECTS               alDeleteEffects;
+    LPALEFFECTI                     alEffecti;
+    LPALEFFECTF                     alEffectf;
+    LPALGENFILTERS                  alGenFilters;
+    LPALDELETEFILTERS               alDeleteFilters;
+    LPALFILTERI                     alFilteri;
+    LPALFILTERF                     alFilterf;
+    LPALGENAUXILIARYEFFECTSLOTS     alGenAuxiliaryEffectSlots;
+    LPALDELETEAUXILIARYEFFECTSLOTS  alDeleteAuxiliaryEffectSlots;
+    LPALAUXILIARYEFFECTSLOTI        alAuxiliaryEffectSloti;
+    LPALAUXILIARYEFFECTSLOTF        alAuxiliaryEffectSlotf;
+};
+
 /*!
  * \class AListener
- * \brief Класс, реализующий создание единственного слушателя
+ * \brief Класс, реализующий слушателя устройства вывода. getInstance()
+ * возвращает устройство по умолчанию; дополнительные устройства (например,
+ * кабина в наушниках и окружение на колонках) открываются openOutput().
+ * Каждое устройство микширует в собственном потоке OpenAL, разобранные
+ * данные звуков общие для всех устройств (ASoundStore)
  */
 class ASOUNDSHARED_EXPORT AListener
 {   
@@ -55,14 +136,249 @@ public:
     /// Статический метод запрещающий повторное создание экземпляра класса
     static AListener &getInstance();
 
+    /*!
+     * \brief Открыть дополнительное устройство вывода
+     * \param deviceName - имя устройства (из getDeviceNames())
+     * \return слушатель устройства или Q_NULLPTR, если устройство не открыто
+     */
+    static AListener* openOutput(const QString &deviceName,
+                                 const output_config_t &config = output_config_t());
+
+    /*!
+     * \brief Задать параметры устройства по умолчанию. Действует, если
+     * вызвано до первого обращения к getInstance()
+     */
+    static void setDefaultConfig(const output_config_t &config);
+
+    /*!
+     * \brief Выбрать способ вывода звука (ASoundBackend). Действует, если
+     * вызвано до первого обращения к getInstance(); переменная окружения
+     * ASOUND_BACKEND=null выбирает BACKEND_NULL без изменения приложения.
+     * Без вывода устройства не открываются, PCM данные не читаются и не
+     * загружаются, а звуки играют "молча": позиция, окончание и циклы
+     * рассчитываются по длительности и скорости воспроизведения
+     */
+    static void setBackend(int backend);
+
+    /// Вернуть способ вывода звука
+    static int getBackend();
+
+    /*!
+     * \brief Задать модельное время, с. После первого вызова звуки без
+     * вывода отсчитывают воспроизведение по модельному, а не реальному
+     * времени (ускоренный или пошаговый расчёт)
+     */
+    static void setSimTime(double seconds);
+
+    /*!
+     * \brief Закрыть дополнительное устройство вывода. Звуки устройства
+     * должны быть удалены до его закрытия
+     */
+    static void closeOutput(AListener* output);
+
+    /// Вернуть все открытые устройства вывода
+    static QList<AListener*> getOutputs();
+
+    /// Вернуть имена доступных устройств вывода
+    static QStringList getDeviceNames();
+
+    /// Начать пакет изменений на всех устройствах
+    static void deferAllUpdates();
+
+    /// Применить пакеты изменений всех устройств
+    static void processAllUpdates();
+
     ///
     void closeDevices();
 
+    /// Вернуть имя устройства
+    QString getDeviceName() const;
+
+    /*!
+     * \brief Подключено ли устройство (ALC_CONNECTED). Без поддержки
+     * ALC_EXT_disconnect потеря устройства не обнаруживается
+     */
+    bool isConnected() const;
+
+    /*!
+     * \brief Сделать контекст устройства текущим для вызовов OpenAL.
+     * При поддержке ALC_EXT_thread_local_context контекст выбирается только
+     * для вызывающего потока
+     */
+    void makeCurrent();
+
+    /// Установить флаги загрузки, применяемые ко всем создаваемым звукам
+    void setDefaultLoadFlags(int flags);
+
+    /// Вернуть флаги загрузки по умолчанию
+    int getDefaultLoadFlags() const;
+
+    /*!
+     * \brief Выравнивать громкость звуков по интегральной громкости,
+     * измеренной при загрузке. Усиление считается один раз при подготовке
+     * звука и не выводит его пик за полную шкалу; действует на звуки,
+     * создаваемые после вызова
+     * \param enabled - выравнивать ли громкость
+     * \param target - целевая громкость, LUFS
+     */
+    void setNormalization(bool enabled, float target = DEF_LOUDNESS_TARGET);
+
+    /// Выравнивается ли громкость звуков
+    bool isNormalizationEnabled() const;
+
+    /// Вернуть целевую громкость выравнивания, LUFS
+    float getLoudnessTarget() const;
+
+    /// Вернуть частоту микширования устройства (ALC_FREQUENCY), Гц
+    int getFrequency() const;
+
+    /// Вернуть частоту обновления микшера (ALC_REFRESH), Гц
+    int getRefresh() const;
+
+    /// Вернуть запрошенные параметры контекста
+    output_config_t getConfig() const;
+
+    /*!
+     * \brief Изменить параметры работающего устройства (alcResetDeviceSOFT,
+     * ALC_SOFT_HRTF); контекст, буферы и источники сохраняются
+     * \return применены ли параметры
+     */
+    bool configure(const output_config_t &config);
+
+    /// Вернуть количество моно-источников, выделенное устройством
+    int getMonoSources() const;
+
+    /// Вернуть количество стерео-источников, выделенное устройством
+    int getStereoSources() const;
+
+    /// Включён ли HRTF
+    bool isHrtfEnabled() const;
+
+    /*!
+     * \brief Вернуть задержку вывода устройства (ALC_SOFT_device_clock):
+     * время от микширования до выхода звука, с; -1.0 - не поддерживается
+     */
+    double getLatency() const;
+
+    /// Вернуть функции EFX (Q_NULLPTR - ALC_EXT_EFX не поддерживается)
+    const efx_functions_t* getEfx() const;
+
+    /*!
+     * \brief Вернуть часы устройства (ALC_SOFT_device_clock): время,
+     * отмикшированное с открытия устройства, нс; -1 - не поддерживается
+     */
+    qint64 getDeviceClock() const;
+
+    /*!
+     * \brief Начать пакет изменений. До парного processUpdates() изменения
+     * параметров источников копятся и затем применяются микшером разом.
+     * Вызовы могут быть вложенными
+     */
+    void deferUpdates();
+
+    /// Применить накопленный пакет изменений
+    void processUpdates();
+
+    /// Установить положение слушателя
+    void setPosition(float x, float y, float z);
+
+    /// Установить "скорость передвижения" слушателя
+    void setVelocity(float x, float y, float z);
+
+    /*!
+     * \brief Установить направление слушателя
+     * \param orientation - вектор взгляда (at) и вектор "вверх" (up)
+     */
+    void setOrientation(const float orientation[6]);
+
+    /*!
+     * \brief Установить положение, направление и (если задана)
+     * "скорость передвижения" слушателя одним пакетом
+     * \param position - положение
+     * \param orientation - векторы at и up
+     * \param velocity - "скорость передвижения" (Q_NULLPTR - не менять)
+     */
+    void setPose(const float position[3], const float orientation[6],
+                 const float velocity[3] = Q_NULLPTR);
+
+    /*!
+     * \brief Переместить слушателя, вычислив "скорость передвижения"
+     * (для эффекта Доплера) по смещению за шаг времени
+     * \param position - новое положение
+     * \param orientation - векторы at и up
+     * \param dt - время, прошедшее с прошлого положения, с
+     */
+    void movePose(const float position[3], const float orientation[6], float dt);
+
+    /// Вернуть положение слушателя
+    void getPosition(float &x, float &y, float &z) const;
+
+    /// Вернуть "скорость передвижения" слушателя
+    void getVelocity(float &x, float &y, float &z) const;
+
+    /// Вернуть направление слушателя (векторы at и up)
+    void getOrientation(float orientation[6]) const;
+
     LogFileHandler *log_;
 
 private:
-    /// Конструктор (priate!)
-    AListener();
+    friend class ASound;
+    friend class ASoundDeviceMonitor;
+    friend class ASoundZone;
+
+    /*!
+     * \brief Конструктор (priate!)
+     * \param deviceName - имя устройства (пустое - устройство по умолчанию)
+     * \param log - общий журнал (Q_NULLPTR - создать)
+     * \param config - параметры контекста
+     */
+    AListener(const QString &deviceName, LogFileHandler* log,
+              const output_config_t &config);
+
+    /// Открытые устройства вывода
+    static QList<AListener*> outputs_;
+
+    /// Параметры устройства по умолчанию
+    static output_config_t defaultConfig_;
+
+    /// Способ вывода звука (ASoundBackend)
+    static int backend_;
+
+    /// Модельное время, с (отрицательное - не задано)
+    static double simTime_;
+
+    /// Время для расчёта воспроизведения без вывода, с
+    static double backendTime_();
+
+    /// Запрошенные параметры контекста
+    output_config_t config_;
+
+    /// Имя устройства (пустое - устройство по умолчанию)
+    QString deviceName_;
+
+    /// Флаги загрузки по умолчанию (ASoundLoadFlag)
+    int defaultLoadFlags_;
+
+    /// Флаг выравнивания громкости звуков
+    bool normalize_;
+
+    /// Целевая громкость выравнивания, LUFS
+    float loudnessTarget_;
+
+    /// Частота микширования устройства
+    ALCint frequency_;
+
+    /// Частота обновления микшера
+    ALCint refresh_;
+
+    /// Глубина вложенности пакета изменений
+    int deferDepth_;
+
+    /// alDeferUpdatesSOFT (AL_SOFT_deferred_updates), если поддерживается
+    LPALDEFERUPDATESSOFT alDeferUpdatesSOFT_;
+
+    /// alProcessUpdatesSOFT (AL_SOFT_deferred_updates), если поддерживается
+    LPALPROCESSUPDATESSOFT alProcessUpdatesSOFT_;
 
     /// Аудиоустройство
     ALCdevice* device_;
@@ -70,6 +386,90 @@ private:
     /// Контекст OpenAL
     ALCcontext* context_;
 
+    /// alcSetThreadContext (ALC_EXT_thread_local_context), если поддерживается
+    PFNALCSETTHREADCONTEXTPROC alcSetThreadContext_;
+
+    /// alcReopenDeviceSOFT (ALC_SOFT_reopen_device), если поддерживается
+    LPALCREOPENDEVICESOFT alcReopenDeviceSOFT_;
+
+    /// Поддерживается ли ALC_EXT_disconnect
+    bool disconnectExt_;
+
+    /// alcResetDeviceSOFT (ALC_SOFT_HRTF), если поддерживается
+    LPALCRESETDEVICESOFT alcResetDeviceSOFT_;
+
+    /// alcGetInteger64vSOFT (ALC_SOFT_device_clock), если поддерживается
+    LPALCGETINTEGER64VSOFT alcGetInteger64vSOFT_;
+
+    /// alGetSourcedvSOFT (AL_SOFT_source_latency), если поддерживается
+    LPALGETSOURCEDVSOFT alGetSourcedvSOFT_;
+
+    /// alGetSourcei64vSOFT (AL_SOFT_source_latency), если поддерживается
+    LPALGETSOURCEI64VSOFT alGetSourcei64vSOFT_;
+
+    /// alBufferCallbackSOFT (AL_SOFT_callback_buffer), если поддерживается
+    LPALBUFFERCALLBACKSOFT alBufferCallbackSOFT_;
+
+    /// Функции EFX
+    efx_functions_t efx_;
+
+    /// Поддерживается ли ALC_EXT_EFX
+    bool efxSupported_;
+
+    /// Фильтр для задания громкости посылов (параметры копируются источником)
+    ALuint sendFilter_;
+
+    /// Число посылов источника, выделенное устройством
+    ALCint auxSends_;
+
+    /// Фильтры прямого пути по уровням заглушения (уровень 0 - без фильтра)
+    ALuint occlusionFilters_[OCCLUSION_LEVELS];
+
+    /*!
+     * \struct pcm_block_t
+     * \brief Блок PCM данных общего буфера. Формат и частота входят в ключ:
+     * пустые блоки звуков без меток совпадают по адресу и размеру, а очередь
+     * источника не может смешивать форматы и частоты
+     */
+    struct pcm_block_t
+    {
+        const unsigned char*    pcm;    ///< Начало данных
+        uint64_t                size;   ///< Размер, байт
+        ALenum                  format; ///< Формат OpenAL
+        ALsizei                 rate;   ///< Частота дискретизации, Гц
+
+        /// Порядок ключей QMap
+        bool operator<(const pcm_block_t &other) const
+        {
+            if (pcm != other.pcm)
+                return pcm < other.pcm;
+
+            if (size != other.size)
+                return size < other.size;
+
+            if (format != other.format)
+                return format < other.format;
+
+            return rate < other.rate;
+        }
+    };
+
+    /*!
+     * \struct shared_buffer_t
+     * \brief Буфер, общий для источников с одними и теми же PCM данными
+     */
+    struct shared_buffer_t
+    {
+        ALuint  buffer; ///< Буфер OpenAL
+        int     refs;   ///< Количество пользователей
+    };
+
+    /// Общие буферы по блокам PCM данных
+    QMap<pcm_block_t, shared_buffer_t> buffers_;
+
+    /// Блоки PCM данных общих буферов
+    QMap<ALuint, pcm_block_t> bufferBlocks_;
+
     /// Положение слушателя
     ALfloat listenerPosition_[3];
 
@@ -79,137 +479,49 @@ private:
     /// Направление слушателя
     ALfloat listenerOrientation_[6];
 
-};
+    /// Изменённые и ещё не переданные в OpenAL параметры слушателя
+    int listenerDirty_;
 
+    /// Передать в OpenAL изменённые параметры слушателя
+    void flushListener_();
 
+    /*!
+     * \brief Настроить созданный контекст: расширения, частоты, слушатель
+     * \param processWide - сделать контекст текущим для всего процесса
+     */
+    void setupContext_(bool processWide);
 
-//-----------------------------------------------------------------------------
-// Класс ASound
-//-----------------------------------------------------------------------------
-#pragma pack(push, 1)
-/*!
- * \struct wave_info_header_t
- * \brief Структура для хранения секции RIFF & WAVE файла
- */
-struct wave_info_header_t
-{
-    char            chunkId[4];     ///< ID главного фрагмента "RIFF"
-    uint32_t        chunkSize;      ///< Размер первого фрагмента
-    char            format[4];      ///< Формат "WAVE"
-    wave_info_header_t()
-    {
-        strcpy(chunkId, "");
-        chunkSize = 0;
-        strcpy(format, "");
-    }
-};
-/*!
- * \struct wave_info_t
- * \brief Структура для хранения данных о wav файле
- */
-struct wave_info_fmt_t
-{
+    /// Список атрибутов контекста по параметрам (завершается нулём)
+    QVector<ALCint> attributes_() const;
 
-    char            subchunk1Id[4]; ///< ID первого подфрагмента "fmt"
-    uint32_t        subchunk1Size;  ///< Размер первого подфрагмента
-    short           audioFormat;    ///< Формат сжатия
-    short           numChannels;    ///< Количество каналов
-    uint32_t        sampleRate;     ///< Частота дискретизации (frequency)
-    uint32_t        byteRate;       ///< Байт в секунду
-    short           bytesPerSample; ///< Байт в одном сэмпле (blockAlign)
-    short           bitsPerSample;  ///< Бит в сэмпле
-// Constructor
-    wave_info_fmt_t()
-    {
-        strcpy(subchunk1Id, "");
-        subchunk1Size = 0;
-        audioFormat = 0;
-        numChannels = 0;
-        sampleRate = 0;
-        byteRate = 0;
-        bytesPerSample = 0;
-        bitsPerSample = 0;
-    }
-};
+    /// Получить функции EFX и создать общие объекты EFX контекста
+    void loadEfx_();
 
-/*!
- * \struct wave_info_file_data_t
- * \brief Структура для хранения данных "data" WAVE файла
- */
-struct wave_info_file_data_t
-{
-    char            subchunk2Id[4]; ///< ID второго субфрагмента "data"
-    uint32_t        subchunk2Size;  ///< Размер дорожки
-// Constructor
-    wave_info_file_data_t()
-    {
-        strcpy(subchunk2Id, "");
-        subchunk2Size = 0;
-    }
-};
+    /*!
+     * \brief Получить общий буфер блока PCM данных (создаётся при первом
+     * обращении). Данные одинакового содержимого разделяются хранилищем,
+     * поэтому блок определяется адресом, размером, форматом и частотой
+     * \return буфер или 0 при ошибке
+     */
+    ALuint acquireBuffer_(const unsigned char* pcm, uint64_t size,
+                          ALenum format, ALsizei rate);
 
-/*!
- * \struct wave_cue_head_t
- * \brief Структура для хранения "шапки" фрагмента CUE
- */
-struct wave_cue_head_t
-{
-    char            cueChunckId[4]; ///< ID фрагмента CUE (4 байта) "0x63756520"
-    uint32_t        cueChunckSize;  ///< Размер фрагмента CUE (4 байта)
-    uint32_t        cueChunckPNum;  ///< Кол-во точек в CUE списке (4 байта)
-// Конструктор
-    wave_cue_head_t()
-    {
-        strcpy(cueChunckId, "");
-        cueChunckSize = 0;
-        cueChunckPNum = 0;
-    }
-};
+    /// Освободить общие буферы (удаляются с последним пользователем)
+    void releaseBuffers_(const ALuint* buffers, int count);
 
-/*!
- * \struct wave_cue_data_t
- * \brief Структура для хранения данных фрагмента CUE
- */
-struct wave_cue_data_t
-{
-    int32_t         ID;             ///< Уникальный идентификатор cue точки
-    uint32_t        position;       ///< Смещение выборки связанной с точкой cue
-    char            dataChunckId[4];///< "data"
-    uint32_t        chunckStart;    ///< Байтовое смещение в секции списка WAVE
-    uint32_t        blockStart;     ///< Смещение в секции data (начало блока)
-    uint32_t        sampleOffset;   ///< Смещение выборки в секцию data
-// Конструктор
-    wave_cue_data_t()
-    {
-        ID = 0;
-        position = 0;
-        strcpy(dataChunckId, "");
-        chunckStart = 0;
-        blockStart = 0;
-        sampleOffset = 0;
-    }
+    /*!
+     * \brief Переоткрыть устройство
+     * \param rebuilt - контекст пересоздан (буферы и источники утрачены)
+     * \return удалось ли открыть устройство
+     */
+    bool reopen_(bool &rebuilt);
 };
 
-/*!
- * \struct wave_list_head_t
- * \brief Структура для хранения данных "шапки" фрагмента LIST
- */
-struct wave_list_head_t
-{
-    char            chunckId[4];    ///< "LIST" или "list"
-    uint32_t        dataSize;       ///< Размер фрагмента LIST
-    char            typeID[4];      ///< ID связанного типа данных "adtl"
-// Конструктор
-    wave_list_head_t()
-    {
-        strcpy(chunckId, "");
-        dataSize = 0;
-        strcpy(typeID, "");
-    }
-};
-#pragma pack(pop)
 
 
+//-----------------------------------------------------------------------------
+// Класс ASound
+//-----------------------------------------------------------------------------
 /// Скорость воспроизведения источника по умолчанию
 const float DEF_SRC_PITCH = 1.0f;
 
@@ -220,6 +532,9 @@ const int DEF_SRC_VOLUME  = 100;
 /// Максимальная громкость источника
 const int MAX_SRC_VOLUME  = 100;
 
+/// Оценка разрыва на стыке цикла, начиная с которой стык считается щелчком
+const float LOOP_SEAM_WARNING = 8.0f;
+
 /// Положение источника по умолчанию
 const float DEF_SRC_POS[3] = {0.0f, 0.0f, 1.0f};
 /// "Скорость передвижения" источника по умолчанию
@@ -239,14 +554,50 @@ public:
     /*!
      * \brief Конструктор
      * \param soundname - имя аудиофайла
+     * \param loadFlags - флаги обработки при загрузке (ASoundLoadFlag),
+     * объединяются с флагами по умолчанию слушателя
+     * \param output - устройство вывода (Q_NULLPTR - по умолчанию)
      */
-    ASound(QString soundname, QObject* parent = Q_NULLPTR);
+    ASound(QString soundname, QObject* parent = Q_NULLPTR,
+           int loadFlags = LOAD_DEFAULT, AListener* output = Q_NULLPTR);
+    /*!
+     * \brief Конструктор из записи банка звуков
+     * \param bank - открытый банк звуков
+     * \param soundname - имя звука в банке
+     * \param loadFlags - флаги обработки при загрузке (ASoundLoadFlag)
+     * \param output - устройство вывода (Q_NULLPTR - по умолчанию)
+     */
+    ASound(ASoundBank* bank, QString soundname, QObject* parent = Q_NULLPTR,
+           int loadFlags = LOAD_DEFAULT, AListener* output = Q_NULLPTR);
     /// Деструктор
     ~ASound();
 
     /// Вернуть громкость
     int getVolume();
 
+    /// Вернуть громкость (0.0 - 1.0)
+    float getGain();
+
+    /// Вернуть усиление выравнивания громкости (1.0 - не выравнивается)
+    float getNormalizationGain();
+
+    /// Вернуть результаты анализа данных звука при загрузке
+    sound_analysis_t getAnalysis();
+
+    /*!
+     * \brief Вернуть PCM данные звука только для чтения без копирования
+     * (общие с хранилищем звуков или отображением банка). Данные исходного
+     * уровня детализации; живы, пока жив возвращённый span
+     * \param block - номер блока (старт, цикл, остановка), -1 - весь звук
+     */
+    sound_pcm_span_t getPcm(int block = -1);
+
+    /// Вернуть огибающую низких частот (пустая, если звук загружен без LOAD_ENVELOPE)
+    QVector<float> getEnvelope();
+
+    /// Вернуть частоту отсчётов огибающей низких частот, Гц (0 - огибающей нет)
+    float getEnvelopeRate();
+
     /// Вернуть скорость воспроизведения
     float getPitch();
 
@@ -271,9 +622,106 @@ public:
     /// Приостановлен ли звук
     bool isPaused();
 
-    /// Длительность звука в секундах
+    /// Длительность звука, мс
     int getDuration();
 
+    /// Длительность звука, сэмплов исходного звука (без учёта детализации)
+    qint64 getDurationFrames();
+
+    /// Длительность звука, с
+    double getDurationSeconds();
+
+    /*!
+     * \brief Позиция воспроизведения, сэмплов: сэмпл, звучащий на выходе
+     * устройства в данный момент (с поправкой на задержку вывода по
+     * AL_SAMPLE_OFFSET_LATENCY_SOFT, если расширение поддерживается).
+     * Отсчитывается в сэмплах исходного звука, как и данные getPcm(), на
+     * каком бы уровне детализации звук ни играл
+     */
+    qint64 getPositionFrames();
+
+    /// Позиция воспроизведения с поправкой на задержку вывода, с
+    double getPositionSeconds();
+
+    /*!
+     * \brief Позиция воспроизведения и часы устройства, прочитанные
+     * одновременно (AL_SAMPLE_OFFSET_CLOCK_SOFT). Для синхронизации внешних
+     * устройств: позиция прозвучит в момент clock + AListener::getLatency()
+     * \param seconds - позиция воспроизведения, с
+     * \param clock - часы устройства, нс
+     * \return поддерживается ли ALC_SOFT_device_clock
+     */
+    bool getPositionClock(double &seconds, qint64 &clock);
+
+    /// Вернуть устройство вывода звука
+    AListener* getOutput() const;
+
+    /*!
+     * \brief Вернуть задержку от текущей позиции воспроизведения до выхода
+     * звука из устройства (AL_SEC_OFFSET_LATENCY_SOFT), с; -1.0 - не
+     * поддерживается
+     */
+    double getLatency();
+
+    /// Вернуть зону окружения звука
+    ASoundZone* getZone() const;
+
+    /// Вернуть заглушение прямого пути (0.0 - 1.0)
+    float getOcclusion() const;
+
+    /*!
+     * \brief Отнести звуки к зонам по их положению (ASoundZone::find) -
+     * пакетно, одним отложенным обновлением на устройство
+     * \param sounds - звуки
+     * \param count - число звуков
+     * \param ms - длительность перехода для сменивших зону, мс
+     */
+    static void assignZones(ASound* const* sounds, int count, int ms);
+
+    /*!
+     * \brief Включить звук в группу (или исключить из группы - Q_NULLPTR).
+     * Громкость и скорость звука умножаются на итоговые множители группы,
+     * пауза группы приостанавливает звук
+     */
+    void setGroup(ASoundGroup* group);
+
+    /// Вернуть группу звука
+    ASoundGroup* getGroup() const;
+
+    /*!
+     * \brief Установить приоритет звука. Для выбора уровня детализации
+     * расстояние до слушателя делится на (1 + приоритет), так что важные
+     * звуки дольше остаются в полном качестве
+     */
+    void setPriority(int priority);
+
+    /// Вернуть приоритет звука
+    int getPriority() const;
+
+    /// Вернуть текущий уровень детализации (0 - исходный звук)
+    int getLodLevel() const;
+
+    /// Вернуть количество уровней детализации звука
+    int getLodCount() const;
+
+    /*!
+     * \brief Обновить параметры множества звуков за один проход. Массивы
+     * параллельны массиву звуков; неизменившиеся значения пропускаются,
+     * все изменения применяются одним пакетом
+     * \param sounds - звуки
+     * \param count - количество звуков
+     * \param positions - положения, count троек x, y, z (или Q_NULLPTR)
+     * \param velocities - "скорости передвижения", count троек (или Q_NULLPTR)
+     * \param gains - громкости 0.0 - 1.0 (или Q_NULLPTR)
+     * \param pitches - скорости воспроизведения (или Q_NULLPTR)
+     * \param occlusions - заглушения 0.0 - 1.0 (или Q_NULLPTR)
+     * \return количество изменённых звуков
+     */
+    static int updateMany(ASound* const* sounds, int count,
+                          const float* positions, const float* velocities,
+                          const float* gains, const float* pitches,
+                          const float* occlusions = Q_NULLPTR);
+
     void setLastError(const std::string& value)
     {
         LastError_ = "E - " + QString::fromStdString(value);
@@ -285,12 +733,46 @@ public slots:
     /// Установить громкость
     void setVolume(int volume = 100);
 
+    /// Установить громкость (0.0 - 1.0)
+    void setGain(float gain);
+
     /// Установить скорости воспроизведения
     void setPitch(float pitch);
 
+    /*!
+     * \brief Плавно изменить громкость. Промежуточные значения подаёт
+     * общий для всех звуков таймер с периодом обновления микшера
+     * \param target - конечная громкость (0.0 - 1.0)
+     * \param ms - длительность изменения, мс
+     * \param curve - закон изменения (ASoundRampCurve)
+     */
+    void rampGain(float target, int ms, int curve = RAMP_LINEAR);
+
+    /// Плавно изменить громкость (0 - 100)
+    void rampVolume(int target, int ms, int curve = RAMP_LINEAR);
+
+    /// Плавно изменить скорость воспроизведения
+    void rampPitch(float target, int ms, int curve = RAMP_LINEAR);
+
     /// Установить зацикливание
     void setLoop(bool loop);
 
+    /*!
+     * \brief Установить заглушение прямого пути (звук снаружи кабины).
+     * Складывается с заглушением группы; источник получает общий фильтр
+     * ближайшего уровня заглушения
+     * \param occlusion - заглушение (0.0 - нет, 1.0 - полное)
+     */
+    void setOcclusion(float occlusion);
+
+    /*!
+     * \brief Перевести звук в зону окружения. Посыл в прежнюю зону плавно
+     * затухает, в новую - нарастает
+     * \param zone - зона (Q_NULLPTR - без эффекта)
+     * \param ms - длительность перехода, мс (0 - сразу)
+     */
+    void setZone(ASoundZone* zone, int ms = 0);
+
     /// Установить положение
     void setPosition(float x, float y, float z);
 
@@ -317,21 +799,70 @@ private slots:
     /// Слот обработки таймера уничтожения у звука блока старта
     void onTimerStartKiller();
 
+    /// Слот обработки таймера границы прохода при смене детализации
+    void onTimerLodBoundary();
+
+
+protected:
+    /*!
+     * \brief Конструктор источника без аудиофайла (для генераторов звука);
+     * источник создаётся вызовом setupStream_()
+     * \param output - устройство вывода (Q_NULLPTR - по умолчанию)
+     */
+    ASound(QObject* parent, AListener* output);
+
+    /*!
+     * \brief Создать источник, буфер которого наполняет микшер через
+     * обратный вызов (AL_SOFT_callback_buffer). Обратный вызов выполняется
+     * в потоке микшера
+     * \param format - формат данных OpenAL
+     * \param rate - частота дискретизации, Гц
+     * \param callback - функция наполнения буфера
+     * \param userptr - её аргумент
+     * \return создан ли источник
+     */
+    bool setupStream_(ALenum format, ALsizei rate,
+                      ALBUFFERCALLBACKTYPESOFT callback, void* userptr);
+
+    /// Удалить источник генератора: после возврата обратный вызов не выполняется
+    void releaseStream_();
+
 
 private:
 
+    friend class ASoundGroup;
+    friend class ASoundRamper;
+    friend class ASoundLodManager;
+    friend class ASoundDeviceMonitor;
+    friend class ASoundZone;
+    friend class ASoundReloader;
+
+    /*!
+     * \struct lod_variant_t
+     * \brief Вариант звука для уровня детализации
+     */
+    struct lod_variant_t
+    {
+        QSharedPointer<ASoundData>  data;   ///< Данные варианта
+        ALuint  buffer[BUFFER_BLOCKS];      ///< Буферы OpenAL
+        ALenum  format;                     ///< Формат аудио
+    };
+
+    // Устройство вывода
+    AListener* listener_; ///< Слушатель устройства, на котором звучит источник
+
     // Можно продолжать работу с файлом
     bool canDo_; ///< Флаг допуска к работе с файлом
 
     // Можно играть звук
     bool canPlay_; ///< Флаг допуска к воспроизведению звука
 
-    // Имеет-ли файл секцию CUE
-    bool canCUE_; ///< Флаг наличия фрагмента CUE
-
     // Имеет-ли файл секцию LABL
     bool canLABL_; ///< Флаг наличия меток в файле
 
+    // Флаги обработки при загрузке
+    int loadFlags_; ///< Флаги обработки при загрузке (ASoundLoadFlag)
+
     // Размер чанка блока date при квази-потоковом воспроизведении
     ALsizei DATA_CHUNK_SIZE;
 
@@ -341,35 +872,8 @@ private:
     // Последняя ошибка
     QString lastError_; ///< Текс последней ошибки
 
-    // Переменная для хранения файла
-    QFile* file_; ///< Контейнер файла
-
-    // Информация формата входного звукового файла
-    wave_info_header_t wave_info_header_; ///< Структура информации формата файла [RIFF&&WAVE]
-
-    // Информация о файле .wav
-    wave_info_fmt_t wave_info_; ///< Структура информации о файле
-
-    // Секция data в WAVE файле
-    wave_info_file_data_t wave_info_file_data_; ///< Структура информации секции data
-
-    // "шапка" списка CUE
-    wave_cue_head_t cue_head_; ///< Структура "шапка" CUE
-
-    // Список меток CUE
-    QList <wave_cue_data_t>cue_data_; ///< Структура информации списка CUE
-
-    // "шапка" списка меток
-    wave_list_head_t list_head_; ///< Структура "шапка" LIST
-
-    // Список меток labels (имя, смещение в секции data)
-    QMap<QString, uint64_t> wave_labels_; ///< Список меток
-
-    // Хранилище для data секции (самой музыки) файла .wav
-    unsigned char* wavData_[BUFFER_BLOCKS]; ///< Контейнер секций блока данных файла wav
-
-    // Размер каждого из 3-х блоков данных фай
-    uint64_t blockSize_[BUFFER_BLOCKS]; ///< Размер блоков данных файла wav
+    // Данные звука (формат, метки, блоки старт/цикл/остановка)
+    QSharedPointer<ASoundData> data_; ///< Разобранные данные звука
 
     // Буфер OpenAL
     ALuint  buffer_[BUFFER_BLOCKS]; ///< Буфер OpenAL 3 секции (старт, цикл, остановка)
@@ -381,7 +885,7 @@ private:
     ALenum  format_; ///< Формат аудио (mono8/16 - stereo8/16) OpenAL
 
     // Громкость
-    int sourceVolume_; ///< Громкость
+    ALfloat sourceGain_; ///< Громкость (0.0 - 1.0)
 
     // Скорости воспроизведения
     ALfloat sourcePitch_; ///< Скорость воспроизведения
@@ -398,47 +902,207 @@ private:
     /// Таймер для стирания в звуке блока старта
     QTimer* timerStartKiller_;
 
+    /// Группа звука
+    ASoundGroup* group_;
+
+    /// Приоритет звука
+    int priority_;
+
+    /// Варианты звука по уровням детализации (пусто - вариантов нет)
+    QVector<lod_variant_t> lods_;
+
+    /// Текущий уровень детализации
+    int currentLod_;
+
+    /// Уровень, ожидающий границы цикла (-1 - нет)
+    int pendingLod_;
+
+    /// Уровень, на который звук перейдёт в конце текущего прохода (-1 - нет)
+    int queuedLod_;
+
+    /// Буферы уровня queuedLod_ уже стоят в очереди источника
+    bool lodChained_;
+
+    /// Таймер конца прохода цикла при смене детализации
+    QTimer* timerLodBoundary_;
+
+    /// Состояние источника при последнем сохранении
+    ALint savedState_;
+
+    /// Позиция воспроизведения при последнем сохранении, сэмплов
+    ALint savedOffset_;
+
+    /// Момент последнего сохранения по часам ASoundDeviceMonitor, мс
+    qint64 savedAt_;
+
+    /// Частота дискретизации генератора, Гц
+    ALsizei streamRate_;
+
+    /// Функция наполнения буфера генератора
+    ALBUFFERCALLBACKTYPESOFT streamCallback_;
+
+    /// Аргумент функции наполнения
+    void* streamUser_;
+
     /// Last error in asound
     QString LastError_;
 
-    /// Полная подготовка файла
-    void loadSound_(QString soundname);
+    /// Общая инициализация конструкторов
+    void init_();
 
-    /// Загрузка файла (в т.ч. из ресурсов)
-    void loadFile_(QString soundname);
+    /// Сделать текущим контекст устройства звука
+    void select_();
 
-    /// Чтение информации о файле .wav
-    void readWaveInfo_();
-
-    /// Чтение формата файла
-    void readWaveHeader_();
+    /// Полная подготовка файла
+    void loadSound_(QString soundname);
 
-    /// Чтение данных формата и секции data
-    void readWaveFmtData_(QByteArray arr);
+    /// Подготовка источника по загруженным данным
+    void setupSound_(ASoundBank* bank = Q_NULLPTR);
 
-    /// Чтение фрагмента LIST ("шапки")
-    void readWaveListChunckHeader_(QByteArray &baseStr);
+    /// Вывод в журнал информации о загруженных данных
+    void logSoundInfo_();
 
     /// Определение формата аудио (mono8/16 - stereo8/16)
     void defineFormat_();
 
-    /// Получение CUE фрагмента
-    void getCUE_(QByteArray &baseStr);
-
-    /// Получение списка меток (Labels)
-    void getLabels_(QByteArray &baseStr);
-
     /// Генерация буфера и источника
     void generateStuff_();
 
     /// Настройка источника
     void configureSource_();
 
-    /// Метод проверки необходимых параметров
-    void checkValue(std::string baseStr, const char targStr[], QString err);
+    /// Плавное изменение громкости
+    ASoundRamp gainRamp_;
+
+    /// Плавное изменение скорости воспроизведения
+    ASoundRamp pitchRamp_;
+
+    /// Зона окружения (посыл 0)
+    ASoundZone* zone_;
+
+    /// Покидаемая зона на время перехода (посыл 1)
+    ASoundZone* prevZone_;
+
+    /// Доля новой зоны в переходе (0.0 - 1.0)
+    float zoneMix_;
+
+    /// Плавный переход между зонами
+    ASoundRamp zoneRamp_;
+
+    /// Передать посылы в слоты зон
+    void applyZoneSends_();
+
+    /// Отсоединиться от удаляемой зоны
+    void leaveZone_(ASoundZone* zone);
+
+    /// Усиление выравнивания громкости (AListener::setNormalization)
+    float normGain_;
+
+    /// Рассчитать усиление выравнивания по результатам анализа данных
+    void updateNormGain_();
+
+    /// Данные исходного уровня детализации
+    QSharedPointer<ASoundData> baseData_() const;
+
+    /// Итоговая громкость источника с учётом группы и выравнивания (AL_GAIN)
+    ALfloat effectiveGain_() const;
+
+    /// Итоговая скорость воспроизведения с учётом группы (AL_PITCH)
+    ALfloat effectivePitch_() const;
+
+    /// Заглушение прямого пути
+    float occlusion_;
+
+    /// Уровень заглушения, заданный источнику (-1 - не задан)
+    int occlusionLevel_;
+
+    /// Итоговое заглушение с учётом группы
+    float effectiveOcclusion_() const;
+
+    /// Назначить источнику фильтр уровня заглушения, если уровень сменился
+    void applyOcclusion_();
+
+    /// Позиция воспроизведения с поправкой на задержку вывода, сэмплов
+    double playbackFrames_();
+
+    /// Продвинуть плавные изменения; возвращает, остались ли активные
+    bool advanceRamps_(qint64 now);
+
+    /// Построить варианты уровней детализации (из банка или из данных звука)
+    void buildLods_(ASoundBank* bank);
+
+    /// Запросить уровень детализации (переключение - на границе цикла)
+    void requestLod_(int level);
+
+    /// Проверить прохождение границы цикла для отложенного переключения
+    void pollLod_();
+
+    /// Переключить источник на вариант уровня детализации
+    void switchLod_(int level, bool toLoopStart);
+
+    /// Доиграть текущий проход цикла и перейти на уровень в его конце
+    void queueLod_(int level);
+
+    /// Завершить переход на уровень, если проход цикла доигран
+    void finishLod_();
+
+    /// Отменить переход на уровень в конце прохода
+    void cancelLod_();
+
+    /// Завести таймер на конец текущего прохода
+    void armLodBoundary_();
+
+    /// Создать и заполнить буферы варианта детализации
+    bool uploadLod_(lod_variant_t &lod);
+
+    /// Запомнить состояние и позицию воспроизведения источника
+    void saveState_(qint64 now);
+
+    /*!
+     * \brief Восстановить звук после переоткрытия устройства
+     * \param now - текущее время по часам ASoundDeviceMonitor, мс
+     * \param rebuild - контекст пересоздан: заново создать буферы и источник
+     */
+    void restoreState_(qint64 now, bool rebuild);
+
+    /*!
+     * \brief Заменить данные звука перечитанными с диска, сохранив
+     * состояние и позицию воспроизведения
+     * \param data - новые данные
+     * \param now - текущее время, мс (любые часы)
+     */
+    void swapData_(QSharedPointer<ASoundData> data, qint64 now);
+
+    /// Звук без вывода (BACKEND_NULL): источника нет, состояние расчётное
+    bool stub_;
+
+    /// Расчётное состояние источника (AL_INITIAL, AL_PLAYING, ...)
+    ALint stubState_;
+
+    /// Расчётная позиция воспроизведения, сэмплов
+    double stubFrames_;
+
+    /// Момент последнего пересчёта позиции по AListener::backendTime_(), с
+    double stubAt_;
+
+    /// Скорость воспроизведения, действующая с последнего пересчёта
+    ALfloat stubPitch_;
+
+    /// Звук с метками крутит блок цикла (до stop())
+    bool stubLooping_;
+
+    /// Досчитать расчётную позицию до текущего момента
+    void stubAdvance_();
+
+    /// Запустить, приостановить или остановить источник (AL_PLAYING,
+    /// AL_PAUSED, AL_STOPPED); без вывода - сменить расчётное состояние
+    void setSourceState_(ALint state);
+
+    /// Передать источнику итоговую скорость воспроизведения
+    void applyPitch_();
 
-    /// Подпрограмма очистки контейнеров данных дорожки
-    void deleteWAVEDataContainers();
+    /// Формат OpenAL для формата данных (0 - не поддерживается)
+    static ALenum alFormat_(const wave_info_fmt_t &info);
 };
 
 
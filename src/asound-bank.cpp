@@ -0,0 +1,501 @@
+//-----------------------------------------------------------------------------
+//
+//      Банк звуков - единый файл с индексом и PCM данными
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-bank.h"
+#include <QDir>
+#include <QFile>
+#include <QByteArray>
+
+//-----------------------------------------------------------------------------
+// Хранилище - отображение файла банка в память
+//-----------------------------------------------------------------------------
+class ASoundBankStorage : public ASoundStorage
+{
+public:
+    /// Конструктор
+    explicit ASoundBankStorage(const QString &bankname)
+        : data_(nullptr)
+        , size_(0)
+    {
+        file_.setFileName(bankname);
+
+        if (file_.open(QIODevice::ReadOnly))
+        {
+            size_ = file_.size();
+            data_ = file_.map(0, size_);
+        }
+    }
+
+    /// Деструктор
+    ~ASoundBankStorage()
+    {
+        if (data_ != nullptr)
+            file_.unmap(data_);
+        file_.close();
+    }
+
+    /// Вернуть начало отображения
+    const unsigned char* data() const { return data_; }
+
+    /// Вернуть размер отображения
+    qint64 size() const { return size_; }
+
+private:
+    Q_DISABLE_COPY(ASoundBankStorage)
+
+    /// Файл банка
+    QFile file_;
+
+    /// Отображение файла
+    unsigned char* data_;
+
+    /// Размер файла
+    qint64 size_;
+};
+
+
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundBank::ASoundBank(const QString &bankname)
+    : storage_(new ASoundBankStorage(bankname))
+{
+    if (storage_->data() == nullptr)
+    {
+        lastError_ = "CANT_MAP_BANK: ";
+        lastError_.append(bankname);
+        storage_.clear();
+        return;
+    }
+
+    if (!readIndex_())
+    {
+        lastError_.append(bankname);
+        storage_.clear();
+        index_.clear();
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundBank::~ASoundBank()
+{
+
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Открыт ли банк
+//-----------------------------------------------------------------------------
+bool ASoundBank::isOpen() const
+{
+    return !storage_.isNull();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть последнюю ошибку
+//-----------------------------------------------------------------------------
+QString ASoundBank::getLastError() const
+{
+    return lastError_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть имена всех звуков банка
+//-----------------------------------------------------------------------------
+QStringList ASoundBank::getNames() const
+{
+    QStringList names;
+
+    QMap<QString, int>::const_iterator it = index_.constBegin();
+    while (it != index_.constEnd())
+    {
+        names.append(it.key());
+        ++it;
+    }
+
+    return names;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Есть ли звук в банке
+//-----------------------------------------------------------------------------
+bool ASoundBank::contains(const QString &soundname) const
+{
+    return index_.contains(QDir::fromNativeSeparators(soundname));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть данные звука
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> ASoundBank::getSound(const QString &soundname) const
+{
+    QMap<QString, int>::const_iterator it = index_.constFind(QDir::fromNativeSeparators(soundname));
+
+    if (storage_.isNull() || it == index_.constEnd())
+        return QSharedPointer<ASoundData>();
+
+    const unsigned char* base = storage_->data();
+    const asound_bank_header_t* header = reinterpret_cast<const asound_bank_header_t*>(base);
+    const asound_bank_entry_t* entries =
+            reinterpret_cast<const asound_bank_entry_t*>(base + sizeof(asound_bank_header_t));
+    const asound_bank_label_t* labels =
+            reinterpret_cast<const asound_bank_label_t*>(entries + header->entriesCount);
+    const char* strings = reinterpret_cast<const char*>(base + header->stringsOffset);
+
+    const asound_bank_entry_t &entry = entries[it.value()];
+
+    QSharedPointer<ASoundData> data(new ASoundData());
+    data->name = it.key();
+    data->info = entry.info;
+    data->dataSize = entry.dataSize;
+    data->blocksCount = static_cast<int>(entry.blocksCount);
+    data->analysis = entry.analysis;
+
+    // Блоки лежат в банке подряд - указываем прямо в отображение
+    const unsigned char* block = base + entry.dataOffset;
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        data->block[i] = (i < data->blocksCount) ? block : nullptr;
+        data->blockSize[i] = entry.blockSize[i];
+        block += entry.blockSize[i];
+    }
+
+    for (uint32_t i = 0; i < entry.labelsCount; ++i)
+    {
+        const asound_bank_label_t &label = labels[entry.firstLabel + i];
+        data->labels.insert(QString::fromUtf8(strings + label.nameOffset,
+                                              static_cast<int>(label.nameSize)),
+                            label.offset);
+    }
+
+    data->storage = storage_;
+
+    return data;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Проверка и разбор индекса банка
+//-----------------------------------------------------------------------------
+bool ASoundBank::readIndex_()
+{
+    const unsigned char* base = storage_->data();
+    uint64_t size = static_cast<uint64_t>(storage_->size());
+
+    if (size < sizeof(asound_bank_header_t))
+    {
+        lastError_ = "BANK_TOO_SHORT: ";
+        return false;
+    }
+
+    const asound_bank_header_t* header = reinterpret_cast<const asound_bank_header_t*>(base);
+
+    if (strncmp(header->magic, ASOUND_BANK_MAGIC, 4) != 0)
+    {
+        lastError_ = "NOT_SOUND_BANK: ";
+        return false;
+    }
+
+    if (header->version != ASOUND_BANK_VERSION)
+    {
+        lastError_ = "UNSUPPORTED_BANK_VERSION: ";
+        return false;
+    }
+
+    uint64_t tablesEnd = sizeof(asound_bank_header_t) +
+            static_cast<uint64_t>(header->entriesCount) * sizeof(asound_bank_entry_t) +
+            static_cast<uint64_t>(header->labelsCount) * sizeof(asound_bank_label_t);
+
+    // Проверки вида "b > size - a" вместо "a + b > size" - сумма
+    // испорченных полей может переполниться
+    if (tablesEnd > header->stringsOffset ||
+        header->stringsOffset > size ||
+        header->stringsSize > size - header->stringsOffset)
+    {
+        lastError_ = "BROKEN_BANK_INDEX: ";
+        return false;
+    }
+
+    const asound_bank_entry_t* entries =
+            reinterpret_cast<const asound_bank_entry_t*>(base + sizeof(asound_bank_header_t));
+    const asound_bank_label_t* labels =
+            reinterpret_cast<const asound_bank_label_t*>(entries + header->entriesCount);
+    const char* strings = reinterpret_cast<const char*>(base + header->stringsOffset);
+
+    for (uint32_t i = 0; i < header->entriesCount; ++i)
+    {
+        const asound_bank_entry_t &entry = entries[i];
+
+        // Блоки должны помещаться в данные звука
+        uint64_t blocksSize = 0;
+        bool blocksFit = true;
+        for (int k = 0; k < BUFFER_BLOCKS; ++k)
+        {
+            blocksFit = blocksFit && entry.blockSize[k] <= entry.dataSize - blocksSize;
+            blocksSize += blocksFit ? entry.blockSize[k] : 0;
+        }
+
+        // Все ссылки записи должны оставаться внутри файла
+        if (entry.nameOffset > header->stringsSize ||
+            entry.nameSize > header->stringsSize - entry.nameOffset ||
+            entry.dataOffset > size ||
+            entry.dataSize > size - entry.dataOffset ||
+            !blocksFit ||
+            entry.blocksCount > BUFFER_BLOCKS ||
+            entry.firstLabel > header->labelsCount ||
+            entry.labelsCount > header->labelsCount - entry.firstLabel)
+        {
+            lastError_ = "BROKEN_BANK_ENTRY: ";
+            return false;
+        }
+
+        for (uint32_t k = 0; k < entry.labelsCount; ++k)
+        {
+            const asound_bank_label_t &label = labels[entry.firstLabel + k];
+
+            if (label.nameOffset > header->stringsSize ||
+                label.nameSize > header->stringsSize - label.nameOffset)
+            {
+                lastError_ = "BROKEN_BANK_ENTRY: ";
+                return false;
+            }
+        }
+
+        index_.insert(QString::fromUtf8(strings + entry.nameOffset,
+                                        static_cast<int>(entry.nameSize)),
+                      static_cast<int>(i));
+    }
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Дописать PCM данные звука в банк и заполнить его запись и метки
+//-----------------------------------------------------------------------------
+static bool writeSound(QFile &bank, const ASoundData &data,
+                       asound_bank_entry_t &entry, QList<asound_bank_label_t> &labels)
+{
+    // Метки размечены по первому проходу - их состав не должен измениться
+    if (static_cast<uint32_t>(data.labels.count()) != entry.labelsCount)
+        return false;
+
+    // Добиваем до выровненного смещения
+    const char padding[ASOUND_BANK_ALIGN] = {0};
+    qint64 pos = bank.pos();
+    qint64 pad = static_cast<qint64>((static_cast<uint64_t>(pos) + ASOUND_BANK_ALIGN - 1) &
+                                     ~(ASOUND_BANK_ALIGN - 1)) - pos;
+
+    if (pad > 0 && bank.write(padding, pad) != pad)
+        return false;
+
+    entry.info = data.info;
+    entry.analysis = data.analysis;
+    entry.blocksCount = static_cast<uint32_t>(data.blocksCount);
+    entry.dataOffset = static_cast<uint64_t>(bank.pos());
+    entry.dataSize = 0;
+
+    for (int k = 0; k < BUFFER_BLOCKS; ++k)
+    {
+        entry.blockSize[k] = data.blockSize[k];
+        entry.dataSize += data.blockSize[k];
+
+        if (data.blockSize[k] == 0)
+            continue;
+
+        if (data.block[k] == nullptr ||
+                bank.write(reinterpret_cast<const char*>(data.block[k]),
+                           static_cast<qint64>(data.blockSize[k])) !=
+                static_cast<qint64>(data.blockSize[k]))
+        {
+            return false;
+        }
+    }
+
+    uint32_t k = entry.firstLabel;
+    QMap<QString, uint64_t>::const_iterator labl_map = data.labels.constBegin();
+    while (labl_map != data.labels.constEnd())
+    {
+        labels[static_cast<int>(k)].offset = labl_map.value();
+        ++labl_map;
+        ++k;
+    }
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Собрать банк из WAVE файлов
+//-----------------------------------------------------------------------------
+bool ASoundBank::write(const QString &bankname, const QString &baseDir,
+                       const QStringList &files, QString &error, int lodLevels)
+{
+    QDir base(baseDir);
+    AWaveReader reader;
+
+    QList<asound_bank_entry_t> entries;
+    QList<asound_bank_label_t> labels;
+    QByteArray strings;
+
+    // Упрощённые варианты каждого файла (уровни)
+    QList< QList<int> > levels;
+
+    // Первый проход - только разметка: индекс строится без PCM данных,
+    // которые могли бы не поместиться в память все сразу
+    for (const QString &file : files)
+    {
+        QSharedPointer<ASoundData> data = reader.read(file, false);
+
+        if (data.isNull())
+        {
+            error = reader.getLastError();
+            return false;
+        }
+
+        QByteArray name = QDir::fromNativeSeparators(base.relativeFilePath(file)).toUtf8();
+        QList<QByteArray> names;
+        names.append(name);
+
+        // Упрощённые варианты для дальних источников
+        QList<int> fileLevels;
+        for (int level = 1; level <= lodLevels && level < ASOUND_LOD_LEVELS; ++level)
+        {
+            if (AWaveReader::hasLodVariant(*data, level))
+            {
+                fileLevels.append(level);
+                names.append(name + ASOUND_BANK_LOD_SUFFIX + QByteArray::number(level));
+            }
+        }
+
+        levels.append(fileLevels);
+
+        // Варианты сохраняют метки звука (смещения - свои)
+        for (const QByteArray &entryName : names)
+        {
+            asound_bank_entry_t entry;
+            entry.nameOffset = static_cast<uint32_t>(strings.size());
+            entry.nameSize = static_cast<uint32_t>(entryName.size());
+            strings.append(entryName);
+
+            entry.firstLabel = static_cast<uint32_t>(labels.count());
+            entry.labelsCount = static_cast<uint32_t>(data->labels.count());
+
+            QMap<QString, uint64_t>::const_iterator labl_map = data->labels.constBegin();
+            while (labl_map != data->labels.constEnd())
+            {
+                QByteArray labelName = labl_map.key().toUtf8();
+
+                asound_bank_label_t label;
+                label.nameOffset = static_cast<uint32_t>(strings.size());
+                label.nameSize = static_cast<uint32_t>(labelName.size());
+                strings.append(labelName);
+
+                labels.append(label);
+                ++labl_map;
+            }
+
+            entries.append(entry);
+        }
+    }
+
+    asound_bank_header_t header;
+    header.entriesCount = static_cast<uint32_t>(entries.count());
+    header.labelsCount = static_cast<uint32_t>(labels.count());
+    header.stringsOffset = sizeof(asound_bank_header_t) +
+            static_cast<uint64_t>(entries.count()) * sizeof(asound_bank_entry_t) +
+            static_cast<uint64_t>(labels.count()) * sizeof(asound_bank_label_t);
+    header.stringsSize = static_cast<uint64_t>(strings.size());
+
+    QFile bank(bankname);
+
+    if (!bank.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        error = "CANT_OPEN_FILE_FOR_WRITING: ";
+        error.append(bankname);
+        return false;
+    }
+
+    // Таблицы записей и меток дописываются в конце, когда известны
+    // размеры и смещения PCM данных
+    bool ok = bank.write(reinterpret_cast<const char*>(&header), sizeof(header)) ==
+            static_cast<qint64>(sizeof(header)) &&
+            bank.seek(static_cast<qint64>(header.stringsOffset)) &&
+            bank.write(strings) == strings.size();
+
+    // Второй проход - PCM данные по одному звуку
+    int n = 0;
+    for (int f = 0; ok && f < files.count(); ++f)
+    {
+        QSharedPointer<ASoundData> data = reader.read(files[f]);
+
+        if (data.isNull())
+        {
+            bank.close();
+            QFile::remove(bankname);
+            error = reader.getLastError();
+            return false;
+        }
+
+        ok = writeSound(bank, *data, entries[n++], labels);
+
+        for (int i = 0; ok && i < levels[f].count(); ++i)
+        {
+            QSharedPointer<ASoundData> variant = AWaveReader::makeLodVariant(data, levels[f][i]);
+            ok = !variant.isNull() && writeSound(bank, *variant, entries[n++], labels);
+        }
+    }
+
+    uint64_t size = static_cast<uint64_t>(bank.pos());
+
+    if (ok)
+    {
+        ok = bank.seek(sizeof(asound_bank_header_t));
+
+        for (int i = 0; ok && i < entries.count(); ++i)
+        {
+            ok = bank.write(reinterpret_cast<const char*>(&entries[i]), sizeof(asound_bank_entry_t)) ==
+                    static_cast<qint64>(sizeof(asound_bank_entry_t));
+        }
+
+        for (int i = 0; ok && i < labels.count(); ++i)
+        {
+            ok = bank.write(reinterpret_cast<const char*>(&labels[i]), sizeof(asound_bank_label_t)) ==
+                    static_cast<qint64>(sizeof(asound_bank_label_t));
+        }
+    }
+
+    ok = ok && bank.flush() && (static_cast<uint64_t>(bank.size()) == size);
+    bank.close();
+
+    if (!ok)
+    {
+        error = "CANT_WRITE_BANK: ";
+        error.append(bankname);
+        QFile::remove(bankname);
+    }
+
+    return ok;
+}
@@ -0,0 +1,333 @@
+//-----------------------------------------------------------------------------
+//
+//      Кэш разобранных метаданных WAVE файлов
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-cache.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+/// Сигнатура файла кэша
+const quint32 ASOUND_CACHE_MAGIC = 0x434D5341; // "ASMC"
+/// Версия формата кэша
+const quint32 ASOUND_CACHE_VERSION = 3;
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundMetaCache::ASoundMetaCache()
+    : dirty_(false)
+{
+
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundMetaCache::~ASoundMetaCache()
+{
+    save();
+}
+
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+ASoundMetaCache &ASoundMetaCache::getInstance()
+{
+    // Создаем статичный экземпляр класса
+    static ASoundMetaCache instance;
+    // Возвращаем его при каждом вызове метода
+    return instance;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Включить кэш и загрузить его из файла
+//-----------------------------------------------------------------------------
+bool ASoundMetaCache::open(const QString &filename)
+{
+    QMutexLocker locker(&mutex_);
+
+    filename_ = filename;
+    entries_.clear();
+    dirty_ = false;
+
+    QFile file(filename_);
+
+    if (!file.exists())
+        return true;
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0, version = 0, count = 0;
+    stream >> magic >> version >> count;
+
+    // Кэш другой версии просто перестраивается заново
+    if (magic != ASOUND_CACHE_MAGIC || version != ASOUND_CACHE_VERSION)
+        return true;
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        QString key;
+        sound_meta_t meta;
+        quint64 dataOffset = 0, dataSize = 0;
+        qint32 blocksCount = 0, labelsCount = 0;
+
+        stream >> key >> meta.fileSize >> meta.fileTime;
+        stream.readRawData(reinterpret_cast<char*>(&meta.data.info), sizeof(wave_info_fmt_t));
+        stream >> dataOffset >> dataSize >> blocksCount;
+
+        meta.data.dataOffset = dataOffset;
+        meta.data.dataSize = dataSize;
+        meta.data.blocksCount = blocksCount;
+
+        for (int k = 0; k < BUFFER_BLOCKS; ++k)
+        {
+            quint64 blockSize = 0;
+            stream >> blockSize;
+            meta.data.blockSize[k] = blockSize;
+        }
+
+        stream >> labelsCount;
+
+        for (qint32 k = 0; k < labelsCount; ++k)
+        {
+            QString label;
+            quint64 offset = 0;
+            stream >> label >> offset;
+            meta.data.labels.insert(label, offset);
+        }
+
+        // Результаты анализа PCM данных
+        sound_analysis_t &analysis = meta.data.analysis;
+        stream >> analysis.valid;
+
+        for (int k = 0; k <= BUFFER_BLOCKS; ++k)
+        {
+            sound_level_t &level = (k == 0) ? analysis.total : analysis.region[k - 1];
+            stream >> level.peak >> level.rms >> level.loudness >> level.slope;
+        }
+
+        stream >> analysis.loopSeam >> analysis.wrapSeam;
+        stream >> meta.data.markersDropped;
+
+        if (stream.status() == QDataStream::Ok &&
+            blocksCount >= 0 && blocksCount <= BUFFER_BLOCKS)
+        {
+            entries_.insert(key, meta);
+        }
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Сохранить кэш в файл
+//-----------------------------------------------------------------------------
+bool ASoundMetaCache::save()
+{
+    QMutexLocker locker(&mutex_);
+
+    if (filename_.isEmpty() || !dirty_)
+        return true;
+
+    // Пишем во временный файл и подменяем, чтобы не оставить битый кэш
+    QSaveFile file(filename_);
+
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << ASOUND_CACHE_MAGIC << ASOUND_CACHE_VERSION
+           << static_cast<quint32>(entries_.count());
+
+    QMap<QString, sound_meta_t>::const_iterator it = entries_.constBegin();
+    while (it != entries_.constEnd())
+    {
+        const sound_meta_t &meta = it.value();
+
+        stream << it.key() << meta.fileSize << meta.fileTime;
+        stream.writeRawData(reinterpret_cast<const char*>(&meta.data.info), sizeof(wave_info_fmt_t));
+        stream << static_cast<quint64>(meta.data.dataOffset)
+               << static_cast<quint64>(meta.data.dataSize)
+               << static_cast<qint32>(meta.data.blocksCount);
+
+        for (int k = 0; k < BUFFER_BLOCKS; ++k)
+            stream << static_cast<quint64>(meta.data.blockSize[k]);
+
+        stream << static_cast<qint32>(meta.data.labels.count());
+
+        QMap<QString, uint64_t>::const_iterator labl_map = meta.data.labels.constBegin();
+        while (labl_map != meta.data.labels.constEnd())
+        {
+            stream << labl_map.key() << static_cast<quint64>(labl_map.value());
+            ++labl_map;
+        }
+
+        const sound_analysis_t &analysis = meta.data.analysis;
+        stream << analysis.valid;
+
+        for (int k = 0; k <= BUFFER_BLOCKS; ++k)
+        {
+            const sound_level_t &level = (k == 0) ? analysis.total : analysis.region[k - 1];
+            stream << level.peak << level.rms << level.loudness << level.slope;
+        }
+
+        stream << analysis.loopSeam << analysis.wrapSeam;
+        stream << meta.data.markersDropped;
+
+        ++it;
+    }
+
+    if (stream.status() != QDataStream::Ok || !file.commit())
+        return false;
+
+    dirty_ = false;
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Включён ли кэш
+//-----------------------------------------------------------------------------
+bool ASoundMetaCache::isEnabled()
+{
+    QMutexLocker locker(&mutex_);
+
+    return !filename_.isEmpty();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Найти метаданные файла
+//-----------------------------------------------------------------------------
+bool ASoundMetaCache::lookup(const QString &soundname, ASoundData &data)
+{
+    QString key = key_(soundname);
+
+    if (key.isEmpty())
+        return false;
+
+    QFileInfo info(soundname);
+
+    QMutexLocker locker(&mutex_);
+
+    if (filename_.isEmpty())
+        return false;
+
+    QMap<QString, sound_meta_t>::const_iterator it = entries_.constFind(key);
+
+    if (it == entries_.constEnd())
+        return false;
+
+    // Файл изменился - запись недействительна
+    if (it.value().fileSize != info.size() ||
+        it.value().fileTime != info.lastModified().toMSecsSinceEpoch())
+    {
+        return false;
+    }
+
+    const ASoundData &meta = it.value().data;
+
+    data.info = meta.info;
+    data.dataOffset = meta.dataOffset;
+    data.dataSize = meta.dataSize;
+    data.labels = meta.labels;
+    data.blocksCount = meta.blocksCount;
+    data.analysis = meta.analysis;
+    data.markersDropped = meta.markersDropped;
+
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+        data.blockSize[i] = meta.blockSize[i];
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Сохранить метаданные разобранного файла
+//-----------------------------------------------------------------------------
+void ASoundMetaCache::store(const QString &soundname, const ASoundData &data)
+{
+    QString key = key_(soundname);
+
+    if (key.isEmpty())
+        return;
+
+    QFileInfo info(soundname);
+
+    QMutexLocker locker(&mutex_);
+
+    if (filename_.isEmpty())
+        return;
+
+    sound_meta_t meta;
+    meta.fileSize = info.size();
+    meta.fileTime = info.lastModified().toMSecsSinceEpoch();
+    meta.data.info = data.info;
+    meta.data.dataOffset = data.dataOffset;
+    meta.data.dataSize = data.dataSize;
+    meta.data.labels = data.labels;
+    meta.data.blocksCount = data.blocksCount;
+    meta.data.analysis = data.analysis;
+    meta.data.markersDropped = data.markersDropped;
+
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+        meta.data.blockSize[i] = data.blockSize[i];
+
+    entries_.insert(key, meta);
+    dirty_ = true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Удалить запись о файле
+//-----------------------------------------------------------------------------
+void ASoundMetaCache::remove(const QString &soundname)
+{
+    QString key = key_(soundname);
+
+    QMutexLocker locker(&mutex_);
+
+    if (entries_.remove(key) > 0)
+        dirty_ = true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Ключ записи для файла
+//-----------------------------------------------------------------------------
+QString ASoundMetaCache::key_(const QString &soundname)
+{
+    // Ресурсы Qt не имеют времени модификации - их не кэшируем
+    if (soundname.startsWith(":"))
+        return QString();
+
+    return QFileInfo(soundname).absoluteFilePath();
+}
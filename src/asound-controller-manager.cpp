@@ -0,0 +1,462 @@
+//-----------------------------------------------------------------------------
+//
+//      Пакетное управление очередями запуска звуков
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-controller-manager.h"
+#include "asound.h"
+#include <QTimer>
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundControllerManager::ASoundControllerManager(QObject *parent)
+    : QObject(parent)
+    , timer_(new QTimer(this))
+    , tickInterval_(0)
+{
+    timer_->setSingleShot(true);
+    connect(timer_, &QTimer::timeout, this, &ASoundControllerManager::tick);
+
+    clock_.start();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundControllerManager::~ASoundControllerManager()
+{
+
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Добавить очередь запуска
+//-----------------------------------------------------------------------------
+int ASoundControllerManager::addController(QString soundBegin, QStringList soundsRunning,
+                                           QString soundEnd, int loadFlags)
+{
+    ASound* begin = loadSound_(soundBegin, loadFlags);
+    ASound* end = loadSound_(soundEnd, loadFlags);
+    QVector<ASound*> running;
+
+    for (const QString &path : soundsRunning)
+    {
+        ASound* sound = loadSound_(path, loadFlags);
+
+        if (sound != Q_NULLPTR)
+        {
+            sound->setLoop(true);
+            running.append(sound);
+        }
+    }
+
+    // Без звуков запуска, остановки или процесса работы очередь не готова
+    if (begin == Q_NULLPTR || end == Q_NULLPTR || running.isEmpty())
+    {
+        delete begin;
+        delete end;
+        qDeleteAll(running);
+        return -1;
+    }
+
+    int id = phase_.count();
+
+    phase_.append(PHASE_IDLE);
+    actions_.append(0);
+    current_.append(0);
+    playing_.append(-1);
+    pitch_.append(1.0f);
+    volume_.append(100);
+    beginDuration_.append(begin->getDuration());
+    beginDeadline_.append(0);
+    soundBegin_.append(begin);
+    soundEnd_.append(end);
+    runningFirst_.append(runningSounds_.count());
+    runningCount_.append(running.count());
+    runningSounds_ += running;
+
+    return id;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Удалить очередь
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::removeController(int id)
+{
+    if (!isValid_(id))
+        return;
+
+    // Удаление источника останавливает звук
+    delete soundBegin_[id];
+    delete soundEnd_[id];
+    soundBegin_[id] = Q_NULLPTR;
+    soundEnd_[id] = Q_NULLPTR;
+
+    ASound** running = runningSounds_.data() + runningFirst_[id];
+
+    for (int i = 0; i < runningCount_[id]; ++i)
+    {
+        delete running[i];
+        running[i] = Q_NULLPTR;
+    }
+
+    phase_[id] = PHASE_REMOVED;
+    playing_[id] = -1;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Количество очередей
+//-----------------------------------------------------------------------------
+int ASoundControllerManager::count() const
+{
+    return phase_.count();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Запустить алгоритм воспроизведения
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::begin(int id)
+{
+    if (!isValid_(id) || phase_[id] != PHASE_IDLE)
+        return;
+
+    phase_[id] = PHASE_BEGINNING;
+    beginDeadline_[id] = clock_.elapsed() + beginDuration_[id];
+    waiting_.append(id);
+
+    markDirty_(id, ACT_PLAY_BEGIN);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Завершить алгоритм воспроизведения
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::end(int id)
+{
+    if (!isValid_(id))
+        return;
+
+    if (phase_[id] != PHASE_RUNNING && phase_[id] != PHASE_BEGINNING)
+        return;
+
+    phase_[id] = PHASE_IDLE;
+
+    // Звук запуска, не успевший начаться, просто не запускаем
+    if (actions_[id] & ACT_PLAY_BEGIN)
+        actions_[id] &= ~ACT_PLAY_BEGIN;
+    else
+        actions_[id] |= ACT_STOP_BEGIN;
+
+    markDirty_(id, ACT_PLAY_END);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Аварийно завершить алгоритм воспроизведения
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::forcedStop(int id)
+{
+    if (!isValid_(id))
+        return;
+
+    phase_[id] = PHASE_IDLE;
+    actions_[id] &= ~(ACT_PLAY_BEGIN | ACT_PLAY_END);
+
+    markDirty_(id, ACT_STOP_BEGIN | ACT_STOP_ALL);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить звук процесса работы
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::switchRunningSound(int id, int index)
+{
+    if (!isValid_(id) || phase_[id] != PHASE_RUNNING)
+        return;
+
+    if (index < 0 || index >= runningCount_[id] || index == current_[id])
+        return;
+
+    current_[id] = index;
+
+    markDirty_(id, 0);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить скорость воспроизведения
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::setPitch(int id, float pitch)
+{
+    if (!isValid_(id) || pitch_[id] == pitch)
+        return;
+
+    pitch_[id] = pitch;
+
+    if (phase_[id] == PHASE_RUNNING)
+        markDirty_(id, ACT_PITCH);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить громкость 0 - 100
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::setVolume(int id, int volume)
+{
+    if (!isValid_(id) || volume_[id] == volume)
+        return;
+
+    volume_[id] = volume;
+
+    markDirty_(id, ACT_VOLUME);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить скорости воспроизведения множества очередей
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::setPitches(const int *ids, const float *pitches, int count)
+{
+    for (int i = 0; i < count; ++i)
+        setPitch(ids[i], pitches[i]);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Работает ли очередь
+//-----------------------------------------------------------------------------
+bool ASoundControllerManager::isRunning(int id) const
+{
+    return isValid_(id) && phase_[id] == PHASE_RUNNING;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить задержку автоматического шага
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::setTickInterval(int ms)
+{
+    tickInterval_ = ms;
+
+    if (tickInterval_ < 0)
+        timer_->stop();
+    else
+        schedule_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Шаг
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::tick()
+{
+    qint64 now = clock_.elapsed();
+
+    // Звуки запуска отзвучали - переходим к процессу работы
+    int kept = 0;
+
+    for (int i = 0; i < waiting_.count(); ++i)
+    {
+        int id = waiting_[i];
+
+        if (phase_[id] != PHASE_BEGINNING)
+            continue;
+
+        if (now >= beginDeadline_[id])
+        {
+            phase_[id] = PHASE_RUNNING;
+            current_[id] = 0;
+            markDirty_(id, 0);
+        }
+        else
+        {
+            waiting_[kept++] = id;
+        }
+    }
+
+    waiting_.resize(kept);
+
+    if (!dirty_.isEmpty())
+    {
+        AListener::deferAllUpdates();
+
+        for (int id : dirty_)
+            apply_(id);
+
+        dirty_.clear();
+
+        AListener::processAllUpdates();
+    }
+
+    schedule_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Корректен ли идентификатор
+//-----------------------------------------------------------------------------
+bool ASoundControllerManager::isValid_(int id) const
+{
+    return id >= 0 && id < phase_.count() && phase_[id] != PHASE_REMOVED;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Отметить очередь как изменённую
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::markDirty_(int id, quint8 actions)
+{
+    if (!(actions_[id] & ACT_QUEUED))
+    {
+        actions_[id] |= ACT_QUEUED;
+        dirty_.append(id);
+    }
+
+    actions_[id] |= actions;
+
+    schedule_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Применить изменения очереди
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::apply_(int id)
+{
+    quint8 actions = actions_[id];
+    actions_[id] = 0;
+
+    if (phase_[id] == PHASE_REMOVED)
+        return;
+
+    ASound** running = runningSounds_.data() + runningFirst_[id];
+
+    if (actions & ACT_STOP_BEGIN)
+        soundBegin_[id]->stop();
+
+    if (actions & ACT_STOP_ALL)
+    {
+        for (int i = 0; i < runningCount_[id]; ++i)
+            running[i]->stop();
+
+        playing_[id] = -1;
+    }
+
+    // Приводим звучащий звук процесса работы к требуемому
+    int required = (phase_[id] == PHASE_RUNNING) ? current_[id] : -1;
+
+    if (playing_[id] != required)
+    {
+        if (required >= 0)
+        {
+            running[required]->setPitch(pitch_[id]);
+            running[required]->setVolume(volume_[id]);
+            running[required]->play();
+        }
+
+        if (playing_[id] >= 0)
+            running[playing_[id]]->stop();
+
+        playing_[id] = required;
+    }
+    else if (playing_[id] >= 0)
+    {
+        if (actions & ACT_PITCH)
+            running[playing_[id]]->setPitch(pitch_[id]);
+
+        if (actions & ACT_VOLUME)
+            running[playing_[id]]->setVolume(volume_[id]);
+    }
+
+    if (actions & ACT_VOLUME)
+    {
+        soundBegin_[id]->setVolume(volume_[id]);
+        soundEnd_[id]->setVolume(volume_[id]);
+    }
+
+    if (actions & ACT_PLAY_BEGIN)
+        soundBegin_[id]->play();
+
+    if (actions & ACT_PLAY_END)
+        soundEnd_[id]->play();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Запланировать автоматический шаг
+//-----------------------------------------------------------------------------
+void ASoundControllerManager::schedule_()
+{
+    if (tickInterval_ < 0)
+        return;
+
+    qint64 delay = -1;
+
+    if (!dirty_.isEmpty())
+    {
+        delay = tickInterval_;
+    }
+    else if (!waiting_.isEmpty())
+    {
+        // Ближайшее окончание звука запуска
+        qint64 deadline = beginDeadline_[waiting_[0]];
+
+        for (int id : waiting_)
+            deadline = qMin(deadline, beginDeadline_[id]);
+
+        delay = qMax(static_cast<qint64>(0), deadline - clock_.elapsed());
+    }
+
+    if (delay < 0)
+    {
+        timer_->stop();
+        return;
+    }
+
+    if (!timer_->isActive() || timer_->remainingTime() > delay)
+        timer_->start(static_cast<int>(delay));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Загрузить звук
+//-----------------------------------------------------------------------------
+ASound *ASoundControllerManager::loadSound_(const QString &soundname, int loadFlags)
+{
+    ASound* sound = new ASound(soundname, this, loadFlags);
+
+    if (!sound->getLastError().isEmpty())
+    {
+        delete sound;
+        return Q_NULLPTR;
+    }
+
+    return sound;
+}
@@ -0,0 +1,192 @@
+//-----------------------------------------------------------------------------
+//
+//      Контроль подключения устройств вывода и их переоткрытие
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-device.h"
+#include "asound.h"
+#include "asound-zone.h"
+#include <QTimer>
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundDeviceMonitor::ASoundDeviceMonitor()
+    : QObject(Q_NULLPTR)
+    , timer_(new QTimer(this))
+    , interval_(DEF_DEVICE_CHECK_INTERVAL)
+{
+    connect(timer_, &QTimer::timeout, this, &ASoundDeviceMonitor::check);
+
+    clock_.start();
+}
+
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+ASoundDeviceMonitor &ASoundDeviceMonitor::getInstance()
+{
+    // Создаем статичный экземпляр класса
+    static ASoundDeviceMonitor instance;
+    // Возвращаем его при каждом вызове метода
+    return instance;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить период проверки
+//-----------------------------------------------------------------------------
+void ASoundDeviceMonitor::setInterval(int ms)
+{
+    interval_ = qMax(0, ms);
+
+    if (interval_ == 0)
+    {
+        timer_->stop();
+    }
+    else
+    {
+        timer_->setInterval(interval_);
+
+        if (!sounds_.isEmpty())
+            timer_->start();
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Добавить звук под восстановление
+//-----------------------------------------------------------------------------
+void ASoundDeviceMonitor::add(ASound *sound)
+{
+    if (!sounds_.contains(sound))
+        sounds_.append(sound);
+
+    if (interval_ > 0 && !timer_->isActive())
+        timer_->start(interval_);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Удалить звук
+//-----------------------------------------------------------------------------
+void ASoundDeviceMonitor::remove(ASound *sound)
+{
+    sounds_.removeOne(sound);
+
+    if (sounds_.isEmpty())
+        timer_->stop();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Переоткрыть устройство и восстановить его звуки
+//-----------------------------------------------------------------------------
+bool ASoundDeviceMonitor::reopen(AListener *output)
+{
+    // Переоткрытие исправного устройства (смена устройства) - позиции
+    // воспроизведения берём свежие
+    if (output->isConnected())
+    {
+        qint64 now = clock_.elapsed();
+
+        for (ASound* sound : sounds_)
+        {
+            if (sound->listener_ == output)
+                sound->saveState_(now);
+        }
+    }
+
+    bool rebuilt = false;
+
+    if (!output->reopen_(rebuilt))
+        return false;
+
+    qint64 now = clock_.elapsed();
+
+    // Слоты зон утрачены вместе с контекстом
+    if (rebuilt)
+        ASoundZone::forgetOutput_(output, false);
+
+    output->deferUpdates();
+
+    for (ASound* sound : sounds_)
+    {
+        if (sound->listener_ == output)
+            sound->restoreState_(now, rebuilt);
+    }
+
+    output->processUpdates();
+
+    output->log_->notify("T Output restored: " + output->getDeviceName().toStdString() +
+                         (rebuilt ? " (context rebuilt)" : " (device reopened)"));
+
+    lost_.remove(output);
+
+    emit deviceRestored(output);
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Время по часам монитора
+//-----------------------------------------------------------------------------
+qint64 ASoundDeviceMonitor::now() const
+{
+    return clock_.elapsed();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Проверить подключение всех устройств
+//-----------------------------------------------------------------------------
+void ASoundDeviceMonitor::check()
+{
+    QList<AListener*> outputs = AListener::getOutputs();
+    QSet<AListener*> connected;
+    QSet<AListener*> lost;
+
+    for (AListener* output : outputs)
+    {
+        if (output->isConnected())
+        {
+            connected.insert(output);
+            continue;
+        }
+
+        if (!lost_.contains(output))
+        {
+            output->log_->notify("E - OUTPUT_DISCONNECTED: " + output->getDeviceName().toStdString());
+            emit deviceLost(output);
+        }
+
+        lost.insert(output);
+    }
+
+    // Закрытые тем временем устройства забываем
+    lost_ = lost;
+
+    // Запоминаем состояние звуков исправных устройств
+    qint64 now = clock_.elapsed();
+
+    for (ASound* sound : sounds_)
+    {
+        if (connected.contains(sound->listener_))
+            sound->saveState_(now);
+    }
+
+    for (AListener* output : lost)
+        reopen(output);
+}
@@ -0,0 +1,1122 @@
+//-----------------------------------------------------------------------------
+//
+//      Подпрограммы обработки PCM данных при загрузке звуков
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-dsp.h"
+
+#include <QtConcurrent>
+#include <QVector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define ASOUND_USE_SSE2
+#  include <emmintrin.h>
+#endif
+
+namespace
+{
+    /// Векторные ветки ядер разрешены
+    std::atomic<bool> simdEnabled(true);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Разрешить или запретить векторные ветки ядер
+//-----------------------------------------------------------------------------
+void ASoundDSP::setSimdEnabled(bool enabled)
+{
+    simdEnabled.store(enabled);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Включены ли векторные ветки ядер
+//-----------------------------------------------------------------------------
+bool ASoundDSP::isSimdEnabled()
+{
+#ifdef ASOUND_USE_SSE2
+    return simdEnabled.load(std::memory_order_relaxed);
+#else
+    return false;
+#endif
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Свести 16-битный стерео сигнал в моно
+//-----------------------------------------------------------------------------
+void ASoundDSP::downmixStereo16(const int16_t* src, int16_t* dst, size_t frames)
+{
+    size_t i = 0;
+
+#ifdef ASOUND_USE_SSE2
+    if (isSimdEnabled())
+    {
+        // Попарное сложение L+R в 32-битные суммы (pmaddwd), по 8 кадров за шаг
+        const __m128i ones = _mm_set1_epi16(1);
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 8));
+
+            lo = _mm_srai_epi32(_mm_madd_epi16(lo, ones), 1);
+            hi = _mm_srai_epi32(_mm_madd_epi16(hi, ones), 1);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(lo, hi));
+        }
+    }
+#endif
+
+    // Хвост (и весь сигнал без векторной ветки)
+    for (; i < frames; ++i)
+    {
+        int32_t sum = static_cast<int32_t>(src[2 * i]) + src[2 * i + 1];
+        dst[i] = static_cast<int16_t>(sum >> 1);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Свести 8-битный (беззнаковый) стерео сигнал в моно
+//-----------------------------------------------------------------------------
+void ASoundDSP::downmixStereo8(const uint8_t* src, uint8_t* dst, size_t frames)
+{
+    size_t i = 0;
+
+#ifdef ASOUND_USE_SSE2
+    if (isSimdEnabled())
+    {
+        // Разделяем чётные (L) и нечётные (R) байты и усредняем, по 16 кадров за шаг
+        const __m128i mask = _mm_set1_epi16(0x00FF);
+
+        for (; i + 16 <= frames; i += 16)
+        {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 16));
+
+            lo = _mm_avg_epu16(_mm_and_si128(lo, mask), _mm_srli_epi16(lo, 8));
+            hi = _mm_avg_epu16(_mm_and_si128(hi, mask), _mm_srli_epi16(hi, 8));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+        }
+    }
+#endif
+
+    // Хвост (и весь сигнал без векторной ветки)
+    for (; i < frames; ++i)
+    {
+        uint32_t sum = static_cast<uint32_t>(src[2 * i]) + src[2 * i + 1] + 1;
+        dst[i] = static_cast<uint8_t>(sum >> 1);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Преобразовать чередующиеся PCM отсчёты (8/16 бит) в каналы float
+//-----------------------------------------------------------------------------
+void ASoundDSP::pcmToFloat(const unsigned char* src, int bits, int channels,
+                           size_t frames, float* const* planes)
+{
+    if (bits == 16)
+    {
+        const int16_t* pcm = reinterpret_cast<const int16_t*>(src);
+
+        for (size_t i = 0; i < frames; ++i)
+            for (int c = 0; c < channels; ++c)
+                planes[c][i] = pcm[i * channels + c] * (1.0f / 32768.0f);
+    }
+    else
+    {
+        for (size_t i = 0; i < frames; ++i)
+            for (int c = 0; c < channels; ++c)
+                planes[c][i] = (src[i * channels + c] - 128) * (1.0f / 128.0f);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Преобразовать каналы float в чередующиеся PCM отсчёты (8/16 бит)
+//-----------------------------------------------------------------------------
+void ASoundDSP::floatToPcm(const float* const* planes, int channels, size_t frames,
+                           int bits, unsigned char* dst)
+{
+    if (bits == 16)
+    {
+        int16_t* pcm = reinterpret_cast<int16_t*>(dst);
+
+        for (size_t i = 0; i < frames; ++i)
+            for (int c = 0; c < channels; ++c)
+            {
+                float v = std::floor(planes[c][i] * 32768.0f + 0.5f);
+                v = v > 32767.0f ? 32767.0f : (v < -32768.0f ? -32768.0f : v);
+                pcm[i * channels + c] = static_cast<int16_t>(v);
+            }
+    }
+    else
+    {
+        for (size_t i = 0; i < frames; ++i)
+            for (int c = 0; c < channels; ++c)
+            {
+                float v = std::floor(planes[c][i] * 128.0f + 128.5f);
+                v = v > 255.0f ? 255.0f : (v < 0.0f ? 0.0f : v);
+                dst[i * channels + c] = static_cast<uint8_t>(v);
+            }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Длина сигнала (в кадрах) после смены частоты дискретизации
+//-----------------------------------------------------------------------------
+size_t ASoundDSP::resampledLength(size_t frames, uint32_t srcRate, uint32_t dstRate)
+{
+    if (srcRate == 0)
+        return 0;
+
+    return static_cast<size_t>(static_cast<uint64_t>(frames) * dstRate / srcRate);
+}
+
+
+
+namespace
+{
+    /// Количество фаз полифазного фильтра
+    const int RESAMPLE_PHASES = 256;
+
+    /// Полуширина ядра фильтра (в отсчётах на частоте среза)
+    const int RESAMPLE_HALF_WIDTH = 16;
+
+    /// Параметр окна Кайзера (подавление ~90 дБ)
+    const double RESAMPLE_KAISER_BETA = 8.6;
+
+    /// Число пи
+    const double RESAMPLE_PI = 3.14159265358979323846;
+
+    /// Размер участка выходного сигнала, обрабатываемого одним потоком
+    const size_t RESAMPLE_CHUNK = 32768;
+
+    /// Длина сигнала, начиная с которой обработка ведётся в нескольких потоках
+    const size_t RESAMPLE_MT_THRESHOLD = 4 * RESAMPLE_CHUNK;
+
+    /// Модифицированная функция Бесселя нулевого порядка
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    /*!
+     * \struct resample_kernel_t
+     * \brief Полифазное ядро фильтра ресемплера
+     */
+    struct resample_kernel_t
+    {
+        int             taps;       ///< Отводов на фазу (кратно 4)
+        uint32_t        srcRate;    ///< Исходная частота
+        uint32_t        dstRate;    ///< Требуемая частота
+        std::vector<float> table;   ///< Коэффициенты [RESAMPLE_PHASES + 1][taps]
+    };
+
+    /// Построение ядра фильтра
+    void buildKernel(resample_kernel_t &kernel, uint32_t srcRate, uint32_t dstRate)
+    {
+        // При понижении частоты срез сдвигаем ниже новой частоты Найквиста
+        double cutoff = (dstRate < srcRate) ?
+                    0.95 * static_cast<double>(dstRate) / srcRate : 0.95;
+
+        int half = static_cast<int>(std::ceil(RESAMPLE_HALF_WIDTH / cutoff));
+        kernel.taps = (2 * half + 3) & ~3;
+        kernel.srcRate = srcRate;
+        kernel.dstRate = dstRate;
+        kernel.table.assign(static_cast<size_t>((RESAMPLE_PHASES + 1) * kernel.taps), 0.0f);
+
+        double i0beta = besselI0(RESAMPLE_KAISER_BETA);
+        double radius = kernel.taps / 2.0;
+
+        for (int p = 0; p <= RESAMPLE_PHASES; ++p)
+        {
+            double frac = static_cast<double>(p) / RESAMPLE_PHASES;
+            float* row = &kernel.table[static_cast<size_t>(p * kernel.taps)];
+            double sum = 0.0;
+
+            for (int k = 0; k < kernel.taps; ++k)
+            {
+                // Расстояние от отвода до точки интерполяции
+                double x = (k - kernel.taps / 2 + 1) - frac;
+                double r = x / radius;
+                double w = (std::fabs(r) < 1.0) ?
+                            besselI0(RESAMPLE_KAISER_BETA * std::sqrt(1.0 - r * r)) / i0beta : 0.0;
+                double arg = RESAMPLE_PI * cutoff * x;
+                double h = cutoff * (std::fabs(arg) < 1e-9 ? 1.0 : std::sin(arg) / arg) * w;
+
+                row[k] = static_cast<float>(h);
+                sum += h;
+            }
+
+            // Нормируем усиление каждой фазы к единице
+            for (int k = 0; k < kernel.taps; ++k)
+                row[k] = static_cast<float>(row[k] / sum);
+        }
+    }
+
+    /// Скалярное произведение отсчётов и коэффициентов фазы
+    inline float dotProduct(const float* x, const float* h, int taps, bool simd)
+    {
+#ifdef ASOUND_USE_SSE2
+        if (simd)
+        {
+            __m128 acc = _mm_setzero_ps();
+
+            for (int k = 0; k < taps; k += 4)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + k), _mm_loadu_ps(h + k)));
+
+            acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+            acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 0x55));
+
+            return _mm_cvtss_f32(acc);
+        }
+#else
+        Q_UNUSED(simd)
+#endif
+
+        float acc = 0.0f;
+
+        for (int k = 0; k < taps; ++k)
+            acc += x[k] * h[k];
+
+        return acc;
+    }
+
+    /*!
+     * \struct resample_chunk_t
+     * \brief Участок выходного сигнала для обработки одним потоком
+     */
+    struct resample_chunk_t
+    {
+        const resample_kernel_t*    kernel; ///< Ядро фильтра
+        const float*                src;    ///< Исходный канал с полями по taps нулей
+        float*                      dst;    ///< Выходной канал
+        size_t                      begin;  ///< Первый выходной отсчёт
+        size_t                      end;    ///< Следующий за последним отсчёт
+        bool                        simd;   ///< Векторная ветка
+    };
+
+    /// Обработка участка выходного сигнала
+    void resampleChunk(const resample_chunk_t &chunk)
+    {
+        const resample_kernel_t &kernel = *chunk.kernel;
+
+        for (size_t n = chunk.begin; n < chunk.end; ++n)
+        {
+            // Положение выходного отсчёта во входном сигнале
+            uint64_t num = static_cast<uint64_t>(n) * kernel.srcRate;
+            size_t idx = static_cast<size_t>(num / kernel.dstRate);
+            uint64_t rem = num % kernel.dstRate;
+            int phase = static_cast<int>((rem * RESAMPLE_PHASES + kernel.dstRate / 2) / kernel.dstRate);
+
+            // Поле слева имеет ширину taps, первый отвод - idx - taps/2 + 1
+            const float* x = chunk.src + idx + kernel.taps / 2 + 1;
+            const float* h = &kernel.table[static_cast<size_t>(phase * kernel.taps)];
+
+            chunk.dst[n] = dotProduct(x, h, kernel.taps, chunk.simd);
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Сменить частоту дискретизации одного канала
+//-----------------------------------------------------------------------------
+void ASoundDSP::resample(const float* src, size_t srcFrames, float* dst,
+                         uint32_t srcRate, uint32_t dstRate)
+{
+    size_t dstFrames = resampledLength(srcFrames, srcRate, dstRate);
+
+    if (dstFrames == 0)
+        return;
+
+    resample_kernel_t kernel;
+    buildKernel(kernel, srcRate, dstRate);
+
+    // Копия входа с нулевыми полями, чтобы не проверять границы в цикле
+    size_t pad = static_cast<size_t>(kernel.taps);
+    std::vector<float> padded(srcFrames + 2 * pad, 0.0f);
+    std::copy(src, src + srcFrames, padded.begin() + static_cast<long>(pad));
+
+    QVector<resample_chunk_t> chunks;
+
+    for (size_t begin = 0; begin < dstFrames; begin += RESAMPLE_CHUNK)
+    {
+        resample_chunk_t chunk;
+        chunk.kernel = &kernel;
+        chunk.src = padded.data();
+        chunk.dst = dst;
+        chunk.begin = begin;
+        chunk.end = std::min(begin + RESAMPLE_CHUNK, dstFrames);
+        chunk.simd = isSimdEnabled();
+        chunks.append(chunk);
+    }
+
+    if (dstFrames >= RESAMPLE_MT_THRESHOLD)
+    {
+        QtConcurrent::blockingMap(chunks, resampleChunk);
+    }
+    else
+    {
+        for (const resample_chunk_t &chunk : chunks)
+            resampleChunk(chunk);
+    }
+}
+
+
+
+namespace
+{
+    /// Ключи дорожек свёртки
+    const uint64_t HASH_KEYS[4] = {
+        0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL,
+        0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL
+    };
+
+    /// Простые числа перемешивания
+    const uint64_t HASH_PRIME1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t HASH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+
+    /// Байт, обрабатываемых за шаг
+    const size_t HASH_STRIPE = 32;
+
+    /// Прочитать 64-битное слово без требований к выравниванию
+    inline uint64_t read64(const unsigned char* p)
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    /// Окончательное перемешивание (fmix64)
+    inline uint64_t avalanche(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// 64-битная свёртка данных
+//-----------------------------------------------------------------------------
+uint64_t ASoundDSP::hash64(const void* data, size_t size)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    size_t stripes = size / HASH_STRIPE;
+
+    // Шаг дорожки j: acc[j] += lo32(d[j] ^ key[j]) * hi32(d[j] ^ key[j]) + d[j ^ 1]
+    uint64_t acc[4] = {HASH_PRIME1, HASH_PRIME2, HASH_KEYS[0], HASH_KEYS[1]};
+
+    size_t s = 0;
+
+#ifdef ASOUND_USE_SSE2
+    if (isSimdEnabled())
+    {
+        __m128i acc0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc));
+        __m128i acc1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + 2));
+        const __m128i key0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(HASH_KEYS));
+        const __m128i key1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(HASH_KEYS + 2));
+
+        for (; s < stripes; ++s, p += HASH_STRIPE)
+        {
+            __m128i d0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i d1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+
+            // pmuludq перемножает младшие половины 64-битных дорожек
+            __m128i k0 = _mm_xor_si128(d0, key0);
+            __m128i k1 = _mm_xor_si128(d1, key1);
+            __m128i m0 = _mm_mul_epu32(k0, _mm_shuffle_epi32(k0, _MM_SHUFFLE(2, 3, 0, 1)));
+            __m128i m1 = _mm_mul_epu32(k1, _mm_shuffle_epi32(k1, _MM_SHUFFLE(2, 3, 0, 1)));
+
+            // Соседние дорожки обмениваются словами данных
+            acc0 = _mm_add_epi64(acc0, _mm_add_epi64(m0, _mm_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))));
+            acc1 = _mm_add_epi64(acc1, _mm_add_epi64(m1, _mm_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc), acc0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + 2), acc1);
+    }
+#endif
+
+    // Без векторной ветки
+    for (; s < stripes; ++s, p += HASH_STRIPE)
+    {
+        uint64_t d[4] = {read64(p), read64(p + 8), read64(p + 16), read64(p + 24)};
+
+        for (int j = 0; j < 4; ++j)
+        {
+            uint64_t k = d[j] ^ HASH_KEYS[j];
+            acc[j] += (k & 0xFFFFFFFFULL) * (k >> 32) + d[j ^ 1];
+        }
+    }
+
+    // Сведение дорожек и хвост
+    uint64_t h = static_cast<uint64_t>(size) * HASH_PRIME1;
+
+    for (int j = 0; j < 4; ++j)
+        h = (h ^ avalanche(acc[j])) * HASH_PRIME2;
+
+    size_t tail = size % HASH_STRIPE;
+
+    for (; tail >= 8; tail -= 8, p += 8)
+        h = (h ^ avalanche(read64(p))) * HASH_PRIME1;
+
+    for (; tail > 0; --tail, ++p)
+        h = (h ^ *p) * HASH_PRIME2;
+
+    return avalanche(h);
+}
+
+
+
+namespace
+{
+    /// Длина подблока стробирования громкости, с (BS.1770: 100 мс)
+    const double LOUDNESS_SUBBLOCK = 0.1;
+
+    /// Подблоков в блоке стробирования (400 мс с перекрытием 75%)
+    const size_t LOUDNESS_BLOCK_SUBBLOCKS = 4;
+
+    /// Относительный порог стробирования, LU
+    const double LOUDNESS_RELATIVE_GATE = -10.0;
+
+    /// Подблоков в куске сигнала, обрабатываемом одним потоком
+    const size_t ANALYSIS_CHUNK_SUBBLOCKS = 32;
+
+    /// Длина разгона K-фильтра перед куском, кадров
+    const size_t ANALYSIS_WARMUP = 4096;
+
+    /// Количество кусков, начиная с которого анализ ведётся в нескольких потоках
+    const int ANALYSIS_MT_CHUNKS = 4;
+
+    /// Шагов SIMD цикла между переносом сумм из float в double
+    const int ANALYSIS_FLUSH = 1024;
+
+    /*!
+     * \struct biquad_t
+     * \brief Коэффициенты биквадратного фильтра (a0 = 1)
+     */
+    struct biquad_t
+    {
+        double      b0;
+        double      b1;
+        double      b2;
+        double      a1;
+        double      a2;
+    };
+
+    /// Фильтры K-взвешивания BS.1770 (полка ВЧ и ФВЧ) для частоты rate
+    void kWeighting(uint32_t rate, biquad_t &shelf, biquad_t &highpass)
+    {
+        // Полка ВЧ +4 дБ (модель головы)
+        double K = std::tan(RESAMPLE_PI * 1681.974450955533 / rate);
+        double Q = 0.7071752369554196;
+        double Vh = std::pow(10.0, 3.999843853973347 / 20.0);
+        double Vb = std::pow(Vh, 0.4996667741545416);
+        double a0 = 1.0 + K / Q + K * K;
+
+        shelf.b0 = (Vh + Vb * K / Q + K * K) / a0;
+        shelf.b1 = 2.0 * (K * K - Vh) / a0;
+        shelf.b2 = (Vh - Vb * K / Q + K * K) / a0;
+        shelf.a1 = 2.0 * (K * K - 1.0) / a0;
+        shelf.a2 = (1.0 - K / Q + K * K) / a0;
+
+        // ФВЧ 38 Гц (RLB)
+        K = std::tan(RESAMPLE_PI * 38.13547087602444 / rate);
+        Q = 0.5003270373238773;
+        a0 = 1.0 + K / Q + K * K;
+
+        highpass.b0 = 1.0;
+        highpass.b1 = -2.0;
+        highpass.b2 = 1.0;
+        highpass.a1 = 2.0 * (K * K - 1.0) / a0;
+        highpass.a2 = (1.0 - K / Q + K * K) / a0;
+    }
+
+    /// Отсчёт i (доля полной шкалы)
+    inline double sampleAt(const unsigned char* src, int bits, size_t i)
+    {
+        if (bits == 16)
+            return reinterpret_cast<const int16_t*>(src)[i] * (1.0 / 32768.0);
+
+        return (src[i] - 128) * (1.0 / 128.0);
+    }
+
+    /*!
+     * \struct analysis_chunk_t
+     * \brief Кусок участка сигнала для анализа одним потоком
+     */
+    struct analysis_chunk_t
+    {
+        const unsigned char*    region;     ///< Начало участка
+        size_t                  begin;      ///< Первый кадр куска в участке
+        size_t                  end;        ///< Следующий за последним кадр
+        size_t                  subFrames;  ///< Длина подблока стробирования, кадров
+        int                     bits;       ///< Бит в сэмпле
+        int                     channels;   ///< Количество каналов
+        int                     index;      ///< Номер участка
+        const biquad_t*         shelf;      ///< Полка ВЧ K-взвешивания
+        const biquad_t*         highpass;   ///< ФВЧ K-взвешивания
+        float                   peak;       ///< Пик, в единицах отсчёта
+        double                  sumSq;      ///< Сумма квадратов отсчётов
+        double                  sumDiff;    ///< Сумма модулей приращений
+        std::vector<double>     energy;     ///< K-взвешенная мощность подблоков
+        bool                    simd;       ///< Векторная ветка
+    };
+
+#ifdef ASOUND_USE_SSE2
+    /// Сумма дорожек вектора
+    inline double horizontalSum(__m128 v)
+    {
+        float lanes[4];
+        _mm_storeu_ps(lanes, v);
+        return static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+
+    /// Анализ куска: пик, суммы и K-взвешенная мощность подблоков
+    void analyzeChunk(analysis_chunk_t &chunk)
+    {
+        const size_t ch = static_cast<size_t>(chunk.channels);
+        const size_t count = (chunk.end - chunk.begin) * ch;
+        // У первого кадра участка нет предыдущего
+        const size_t head = (chunk.begin == 0) ? std::min(ch, count) : 0;
+
+        float peak = 0.0f;
+        double sumSq = 0.0;
+        double sumDiff = 0.0;
+        size_t i = 0;
+
+        if (chunk.bits == 16)
+        {
+            const int16_t* x = reinterpret_cast<const int16_t*>(chunk.region) + chunk.begin * ch;
+
+            for (; i < head; ++i)
+            {
+                float v = x[i];
+                peak = std::max(peak, std::fabs(v));
+                sumSq += static_cast<double>(v) * v;
+            }
+
+#ifdef ASOUND_USE_SSE2
+            if (chunk.simd)
+            {
+                // По 8 отсчётов за шаг; суммы во float периодически переносятся в double
+                const __m128 sign = _mm_set1_ps(-0.0f);
+                __m128 vPeak = _mm_setzero_ps();
+                __m128 vSq = _mm_setzero_ps();
+                __m128 vDiff = _mm_setzero_ps();
+                int steps = 0;
+
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+                    __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i - ch));
+
+                    // Расширение int16 -> int32 со знаком и перевод во float
+                    __m128 cl = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(cur, cur), 16));
+                    __m128 chi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(cur, cur), 16));
+                    __m128 pl = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(prev, prev), 16));
+                    __m128 phi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(prev, prev), 16));
+
+                    vPeak = _mm_max_ps(vPeak, _mm_max_ps(_mm_andnot_ps(sign, cl), _mm_andnot_ps(sign, chi)));
+                    vSq = _mm_add_ps(vSq, _mm_add_ps(_mm_mul_ps(cl, cl), _mm_mul_ps(chi, chi)));
+                    vDiff = _mm_add_ps(vDiff, _mm_add_ps(_mm_andnot_ps(sign, _mm_sub_ps(cl, pl)),
+                                                         _mm_andnot_ps(sign, _mm_sub_ps(chi, phi))));
+
+                    if (++steps == ANALYSIS_FLUSH)
+                    {
+                        sumSq += horizontalSum(vSq);
+                        sumDiff += horizontalSum(vDiff);
+                        vSq = _mm_setzero_ps();
+                        vDiff = _mm_setzero_ps();
+                        steps = 0;
+                    }
+                }
+
+                sumSq += horizontalSum(vSq);
+                sumDiff += horizontalSum(vDiff);
+
+                float lanes[4];
+                _mm_storeu_ps(lanes, vPeak);
+                peak = std::max(peak, std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])));
+            }
+#endif
+
+            // Хвост (и весь кусок без векторной ветки)
+            for (; i < count; ++i)
+            {
+                float v = x[i];
+                peak = std::max(peak, std::fabs(v));
+                sumSq += static_cast<double>(v) * v;
+                sumDiff += std::fabs(v - x[i - ch]);
+            }
+        }
+        else
+        {
+            const uint8_t* x = chunk.region + chunk.begin * ch;
+
+            for (; i < count; ++i)
+            {
+                float v = static_cast<float>(x[i] - 128);
+                peak = std::max(peak, std::fabs(v));
+                sumSq += static_cast<double>(v) * v;
+
+                if (i >= head)
+                    sumDiff += std::fabs(v - static_cast<float>(x[i - ch] - 128));
+            }
+        }
+
+        chunk.peak = peak;
+        chunk.sumSq = sumSq;
+        chunk.sumDiff = sumDiff;
+
+        // K-взвешивание (рекурсивный фильтр - поканально, скалярно);
+        // фильтр разгоняется на кадрах перед куском
+        const biquad_t &sh = *chunk.shelf;
+        const biquad_t &hp = *chunk.highpass;
+        std::vector<double> state(4 * ch, 0.0);
+        double acc = 0.0;
+        size_t inSub = 0;
+
+        chunk.energy.clear();
+        chunk.energy.reserve((chunk.end - chunk.begin) / chunk.subFrames + 1);
+
+        size_t from = (chunk.begin > ANALYSIS_WARMUP) ? chunk.begin - ANALYSIS_WARMUP : 0;
+
+        for (size_t f = from; f < chunk.end; ++f)
+        {
+            double e = 0.0;
+
+            for (size_t c = 0; c < ch; ++c)
+            {
+                double v = sampleAt(chunk.region, chunk.bits, f * ch + c);
+                double* s = &state[4 * c];
+
+                // Транспонированная прямая форма II
+                double y = sh.b0 * v + s[0];
+                s[0] = sh.b1 * v - sh.a1 * y + s[1];
+                s[1] = sh.b2 * v - sh.a2 * y;
+
+                double z = hp.b0 * y + s[2];
+                s[2] = hp.b1 * y - hp.a1 * z + s[3];
+                s[3] = hp.b2 * y - hp.a2 * z;
+
+                e += z * z;
+            }
+
+            if (f < chunk.begin)
+                continue;
+
+            acc += e;
+
+            // Куски начинаются на границах подблоков участка
+            if (++inSub == chunk.subFrames || f + 1 == chunk.end)
+            {
+                chunk.energy.push_back(acc / inSub);
+                acc = 0.0;
+                inSub = 0;
+            }
+        }
+    }
+
+    /// Блоки стробирования (мощность за 400 мс) из подблоков участка
+    void gatingBlocks(const std::vector<double> &energy, std::vector<double> &blocks)
+    {
+        if (energy.empty())
+            return;
+
+        // Участок короче блока - один неполный блок
+        if (energy.size() < LOUDNESS_BLOCK_SUBBLOCKS)
+        {
+            double sum = 0.0;
+
+            for (double e : energy)
+                sum += e;
+
+            blocks.push_back(sum / energy.size());
+            return;
+        }
+
+        for (size_t j = 0; j + LOUDNESS_BLOCK_SUBBLOCKS <= energy.size(); ++j)
+        {
+            double sum = 0.0;
+
+            for (size_t k = 0; k < LOUDNESS_BLOCK_SUBBLOCKS; ++k)
+                sum += energy[j + k];
+
+            blocks.push_back(sum / LOUDNESS_BLOCK_SUBBLOCKS);
+        }
+    }
+
+    /// Интегральная громкость по блокам стробирования (абсолютный и относительный пороги)
+    float gatedLoudness(const std::vector<double> &blocks)
+    {
+        const double absGate = std::pow(10.0, (ASoundDSP::LOUDNESS_SILENCE + 0.691) / 10.0);
+
+        double sum = 0.0;
+        size_t n = 0;
+
+        for (double z : blocks)
+        {
+            if (z > absGate)
+            {
+                sum += z;
+                ++n;
+            }
+        }
+
+        if (n == 0)
+            return ASoundDSP::LOUDNESS_SILENCE;
+
+        const double relGate = sum / n * std::pow(10.0, LOUDNESS_RELATIVE_GATE / 10.0);
+
+        sum = 0.0;
+        n = 0;
+
+        for (double z : blocks)
+        {
+            if (z > absGate && z > relGate)
+            {
+                sum += z;
+                ++n;
+            }
+        }
+
+        if (n == 0)
+            return ASoundDSP::LOUDNESS_SILENCE;
+
+        return static_cast<float>(-0.691 + 10.0 * std::log10(sum / n));
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Измерить уровни участков сигнала
+//-----------------------------------------------------------------------------
+void ASoundDSP::analyze(const unsigned char* src, int bits, int channels, uint32_t rate,
+                        const size_t* frames, int count,
+                        sound_level_t* levels, sound_level_t* total)
+{
+    if ((bits != 8 && bits != 16) || channels <= 0 || rate == 0)
+        return;
+
+    biquad_t shelf, highpass;
+    kWeighting(rate, shelf, highpass);
+
+    const size_t frameBytes = static_cast<size_t>(channels * bits / 8);
+    const size_t subFrames = std::max<size_t>(1, static_cast<size_t>(rate * LOUDNESS_SUBBLOCK));
+    const size_t chunkFrames = subFrames * ANALYSIS_CHUNK_SUBBLOCKS;
+
+    // Куски участков - по целому числу подблоков от начала участка
+    QVector<analysis_chunk_t> chunks;
+    const unsigned char* region = src;
+
+    for (int r = 0; r < count; ++r)
+    {
+        for (size_t begin = 0; begin < frames[r]; begin += chunkFrames)
+        {
+            analysis_chunk_t chunk;
+            chunk.region = region;
+            chunk.begin = begin;
+            chunk.end = std::min(begin + chunkFrames, frames[r]);
+            chunk.subFrames = subFrames;
+            chunk.bits = bits;
+            chunk.channels = channels;
+            chunk.index = r;
+            chunk.shelf = &shelf;
+            chunk.highpass = &highpass;
+            chunk.peak = 0.0f;
+            chunk.sumSq = 0.0;
+            chunk.sumDiff = 0.0;
+            chunk.simd = isSimdEnabled();
+            chunks.append(chunk);
+        }
+
+        region += frames[r] * frameBytes;
+    }
+
+    if (chunks.count() >= ANALYSIS_MT_CHUNKS)
+    {
+        QtConcurrent::blockingMap(chunks, analyzeChunk);
+    }
+    else
+    {
+        for (analysis_chunk_t &chunk : chunks)
+            analyzeChunk(chunk);
+    }
+
+    // Сведение кусков по участкам
+    const double scale = (bits == 16) ? 1.0 / 32768.0 : 1.0 / 128.0;
+
+    std::vector<double> energy, blocks, allBlocks;
+    float totalPeak = 0.0f;
+    double totalSq = 0.0, totalDiff = 0.0;
+    size_t totalSamples = 0, totalDiffs = 0;
+    int k = 0;
+
+    for (int r = 0; r < count; ++r)
+    {
+        float peak = 0.0f;
+        double sumSq = 0.0, sumDiff = 0.0;
+        energy.clear();
+
+        for (; k < chunks.count() && chunks[k].index == r; ++k)
+        {
+            const analysis_chunk_t &chunk = chunks[k];
+            peak = std::max(peak, chunk.peak);
+            sumSq += chunk.sumSq;
+            sumDiff += chunk.sumDiff;
+            energy.insert(energy.end(), chunk.energy.begin(), chunk.energy.end());
+        }
+
+        blocks.clear();
+        gatingBlocks(energy, blocks);
+
+        size_t samples = frames[r] * static_cast<size_t>(channels);
+        size_t diffs = (frames[r] > 1) ? (frames[r] - 1) * static_cast<size_t>(channels) : 0;
+
+        sound_level_t &level = levels[r];
+        level.peak = static_cast<float>(peak * scale);
+        level.rms = samples > 0 ? static_cast<float>(std::sqrt(sumSq / samples) * scale) : 0.0f;
+        level.slope = diffs > 0 ? static_cast<float>(sumDiff / diffs * scale) : 0.0f;
+        level.loudness = gatedLoudness(blocks);
+
+        totalPeak = std::max(totalPeak, peak);
+        totalSq += sumSq;
+        totalDiff += sumDiff;
+        totalSamples += samples;
+        totalDiffs += diffs;
+        allBlocks.insert(allBlocks.end(), blocks.begin(), blocks.end());
+    }
+
+    if (total != nullptr)
+    {
+        total->peak = static_cast<float>(totalPeak * scale);
+        total->rms = totalSamples > 0 ? static_cast<float>(std::sqrt(totalSq / totalSamples) * scale) : 0.0f;
+        total->slope = totalDiffs > 0 ? static_cast<float>(totalDiff / totalDiffs * scale) : 0.0f;
+        total->loudness = gatedLoudness(allBlocks);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Оценить разрыв на стыке
+//-----------------------------------------------------------------------------
+float ASoundDSP::seamScore(const unsigned char* tail, const unsigned char* head,
+                           int bits, int channels, float slope)
+{
+    if ((bits != 8 && bits != 16) || channels <= 0)
+        return 0.0f;
+
+    double worst = 0.0;
+
+    for (int c = 0; c < channels; ++c)
+    {
+        size_t i = static_cast<size_t>(c);
+        double a = sampleAt(tail, bits, i);
+        double b = sampleAt(tail, bits, i + static_cast<size_t>(channels));
+        double h = sampleAt(head, bits, i);
+
+        worst = std::max(worst, std::fabs(h - (2.0 * b - a)));
+    }
+
+    // Не меньше младшего разряда - тишина не даёт бесконечной оценки
+    double lsb = (bits == 16) ? 1.0 / 32768.0 : 1.0 / 128.0;
+
+    return static_cast<float>(worst / std::max(static_cast<double>(slope), lsb));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Кадров сигнала на отсчёт огибающей
+//-----------------------------------------------------------------------------
+size_t ASoundDSP::envelopeStep(uint32_t rate, uint32_t envRate)
+{
+    if (envRate == 0)
+        return 1;
+
+    return std::max<size_t>(1, rate / envRate);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Построить огибающую низких частот
+//-----------------------------------------------------------------------------
+void ASoundDSP::lowEnvelope(const unsigned char* src, int bits, int channels, uint32_t rate,
+                            size_t frames, float cutoff, uint32_t envRate, float* dst)
+{
+    if ((bits != 8 && bits != 16) || channels <= 0 || rate == 0)
+        return;
+
+    const size_t step = envelopeStep(rate, envRate);
+    const size_t ch = static_cast<size_t>(channels);
+
+    // ФНЧ Баттерворта (Q = 1/sqrt(2)); срез - ниже частоты Найквиста
+    double w0 = 2.0 * RESAMPLE_PI * std::min(static_cast<double>(cutoff), 0.45 * rate) / rate;
+    double alpha = std::sin(w0) / std::sqrt(2.0);
+    double a0 = 1.0 + alpha;
+
+    biquad_t lp;
+    lp.b0 = (1.0 - std::cos(w0)) / 2.0 / a0;
+    lp.b1 = (1.0 - std::cos(w0)) / a0;
+    lp.b2 = lp.b0;
+    lp.a1 = -2.0 * std::cos(w0) / a0;
+    lp.a2 = (1.0 - alpha) / a0;
+
+    double s1 = 0.0, s2 = 0.0, acc = 0.0;
+    size_t n = 0, out = 0;
+
+    for (size_t f = 0; f < frames; ++f)
+    {
+        double v = 0.0;
+
+        for (size_t c = 0; c < ch; ++c)
+            v += sampleAt(src, bits, f * ch + c);
+
+        v /= channels;
+
+        // Транспонированная прямая форма II
+        double y = lp.b0 * v + s1;
+        s1 = lp.b1 * v - lp.a1 * y + s2;
+        s2 = lp.b2 * v - lp.a2 * y;
+
+        acc += y * y;
+
+        if (++n == step || f + 1 == frames)
+        {
+            dst[out++] = static_cast<float>(std::sqrt(acc / n));
+            acc = 0.0;
+            n = 0;
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Синтезировать сумму полос полосового шума
+//-----------------------------------------------------------------------------
+void ASoundDSP::noiseLanes(noise_lanes_t &lanes, int16_t* dst, size_t count)
+{
+    size_t n = 0;
+
+#ifdef ASOUND_USE_SSE2
+    static_assert(NOISE_LANES == 4, "SSE2 step handles exactly four lanes");
+
+    if (isSimdEnabled())
+    {
+        // Четыре полосы - один регистр; состояние держим в регистрах весь вызов
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes.seed));
+        __m128 b0 = _mm_loadu_ps(lanes.b0);
+        __m128 a1 = _mm_loadu_ps(lanes.a1);
+        __m128 a2 = _mm_loadu_ps(lanes.a2);
+        __m128 z1 = _mm_loadu_ps(lanes.z1);
+        __m128 z2 = _mm_loadu_ps(lanes.z2);
+        __m128 gain = _mm_loadu_ps(lanes.gain);
+        __m128 step = _mm_loadu_ps(lanes.step);
+
+        const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (; n < count; ++n)
+        {
+            // Белый шум (xorshift32)
+            r = _mm_xor_si128(r, _mm_slli_epi32(r, 13));
+            r = _mm_xor_si128(r, _mm_srli_epi32(r, 17));
+            r = _mm_xor_si128(r, _mm_slli_epi32(r, 5));
+
+            __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(r), scale);
+
+            // Полосовой фильтр (транспонированная II прямая форма, b1 = 0, b2 = -b0)
+            __m128 bx = _mm_mul_ps(b0, x);
+            __m128 v = _mm_add_ps(bx, z1);
+            z1 = _mm_sub_ps(z2, _mm_mul_ps(a1, v));
+            z2 = _mm_sub_ps(_mm_sub_ps(zero, bx), _mm_mul_ps(a2, v));
+
+            gain = _mm_add_ps(gain, step);
+            __m128 y = _mm_mul_ps(v, gain);
+
+            // (y0 + y1) + (y2 + y3) - тот же порядок, что и в скалярной ветке
+            __m128 t = _mm_add_ps(y, _mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 3, 0, 1)));
+            t = _mm_add_ss(t, _mm_movehl_ps(t, t));
+
+            float sample = 32767.0f * _mm_cvtss_f32(t);
+            sample = sample > 32767.0f ? 32767.0f : (sample < -32768.0f ? -32768.0f : sample);
+            dst[n] = static_cast<int16_t>(sample);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.seed), r);
+        _mm_storeu_ps(lanes.z1, z1);
+        _mm_storeu_ps(lanes.z2, z2);
+        _mm_storeu_ps(lanes.gain, gain);
+    }
+#endif
+
+    // Без векторной ветки - по полосам
+    for (; n < count; ++n)
+    {
+        float y[NOISE_LANES];
+
+        for (int l = 0; l < NOISE_LANES; ++l)
+        {
+            uint32_t r = lanes.seed[l];
+            r ^= r << 13;
+            r ^= r >> 17;
+            r ^= r << 5;
+            lanes.seed[l] = r;
+
+            float x = static_cast<float>(static_cast<int32_t>(r)) * (1.0f / 2147483648.0f);
+
+            float v = lanes.b0[l] * x + lanes.z1[l];
+            lanes.z1[l] = lanes.z2[l] - lanes.a1[l] * v;
+            lanes.z2[l] = -lanes.b0[l] * x - lanes.a2[l] * v;
+
+            lanes.gain[l] += lanes.step[l];
+            y[l] = v * lanes.gain[l];
+        }
+
+        float sample = 32767.0f * ((y[0] + y[1]) + (y[2] + y[3]));
+        sample = sample > 32767.0f ? 32767.0f : (sample < -32768.0f ? -32768.0f : sample);
+        dst[n] = static_cast<int16_t>(sample);
+    }
+}
@@ -0,0 +1,402 @@
+//-----------------------------------------------------------------------------
+//
+//      Группы звуков (кабина, окружение, состав, фон, интерфейс)
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-group.h"
+#include "asound.h"
+#include <QMap>
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundGroup::ASoundGroup(QString name, ASoundGroup *parentGroup, QObject *parent)
+    : QObject(parent)
+    , name_(name)
+    , parentGroup_(parentGroup)
+    , gain_(1.0f)
+    , pitch_(1.0f)
+    , paused_(false)
+    , occlusion_(0.0f)
+    , effectiveGain_(1.0f)
+    , effectivePitch_(1.0f)
+    , effectivePaused_(false)
+    , effectiveOcclusion_(0.0f)
+{
+    if (parentGroup_ != Q_NULLPTR)
+    {
+        parentGroup_->children_.append(this);
+
+        effectiveGain_ = parentGroup_->effectiveGain_;
+        effectivePitch_ = parentGroup_->effectivePitch_;
+        effectivePaused_ = parentGroup_->effectivePaused_;
+        effectiveOcclusion_ = parentGroup_->effectiveOcclusion_;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundGroup::~ASoundGroup()
+{
+    AListener::deferAllUpdates();
+
+    // Звуки возвращаются к собственным громкости, скорости и заглушению
+    for (ASound* sound : sounds_)
+    {
+        sound->group_ = Q_NULLPTR;
+
+        if (sound->canPlay_)
+        {
+            sound->select_();
+            alSourcef(sound->source_, AL_GAIN, sound->effectiveGain_());
+            sound->applyPitch_();
+            sound->applyOcclusion_();
+        }
+    }
+
+    setSourcesState_(heldSources_, true);
+
+    // Дочерние группы становятся корневыми
+    for (ASoundGroup* child : children_)
+    {
+        child->parentGroup_ = Q_NULLPTR;
+        child->update_(true);
+    }
+
+    if (parentGroup_ != Q_NULLPTR)
+        parentGroup_->children_.removeOne(this);
+
+    AListener::processAllUpdates();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть имя группы
+//-----------------------------------------------------------------------------
+QString ASoundGroup::getName() const
+{
+    return name_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть родительскую группу
+//-----------------------------------------------------------------------------
+ASoundGroup *ASoundGroup::getParentGroup() const
+{
+    return parentGroup_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть громкость группы
+//-----------------------------------------------------------------------------
+float ASoundGroup::getGain() const
+{
+    return gain_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть множитель скорости воспроизведения группы
+//-----------------------------------------------------------------------------
+float ASoundGroup::getPitch() const
+{
+    return pitch_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Приостановлена ли сама группа
+//-----------------------------------------------------------------------------
+bool ASoundGroup::isPaused() const
+{
+    return paused_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть заглушение группы
+//-----------------------------------------------------------------------------
+float ASoundGroup::getOcclusion() const
+{
+    return occlusion_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Итоговая громкость с учётом родительских групп
+//-----------------------------------------------------------------------------
+float ASoundGroup::getEffectiveGain() const
+{
+    return effectiveGain_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Итоговый множитель скорости с учётом родительских групп
+//-----------------------------------------------------------------------------
+float ASoundGroup::getEffectivePitch() const
+{
+    return effectivePitch_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Приостановлена ли группа или кто-либо из её предков
+//-----------------------------------------------------------------------------
+bool ASoundGroup::isEffectivePaused() const
+{
+    return effectivePaused_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Итоговое заглушение с учётом родительских групп
+//-----------------------------------------------------------------------------
+float ASoundGroup::getEffectiveOcclusion() const
+{
+    return effectiveOcclusion_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть звуки группы
+//-----------------------------------------------------------------------------
+QList<ASound *> ASoundGroup::getSounds() const
+{
+    return sounds_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить громкость группы
+//-----------------------------------------------------------------------------
+void ASoundGroup::setGain(float gain)
+{
+    gain_ = qBound(0.0f, gain, 1.0f);
+    update_(true);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить множитель скорости воспроизведения группы
+//-----------------------------------------------------------------------------
+void ASoundGroup::setPitch(float pitch)
+{
+    pitch_ = qMax(0.0f, pitch);
+    update_(true);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить паузу группы
+//-----------------------------------------------------------------------------
+void ASoundGroup::setPaused(bool paused)
+{
+    if (paused_ == paused)
+        return;
+
+    paused_ = paused;
+    update_(false);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить заглушение прямого пути звуков группы
+//-----------------------------------------------------------------------------
+void ASoundGroup::setOcclusion(float occlusion)
+{
+    occlusion_ = qBound(0.0f, occlusion, 1.0f);
+    update_(true);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Приостановить группу
+//-----------------------------------------------------------------------------
+void ASoundGroup::pause()
+{
+    setPaused(true);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Снять группу с паузы
+//-----------------------------------------------------------------------------
+void ASoundGroup::resume()
+{
+    setPaused(false);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Пересчитать итоговые значения поддерева и применить их к звукам
+//-----------------------------------------------------------------------------
+void ASoundGroup::update_(bool applyParams)
+{
+    QVector<ASound*> toPause;
+    QVector<ASound*> toPlay;
+
+    // Все изменения поддерева микшер применит разом
+    AListener::deferAllUpdates();
+
+    updateTree_(applyParams, toPause, toPlay);
+
+    setSourcesState_(toPause, false);
+    setSourcesState_(toPlay, true);
+
+    AListener::processAllUpdates();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Рекурсивный пересчёт итоговых значений
+//-----------------------------------------------------------------------------
+void ASoundGroup::updateTree_(bool applyParams, QVector<ASound*> &toPause, QVector<ASound*> &toPlay)
+{
+    bool wasPaused = effectivePaused_;
+
+    effectiveGain_ = gain_;
+    effectivePitch_ = pitch_;
+    effectivePaused_ = paused_;
+    effectiveOcclusion_ = occlusion_;
+
+    if (parentGroup_ != Q_NULLPTR)
+    {
+        effectiveGain_ *= parentGroup_->effectiveGain_;
+        effectivePitch_ *= parentGroup_->effectivePitch_;
+        effectivePaused_ = effectivePaused_ || parentGroup_->effectivePaused_;
+        effectiveOcclusion_ = 1.0f - (1.0f - effectiveOcclusion_) *
+                (1.0f - parentGroup_->effectiveOcclusion_);
+    }
+
+    for (ASound* sound : sounds_)
+    {
+        if (!sound->canPlay_)
+            continue;
+
+        if (applyParams)
+        {
+            sound->select_();
+            alSourcef(sound->source_, AL_GAIN, sound->effectiveGain_());
+            sound->applyPitch_();
+            sound->applyOcclusion_();
+        }
+
+        // Запоминаем играющие источники, чтобы снять с паузы только их
+        if (!wasPaused && effectivePaused_ && sound->isPlaying())
+        {
+            heldSources_.append(sound);
+            toPause.append(sound);
+        }
+    }
+
+    if (wasPaused && !effectivePaused_)
+    {
+        toPlay += heldSources_;
+        heldSources_.clear();
+    }
+
+    for (ASoundGroup* child : children_)
+        child->updateTree_(applyParams, toPause, toPlay);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Приостановить или запустить звуки
+//-----------------------------------------------------------------------------
+void ASoundGroup::setSourcesState_(const QVector<ASound *> &sounds, bool play)
+{
+    // Источники разных устройств живут в разных контекстах
+    QMap<AListener*, QVector<ALuint> > sources;
+
+    for (ASound* sound : sounds)
+    {
+        // Без вывода источника нет - состояние расчётное
+        if (sound->stub_)
+            sound->setSourceState_(play ? AL_PLAYING : AL_PAUSED);
+        else
+            sources[sound->listener_].append(sound->source_);
+    }
+
+    for (QMap<AListener*, QVector<ALuint> >::const_iterator it = sources.constBegin();
+         it != sources.constEnd(); ++it)
+    {
+        it.key()->makeCurrent();
+
+        if (play)
+            alSourcePlayv(it.value().count(), it.value().constData());
+        else
+            alSourcePausev(it.value().count(), it.value().constData());
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Добавить звук
+//-----------------------------------------------------------------------------
+void ASoundGroup::addSound_(ASound *sound)
+{
+    sounds_.append(sound);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Удалить звук
+//-----------------------------------------------------------------------------
+bool ASoundGroup::removeSound_(ASound *sound)
+{
+    sounds_.removeOne(sound);
+
+    return heldSources_.removeAll(sound) > 0;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Отложить запуск источника до снятия паузы
+//-----------------------------------------------------------------------------
+void ASoundGroup::holdSource_(ASound *sound)
+{
+    if (!heldSources_.contains(sound))
+        heldSources_.append(sound);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Отменить отложенный запуск источника
+//-----------------------------------------------------------------------------
+void ASoundGroup::releaseSource_(ASound *sound)
+{
+    heldSources_.removeAll(sound);
+}
@@ -0,0 +1,160 @@
+//-----------------------------------------------------------------------------
+//
+//      Выбор уровня детализации звуков по расстоянию до слушателя
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-lod.h"
+#include "asound.h"
+#include <QTimer>
+#include <cmath>
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundLodManager::ASoundLodManager()
+    : QObject(Q_NULLPTR)
+    , timer_(new QTimer(this))
+    , interval_(DEF_LOD_INTERVAL)
+{
+    distances_ << 150.0f << 400.0f;
+
+    connect(timer_, &QTimer::timeout, this, &ASoundLodManager::update);
+}
+
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+ASoundLodManager &ASoundLodManager::getInstance()
+{
+    // Создаем статичный экземпляр класса
+    static ASoundLodManager instance;
+    // Возвращаем его при каждом вызове метода
+    return instance;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить пороги уровней детализации
+//-----------------------------------------------------------------------------
+void ASoundLodManager::setDistances(const QVector<float> &distances)
+{
+    distances_ = distances;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть пороги уровней детализации
+//-----------------------------------------------------------------------------
+QVector<float> ASoundLodManager::getDistances() const
+{
+    return distances_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить период пересчёта
+//-----------------------------------------------------------------------------
+void ASoundLodManager::setInterval(int ms)
+{
+    interval_ = qMax(0, ms);
+
+    if (interval_ == 0)
+    {
+        timer_->stop();
+    }
+    else
+    {
+        timer_->setInterval(interval_);
+
+        if (!sounds_.isEmpty())
+            timer_->start();
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Добавить звук с вариантами детализации
+//-----------------------------------------------------------------------------
+void ASoundLodManager::add(ASound *sound)
+{
+    if (!sounds_.contains(sound))
+        sounds_.append(sound);
+
+    if (interval_ > 0 && !timer_->isActive())
+        timer_->start(interval_);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Удалить звук
+//-----------------------------------------------------------------------------
+void ASoundLodManager::remove(ASound *sound)
+{
+    sounds_.removeOne(sound);
+
+    if (sounds_.isEmpty())
+        timer_->stop();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Пересчитать уровни детализации всех звуков
+//-----------------------------------------------------------------------------
+void ASoundLodManager::update()
+{
+    float listener[3];
+
+    AListener::deferAllUpdates();
+
+    for (ASound* sound : sounds_)
+    {
+        // Расстояние - до слушателя устройства, на котором звучит звук
+        sound->listener_->getPosition(listener[0], listener[1], listener[2]);
+
+        float dx = sound->sourcePosition_[0] - listener[0];
+        float dy = sound->sourcePosition_[1] - listener[1];
+        float dz = sound->sourcePosition_[2] - listener[2];
+
+        // Приоритетные звуки "приближаем"
+        float distance = std::sqrt(dx * dx + dy * dy + dz * dz) / (1.0f + sound->priority_);
+
+        int level = selectLevel_(sound->currentLod_, sound->lods_.count(), distance);
+
+        sound->requestLod_(level);
+        sound->pollLod_();
+    }
+
+    AListener::processAllUpdates();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Выбрать уровень звука по расстоянию
+//-----------------------------------------------------------------------------
+int ASoundLodManager::selectLevel_(int current, int count, float distance) const
+{
+    int levels = qMin(count, distances_.count() + 1);
+    int level = qMin(current, levels - 1);
+
+    // Дальше порога следующего уровня - огрубляем
+    while (level + 1 < levels && distance >= distances_[level])
+        ++level;
+
+    // Возвращаемся с запасом, чтобы не переключаться туда-обратно на пороге
+    while (level > 0 && distance < distances_[level - 1] * (1.0f - LOD_HYSTERESIS))
+        --level;
+
+    return level;
+}
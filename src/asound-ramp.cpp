@@ -0,0 +1,205 @@
+//-----------------------------------------------------------------------------
+//
+//      Плавное изменение громкости и скорости воспроизведения
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-ramp.h"
+#include "asound.h"
+#include <QTimer>
+#include <cmath>
+
+/// Период шага изменений, если микшер не сообщил частоту обновления, мс
+const int DEF_RAMP_PERIOD = 10;
+
+// ****************************************************************************
+// *                          Класс ASoundRamp                                *
+// ****************************************************************************
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundRamp::ASoundRamp()
+    : active_(false)
+    , from_(0.0f)
+    , to_(0.0f)
+    , start_(0)
+    , duration_(0)
+    , curve_(RAMP_LINEAR)
+{
+
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Начать изменение
+//-----------------------------------------------------------------------------
+void ASoundRamp::start(float from, float to, qint64 now, int ms, int curve)
+{
+    from_ = from;
+    to_ = to;
+    start_ = now;
+    duration_ = qMax(1, ms);
+    curve_ = curve;
+
+    // Экспонента не проходит через ноль - такой участок делаем линейным
+    if (curve_ == RAMP_EXPONENTIAL && (from_ <= 0.0f || to_ <= 0.0f))
+        curve_ = RAMP_LINEAR;
+
+    active_ = true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Прервать изменение
+//-----------------------------------------------------------------------------
+void ASoundRamp::stop()
+{
+    active_ = false;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Идёт ли изменение
+//-----------------------------------------------------------------------------
+bool ASoundRamp::isActive() const
+{
+    return active_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Значение на момент now
+//-----------------------------------------------------------------------------
+float ASoundRamp::step(qint64 now)
+{
+    float t = static_cast<float>(now - start_) / static_cast<float>(duration_);
+
+    if (t >= 1.0f)
+    {
+        active_ = false;
+        return to_;
+    }
+
+    if (t < 0.0f)
+        t = 0.0f;
+
+    switch (curve_)
+    {
+    case RAMP_EXPONENTIAL:
+        return from_ * std::pow(to_ / from_, t);
+
+    case RAMP_SMOOTH:
+        t = t * t * (3.0f - 2.0f * t);
+        break;
+
+    default:
+        break;
+    }
+
+    return from_ + (to_ - from_) * t;
+}
+
+
+
+// ****************************************************************************
+// *                         Класс ASoundRamper                               *
+// ****************************************************************************
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundRamper::ASoundRamper()
+    : QObject(Q_NULLPTR)
+    , timer_(new QTimer(this))
+{
+    int refresh = AListener::getInstance().getRefresh();
+
+    // Шаг равен периоду обновления микшера: чаще подавать значения бессмысленно
+    timer_->setInterval(refresh > 0 ? qMax(1, 1000 / refresh) : DEF_RAMP_PERIOD);
+    timer_->setTimerType(Qt::PreciseTimer);
+
+    connect(timer_, &QTimer::timeout, this, &ASoundRamper::onTick);
+
+    clock_.start();
+}
+
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+ASoundRamper &ASoundRamper::getInstance()
+{
+    // Создаем статичный экземпляр класса
+    static ASoundRamper instance;
+    // Возвращаем его при каждом вызове метода
+    return instance;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Текущее время
+//-----------------------------------------------------------------------------
+qint64 ASoundRamper::now() const
+{
+    return clock_.elapsed();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Добавить звук с активными изменениями
+//-----------------------------------------------------------------------------
+void ASoundRamper::add(ASound *sound)
+{
+    if (!sounds_.contains(sound))
+        sounds_.append(sound);
+
+    if (!timer_->isActive())
+        timer_->start();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Удалить звук
+//-----------------------------------------------------------------------------
+void ASoundRamper::remove(ASound *sound)
+{
+    sounds_.removeOne(sound);
+
+    if (sounds_.isEmpty())
+        timer_->stop();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Шаг изменений
+//-----------------------------------------------------------------------------
+void ASoundRamper::onTick()
+{
+    qint64 time = now();
+
+    AListener::deferAllUpdates();
+
+    QList<ASound*>::iterator it = sounds_.begin();
+    while (it != sounds_.end())
+    {
+        if ((*it)->advanceRamps_(time))
+            ++it;
+        else
+            it = sounds_.erase(it);
+    }
+
+    AListener::processAllUpdates();
+
+    if (sounds_.isEmpty())
+        timer_->stop();
+}
@@ -0,0 +1,311 @@
+//-----------------------------------------------------------------------------
+//
+//      Перезагрузка изменившихся аудиофайлов без перезапуска
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-reload.h"
+#include "asound.h"
+#include "asound-store.h"
+#include <QTimer>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundReloader::ASoundReloader()
+    : QObject(Q_NULLPTR)
+    , enabled_(false)
+    , watcher_(new QFileSystemWatcher(this))
+    , timer_(new QTimer(this))
+{
+    // Редакторы сохраняют файл в несколько приёмов - ждём затишья
+    timer_->setSingleShot(true);
+    timer_->setInterval(DEF_RELOAD_DELAY);
+
+    connect(watcher_, &QFileSystemWatcher::fileChanged, this, &ASoundReloader::onFileChanged_);
+    connect(timer_, &QTimer::timeout, this, &ASoundReloader::onTimer_);
+
+    clock_.start();
+}
+
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+ASoundReloader &ASoundReloader::getInstance()
+{
+    // Создаем статичный экземпляр класса
+    static ASoundReloader instance;
+    // Возвращаем его при каждом вызове метода
+    return instance;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Включить или выключить отслеживание файлов
+//-----------------------------------------------------------------------------
+void ASoundReloader::setEnabled(bool enabled)
+{
+    if (enabled_ == enabled)
+        return;
+
+    enabled_ = enabled;
+
+    if (enabled_)
+    {
+        for (ASound* sound : sounds_)
+        {
+            if (!watcher_->files().contains(sound->soundName_))
+                watcher_->addPath(sound->soundName_);
+        }
+    }
+    else
+    {
+        for (const QString &path : watcher_->files())
+            watcher_->removePath(path);
+
+        timer_->stop();
+        pending_.clear();
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Включено ли отслеживание
+//-----------------------------------------------------------------------------
+bool ASoundReloader::isEnabled() const
+{
+    return enabled_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить задержку перезагрузки после последнего изменения
+//-----------------------------------------------------------------------------
+void ASoundReloader::setDelay(int ms)
+{
+    timer_->setInterval(qMax(0, ms));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Добавить звук, загруженный из файла
+//-----------------------------------------------------------------------------
+void ASoundReloader::add(ASound *sound)
+{
+    if (!sounds_.contains(sound))
+        sounds_.append(sound);
+
+    if (enabled_ && !watcher_->files().contains(sound->soundName_))
+        watcher_->addPath(sound->soundName_);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Удалить звук
+//-----------------------------------------------------------------------------
+void ASoundReloader::remove(ASound *sound)
+{
+    if (!sounds_.removeOne(sound))
+        return;
+
+    if (enabled_ && !isUsed_(sound->soundName_))
+        watcher_->removePath(sound->soundName_);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Перезагрузить файл немедленно
+//-----------------------------------------------------------------------------
+void ASoundReloader::reload(const QString &soundname)
+{
+    // Файл меняется повторно во время разбора - перезагрузим ещё раз
+    if (busy_.contains(soundname))
+    {
+        pending_.insert(soundname);
+        return;
+    }
+
+    // Каждое сочетание флагов и частоты разбирается один раз
+    QVector<reload_variant_t> variants;
+
+    for (ASound* sound : sounds_)
+    {
+        if (sound->soundName_ != soundname)
+            continue;
+
+        reload_variant_t variant;
+        variant.loadFlags = sound->loadFlags_;
+        variant.deviceRate = static_cast<uint32_t>(sound->listener_->getFrequency());
+
+        bool found = false;
+
+        for (const reload_variant_t &other : variants)
+        {
+            found = other.loadFlags == variant.loadFlags &&
+                    ((variant.loadFlags & LOAD_RESAMPLE) == 0 || other.deviceRate == variant.deviceRate);
+
+            if (found)
+                break;
+        }
+
+        if (!found)
+            variants.append(variant);
+    }
+
+    if (variants.isEmpty())
+        return;
+
+    busy_.insert(soundname);
+
+    QFutureWatcher<QVector<reload_variant_t> >* watcher =
+            new QFutureWatcher<QVector<reload_variant_t> >(this);
+
+    connect(watcher, &QFutureWatcher<QVector<reload_variant_t> >::finished,
+            this, [this, soundname, watcher]() { onReloaded_(soundname, watcher); });
+
+    // Разбор файла - в пуле потоков, замена данных - в потоке объекта
+    watcher->setFuture(QtConcurrent::run([soundname, variants]() {
+        QVector<reload_variant_t> result = variants;
+
+        for (reload_variant_t &variant : result)
+        {
+            variant.data = ASoundStore::getInstance().reload(soundname, variant.loadFlags,
+                                                             variant.deviceRate, variant.error);
+        }
+
+        return result;
+    }));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Файл изменился
+//-----------------------------------------------------------------------------
+void ASoundReloader::onFileChanged_(const QString &path)
+{
+    pending_.insert(path);
+    timer_->start();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Истекла задержка - перезагрузить изменившиеся файлы
+//-----------------------------------------------------------------------------
+void ASoundReloader::onTimer_()
+{
+    QSet<QString> pending = pending_;
+    pending_.clear();
+
+    for (const QString &path : pending)
+    {
+        // Файл, сохранённый заменой, ещё не появился - подождём
+        if (!QFile::exists(path))
+        {
+            pending_.insert(path);
+            continue;
+        }
+
+        // При замене файла наблюдение за прежним снимается
+        if (!watcher_->files().contains(path))
+            watcher_->addPath(path);
+
+        reload(path);
+    }
+
+    if (!pending_.isEmpty())
+        timer_->start();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Обработка завершения фонового разбора
+//-----------------------------------------------------------------------------
+void ASoundReloader::onReloaded_(const QString &soundname,
+                                 QFutureWatcher<QVector<reload_variant_t> > *watcher)
+{
+    QVector<reload_variant_t> variants = watcher->result();
+    watcher->deleteLater();
+
+    busy_.remove(soundname);
+
+    QString error;
+    qint64 now = clock_.elapsed();
+
+    // Все звуки файла получают новые данные разом
+    AListener::deferAllUpdates();
+
+    for (ASound* sound : sounds_)
+    {
+        if (sound->soundName_ != soundname)
+            continue;
+
+        uint32_t deviceRate = static_cast<uint32_t>(sound->listener_->getFrequency());
+
+        for (const reload_variant_t &variant : variants)
+        {
+            if (variant.loadFlags != sound->loadFlags_ ||
+                ((variant.loadFlags & LOAD_RESAMPLE) != 0 && variant.deviceRate != deviceRate))
+            {
+                continue;
+            }
+
+            if (variant.data.isNull())
+                error = variant.error;
+            else
+                sound->swapData_(variant.data, now);
+
+            break;
+        }
+    }
+
+    AListener::processAllUpdates();
+
+    if (error.isEmpty())
+    {
+        AListener::getInstance().log_->notify("T Reloaded: " + soundname.toStdString());
+        emit reloaded(soundname);
+    }
+    else
+    {
+        AListener::getInstance().log_->notify("E - CANT_RELOAD: " + soundname.toStdString() +
+                                              " (" + error.toStdString() + ")");
+        emit failed(soundname, error);
+    }
+
+    // Файл изменился во время разбора
+    if (pending_.contains(soundname))
+        timer_->start();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Используется ли файл каким-либо звуком
+//-----------------------------------------------------------------------------
+bool ASoundReloader::isUsed_(const QString &soundname) const
+{
+    for (ASound* sound : sounds_)
+    {
+        if (sound->soundName_ == soundname)
+            return true;
+    }
+
+    return false;
+}
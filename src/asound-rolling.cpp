@@ -0,0 +1,221 @@
+//-----------------------------------------------------------------------------
+//
+//      Генератор шума качения колеса по рельсу
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-rolling.h"
+#include <cmath>
+
+/// Длина волны неровностей поверхности катания, м
+const float ROLLING_WAVELENGTH = 0.04f;
+
+/// Скорость, к которой приведены уровни шума, м/с
+const float ROLLING_REF_SPEED = 30.0f;
+
+/// Радиус кривой, с которого появляется гребневый шум, м
+const float FLANGE_RADIUS_MIN = 800.0f;
+
+/// Радиус кривой, в которой гребневый шум максимален, м
+const float FLANGE_RADIUS_MAX = 150.0f;
+
+/// Полосы генератора
+enum
+{
+    LANE_ROLLING    = 0,    ///< Шум качения (неровности колеса и рельса)
+    LANE_RESONANCE  = 1,    ///< Резонанс колеса и рельса
+    LANE_FLANGE     = 2,    ///< Гребневый шум в кривых
+    LANE_RUMBLE     = 3     ///< Низкочастотный гул
+};
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ARollingNoise::ARollingNoise(QObject *parent, AListener *output, uint32_t seed)
+    : ASound(parent, output)
+    , speed_(0.0f)
+    , curvature_(0.0f)
+    , quality_(1.0f)
+    , rate_(static_cast<float>(getOutput()->getFrequency()))
+{
+    for (int l = 0; l < ROLLING_LANES; ++l)
+    {
+        // Генератор xorshift не должен начинаться с нуля
+        lanes_.seed[l] = (seed + 0x9E3779B9u * static_cast<uint32_t>(l + 1)) | 1u;
+    }
+
+    if (rate_ <= 0.0f)
+        rate_ = 44100.0f;
+
+    updateLanes_();
+
+    emit notify("T Rolling noise generator: " + QString::number(rate_).toStdString() + " Hz");
+
+    setupStream_(AL_FORMAT_MONO16, static_cast<ALsizei>(rate_), &ARollingNoise::callback_, this);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ARollingNoise::~ARollingNoise()
+{
+    // Источник удаляем раньше состояния генератора
+    releaseStream_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть скорость
+//-----------------------------------------------------------------------------
+float ARollingNoise::getSpeed() const
+{
+    return speed_.load();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть кривизну пути
+//-----------------------------------------------------------------------------
+float ARollingNoise::getCurvature() const
+{
+    return curvature_.load();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть состояние рельсов
+//-----------------------------------------------------------------------------
+float ARollingNoise::getRailQuality() const
+{
+    return quality_.load();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить скорость
+//-----------------------------------------------------------------------------
+void ARollingNoise::setSpeed(float speed)
+{
+    speed_.store(std::fabs(speed));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить кривизну пути
+//-----------------------------------------------------------------------------
+void ARollingNoise::setCurvature(float curvature)
+{
+    curvature_.store(std::fabs(curvature));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить состояние рельсов
+//-----------------------------------------------------------------------------
+void ARollingNoise::setRailQuality(float quality)
+{
+    quality_.store(qBound(0.0f, quality, 1.0f));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Наполнение буфера
+//-----------------------------------------------------------------------------
+ALsizei ARollingNoise::callback_(ALvoid *userptr, ALvoid *data, ALsizei size)
+{
+    ARollingNoise* self = static_cast<ARollingNoise*>(userptr);
+
+    self->render_(static_cast<ALshort*>(data), size / static_cast<ALsizei>(sizeof(ALshort)));
+
+    return size;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Синтезировать сэмплы
+//-----------------------------------------------------------------------------
+void ARollingNoise::render_(ALshort *out, int count)
+{
+    while (count > 0)
+    {
+        int block = qMin(count, ROLLING_BLOCK);
+
+        // Параметры движения меняются медленно - достаточно раз на блок
+        updateLanes_();
+
+        // Полосы независимы - шаг по всем сразу (SSE2, если есть)
+        ASoundDSP::noiseLanes(lanes_, out, static_cast<size_t>(block));
+
+        out += block;
+        count -= block;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Пересчитать фильтры и громкости полос
+//-----------------------------------------------------------------------------
+void ARollingNoise::updateLanes_()
+{
+    float speed = speed_.load();
+    float curvature = curvature_.load();
+    float quality = quality_.load();
+
+    float target[ROLLING_LANES];
+
+    // Шум качения растёт примерно как 30 lg(v), изношенные рельсы -
+    // до +10 дБ
+    float v = speed / ROLLING_REF_SPEED;
+    float rolling = v * std::sqrt(v) * (1.0f + 2.0f * (1.0f - quality));
+
+    // Частота возбуждения - скорость, делённая на длину волны неровностей
+    float nyquist = 0.45f * rate_;
+    setBand_(LANE_ROLLING, qBound(80.0f, speed / ROLLING_WAVELENGTH, nyquist), 0.7f);
+    target[LANE_ROLLING] = 0.35f * rolling;
+
+    setBand_(LANE_RESONANCE, qMin(1200.0f, nyquist), 1.5f);
+    target[LANE_RESONANCE] = 0.2f * rolling;
+
+    // Гребневый шум - в кривых малого радиуса, узкополосный
+    float k = (curvature - 1.0f / FLANGE_RADIUS_MIN) /
+            (1.0f / FLANGE_RADIUS_MAX - 1.0f / FLANGE_RADIUS_MIN);
+    float flange = qBound(0.0f, k, 1.0f) * qMin(1.0f, speed / 10.0f);
+    setBand_(LANE_FLANGE, qMin(3000.0f + 20.0f * speed, nyquist), 8.0f);
+    target[LANE_FLANGE] = 0.6f * flange;
+
+    setBand_(LANE_RUMBLE, 60.0f + 1.5f * speed, 0.7f);
+    target[LANE_RUMBLE] = 0.5f * rolling * (1.5f - quality);
+
+    // Громкости меняются плавно в течение блока
+    for (int l = 0; l < ROLLING_LANES; ++l)
+        lanes_.step[l] = (qMin(target[l], 1.0f) - lanes_.gain[l]) / ROLLING_BLOCK;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Настроить полосовой фильтр полосы
+//-----------------------------------------------------------------------------
+void ARollingNoise::setBand_(int lane, float frequency, float q)
+{
+    float w0 = 6.2831853f * frequency / rate_;
+    float alpha = std::sin(w0) / (2.0f * q);
+    float a0 = 1.0f + alpha;
+
+    lanes_.b0[lane] = alpha / a0;
+    lanes_.a1[lane] = -2.0f * std::cos(w0) / a0;
+    lanes_.a2[lane] = (1.0f - alpha) / a0;
+}
@@ -0,0 +1,689 @@
+//-----------------------------------------------------------------------------
+//
+//      Общее хранилище загруженных звуков и их предзагрузка
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-store.h"
+#include "asound.h"
+#include <QFutureWatcher>
+#include <QMutexLocker>
+#include <QtConcurrent>
+#include <limits>
+
+// ****************************************************************************
+// *                         Класс ASoundStore                                *
+// ****************************************************************************
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundStore::ASoundStore()
+{
+
+}
+
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+ASoundStore &ASoundStore::getInstance()
+{
+    // Создаем статичный экземпляр класса
+    static ASoundStore instance;
+    // Возвращаем его при каждом вызове метода
+    return instance;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть звук из хранилища или загрузить его
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> ASoundStore::load(const QString &soundname, int loadFlags,
+                                             uint32_t deviceRate, QString &error)
+{
+    QString key = key_(soundname, loadFlags, deviceRate);
+
+    QMutexLocker locker(&mutex_);
+
+    // Звук уже грузится в другом потоке - дожидаемся его
+    while (loading_.contains(key))
+        loaded_.wait(&mutex_);
+
+    QSharedPointer<ASoundData> data = findLocked_(key);
+
+    if (!data.isNull())
+        return data;
+
+    loading_.insert(key);
+    QSharedPointer<ASoundArena> arena = arena_;
+    locker.unlock();
+
+    // Разбор и обработка - без блокировки хранилища (без вывода звука
+    // достаточно разметки файла). При загрузке в пул исходные данные
+    // читаются в пул потока, в пул хранилища попадает только итог
+    AWaveReader reader;
+
+    if (!arena.isNull())
+        reader.setArena(ASoundArena::scratch());
+
+    QSharedPointer<ASoundData> raw = reader.read(soundname,
+                                                 AListener::getBackend() != BACKEND_NULL);
+
+    // Копия уже загруженного файла обрабатывается, но не хранится повторно
+    if (arena.isNull())
+        share_(raw);
+
+    data = AWaveReader::process(raw, loadFlags, deviceRate, arena);
+
+    if (data != raw)
+        share_(data);
+
+    if (data.isNull())
+        error = reader.getLastError();
+
+    locker.relock();
+
+    if (!data.isNull())
+        entries_[key].shared = data;
+
+    loading_.remove(key);
+    loaded_.wakeAll();
+
+    return data;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть звук, если он уже загружен
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> ASoundStore::find(const QString &soundname, int loadFlags,
+                                             uint32_t deviceRate)
+{
+    QString key = key_(soundname, loadFlags, deviceRate);
+
+    QMutexLocker locker(&mutex_);
+
+    return findLocked_(key);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть упрощённый вариант звука или построить его
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> ASoundStore::lodVariant(const QString &soundname, int loadFlags,
+                                                   int level, QSharedPointer<ASoundData> data)
+{
+    // Вариант строится из данных конкретного устройства
+    QString key = key_(soundname, loadFlags, data->info.sampleRate) + "|lod" + QString::number(level);
+
+    QMutexLocker locker(&mutex_);
+
+    QSharedPointer<ASoundData> variant = findLocked_(key);
+
+    if (!variant.isNull())
+        return variant;
+
+    locker.unlock();
+
+    // Вариант - в том же пуле, что и исходный звук
+    variant = AWaveReader::makeLodVariant(data, level, AWaveReader::arenaOf(data));
+
+    if (variant.isNull())
+        return variant;
+
+    share_(variant);
+
+    locker.relock();
+
+    // Вариант мог построить другой поток - берём первый
+    QSharedPointer<ASoundData> other = findLocked_(key);
+
+    if (!other.isNull())
+        return other;
+
+    entries_[key].shared = variant;
+
+    return variant;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Перечитать изменившийся файл и заменить им данные хранилища
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> ASoundStore::reload(const QString &soundname, int loadFlags,
+                                               uint32_t deviceRate, QString &error)
+{
+    QString key = key_(soundname, loadFlags, deviceRate);
+
+    QMutexLocker locker(&mutex_);
+
+    while (loading_.contains(key))
+        loaded_.wait(&mutex_);
+
+    loading_.insert(key);
+
+    // Перечитанный звук остаётся в пуле прежних данных
+    QSharedPointer<ASoundData> previous = findLocked_(key);
+    QSharedPointer<ASoundArena> arena = previous.isNull() ?
+                arena_ : AWaveReader::arenaOf(previous);
+    previous.clear();
+
+    locker.unlock();
+
+    AWaveReader reader;
+
+    if (!arena.isNull())
+        reader.setArena(ASoundArena::scratch());
+
+    QSharedPointer<ASoundData> raw = reader.read(soundname,
+                                                 AListener::getBackend() != BACKEND_NULL);
+
+    if (arena.isNull())
+        share_(raw);
+
+    QSharedPointer<ASoundData> data = AWaveReader::process(raw, loadFlags, deviceRate, arena);
+
+    if (data != raw)
+        share_(data);
+
+    if (data.isNull())
+        error = reader.getLastError();
+
+    locker.relock();
+
+    if (!data.isNull())
+    {
+        store_entry_t &entry = entries_[key];
+
+        if (!entry.pinned.isNull())
+            entry.pinned = data;
+
+        entry.shared = data;
+
+        // Варианты детализации построены из прежних данных
+        QString lodPrefix = key + "|lod";
+
+        QMap<QString, store_entry_t>::iterator it = entries_.lowerBound(lodPrefix);
+        while (it != entries_.end() && it.key().startsWith(lodPrefix))
+            it = entries_.erase(it);
+    }
+
+    loading_.remove(key);
+    loaded_.wakeAll();
+
+    return data;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Закрепить звук в памяти
+//-----------------------------------------------------------------------------
+void ASoundStore::pin(const QString &soundname, int loadFlags, uint32_t deviceRate)
+{
+    QString key = key_(soundname, loadFlags, deviceRate);
+
+    QMutexLocker locker(&mutex_);
+
+    QSharedPointer<ASoundData> data = findLocked_(key);
+
+    if (!data.isNull())
+        entries_[key].pinned = data;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Снять закрепление
+//-----------------------------------------------------------------------------
+void ASoundStore::unpin(const QString &soundname, int loadFlags, uint32_t deviceRate)
+{
+    QString key = key_(soundname, loadFlags, deviceRate);
+
+    QMutexLocker locker(&mutex_);
+
+    QMap<QString, store_entry_t>::iterator it = entries_.find(key);
+
+    if (it == entries_.end())
+        return;
+
+    it.value().pinned.clear();
+
+    // Если источников не осталось - данные освобождаются здесь же
+    if (it.value().shared.toStrongRef().isNull())
+        entries_.erase(it);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Снять все закрепления
+//-----------------------------------------------------------------------------
+void ASoundStore::unpinAll()
+{
+    QMutexLocker locker(&mutex_);
+
+    QMap<QString, store_entry_t>::iterator it = entries_.begin();
+    while (it != entries_.end())
+    {
+        it.value().pinned.clear();
+
+        if (it.value().shared.toStrongRef().isNull())
+            it = entries_.erase(it);
+        else
+            ++it;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Задать пул для PCM данных последующих загрузок
+//-----------------------------------------------------------------------------
+void ASoundStore::setArena(QSharedPointer<ASoundArena> arena)
+{
+    QMutexLocker locker(&mutex_);
+
+    arena_ = arena;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть пул для PCM данных загрузок
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundArena> ASoundStore::getArena()
+{
+    QMutexLocker locker(&mutex_);
+
+    return arena_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Ключ записи
+//-----------------------------------------------------------------------------
+QString ASoundStore::key_(const QString &soundname, int loadFlags, uint32_t deviceRate)
+{
+    QString key = soundname + "|" + QString::number(loadFlags);
+
+    if (loadFlags & LOAD_RESAMPLE)
+    {
+        if (deviceRate == 0)
+            deviceRate = static_cast<uint32_t>(AListener::getInstance().getFrequency());
+
+        key += "|" + QString::number(deviceRate);
+    }
+
+    return key;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Найти действующие данные (под блокировкой)
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> ASoundStore::findLocked_(const QString &key)
+{
+    QMap<QString, store_entry_t>::iterator it = entries_.find(key);
+
+    if (it == entries_.end())
+        return QSharedPointer<ASoundData>();
+
+    if (!it.value().pinned.isNull())
+        return it.value().pinned;
+
+    QSharedPointer<ASoundData> data = it.value().shared.toStrongRef();
+
+    // Источники, использовавшие звук, удалены - запись больше не нужна
+    if (data.isNull())
+        entries_.erase(it);
+
+    return data;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Перевести данные звука на уже загруженные PCM данные того же содержимого
+//-----------------------------------------------------------------------------
+void ASoundStore::share_(QSharedPointer<ASoundData> data)
+{
+    if (data.isNull() || data->storage.isNull() || data->dataSize == 0)
+        return;
+
+    const unsigned char* pcm = data->block[0];
+
+    // Кандидаты удерживаются, чтобы сравнивать без блокировки
+    QList<QSharedPointer<ASoundStorage> > storages;
+    QList<pcm_entry_t> candidates;
+
+    QMutexLocker locker(&mutex_);
+
+    QMultiMap<uint64_t, pcm_entry_t>::iterator it = pcm_.find(data->pcmHash);
+    while (it != pcm_.end() && it.key() == data->pcmHash)
+    {
+        QSharedPointer<ASoundStorage> storage = it.value().storage.toStrongRef();
+
+        // Память освобождена - запись больше не нужна
+        if (storage.isNull())
+        {
+            it = pcm_.erase(it);
+            continue;
+        }
+
+        const pcm_entry_t &entry = it.value();
+
+        if (entry.size == data->dataSize &&
+            entry.info.numChannels == data->info.numChannels &&
+            entry.info.bitsPerSample == data->info.bitsPerSample &&
+            entry.info.sampleRate == data->info.sampleRate)
+        {
+            storages.append(storage);
+            candidates.append(entry);
+        }
+
+        ++it;
+    }
+
+    locker.unlock();
+
+    for (int i = 0; i < candidates.count(); ++i)
+    {
+        const pcm_entry_t &entry = candidates[i];
+
+        if (memcmp(entry.pcm, pcm, data->dataSize) != 0)
+            continue;
+
+        // Блоки лежат подряд от начала данных - переносим их смещения
+        for (int b = 0; b < BUFFER_BLOCKS; ++b)
+        {
+            if (data->block[b] != nullptr)
+                data->block[b] = entry.pcm + (data->block[b] - pcm);
+        }
+
+        data->storage = storages[i];
+
+        return;
+    }
+
+    pcm_entry_t entry;
+    entry.storage = data->storage;
+    entry.pcm = pcm;
+    entry.size = data->dataSize;
+    entry.info = data->info;
+
+    locker.relock();
+    pcm_.insert(data->pcmHash, entry);
+}
+
+
+
+// ****************************************************************************
+// *                       Класс ASoundPrefetcher                             *
+// ****************************************************************************
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundPrefetcher::ASoundPrefetcher(QObject *parent)
+    : QObject(parent)
+    , position_(0.0)
+    , lookahead_(std::numeric_limits<double>::max())
+    , evictMargin_(0.0)
+    , maxLoads_(2)
+    , activeLoads_(0)
+{
+
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundPrefetcher::~ASoundPrefetcher()
+{
+    // Снимаем закрепления всех предзагруженных звуков
+    QMap<QString, prefetch_request_t>::const_iterator it = requests_.constBegin();
+    while (it != requests_.constEnd())
+    {
+        if (it.value().ready)
+            ASoundStore::getInstance().unpin(it.value().soundname, it.value().loadFlags);
+        ++it;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Запросить предзагрузку звука
+//-----------------------------------------------------------------------------
+void ASoundPrefetcher::prefetch(const QString &soundname, double neededAt, int loadFlags)
+{
+    loadFlags |= AListener::getInstance().getDefaultLoadFlags();
+
+    QString key = key_(soundname, loadFlags);
+
+    QMap<QString, prefetch_request_t>::iterator it = requests_.find(key);
+
+    if (it != requests_.end())
+    {
+        // Повторный запрос лишь уточняет срок
+        it.value().neededAt = neededAt;
+    }
+    else
+    {
+        prefetch_request_t request;
+        request.soundname = soundname;
+        request.loadFlags = loadFlags;
+        request.neededAt = neededAt;
+        request.ready = false;
+        request.loading = false;
+        requests_.insert(key, request);
+    }
+
+    schedule_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Отменить запрос и снять закрепление звука
+//-----------------------------------------------------------------------------
+void ASoundPrefetcher::release(const QString &soundname, int loadFlags)
+{
+    loadFlags |= AListener::getInstance().getDefaultLoadFlags();
+
+    QMap<QString, prefetch_request_t>::iterator it = requests_.find(key_(soundname, loadFlags));
+
+    if (it == requests_.end())
+        return;
+
+    if (it.value().ready)
+        ASoundStore::getInstance().unpin(soundname, loadFlags);
+
+    requests_.erase(it);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Загружен ли звук
+//-----------------------------------------------------------------------------
+bool ASoundPrefetcher::isReady(const QString &soundname, int loadFlags)
+{
+    loadFlags |= AListener::getInstance().getDefaultLoadFlags();
+
+    return !ASoundStore::getInstance().find(soundname, loadFlags).isNull();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить глубину упреждения
+//-----------------------------------------------------------------------------
+void ASoundPrefetcher::setLookahead(double lookahead)
+{
+    lookahead_ = lookahead;
+    schedule_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить запас позади
+//-----------------------------------------------------------------------------
+void ASoundPrefetcher::setEvictMargin(double margin)
+{
+    evictMargin_ = margin;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить количество одновременных фоновых загрузок
+//-----------------------------------------------------------------------------
+void ASoundPrefetcher::setMaxLoads(int count)
+{
+    maxLoads_ = qMax(1, count);
+    schedule_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить текущую координату
+//-----------------------------------------------------------------------------
+void ASoundPrefetcher::setPosition(double position)
+{
+    position_ = position;
+
+    // Выгружаем звуки, оставшиеся позади
+    QMap<QString, prefetch_request_t>::iterator it = requests_.begin();
+    while (it != requests_.end())
+    {
+        if (it.value().neededAt < position_ - evictMargin_)
+        {
+            if (it.value().ready)
+                ASoundStore::getInstance().unpin(it.value().soundname, it.value().loadFlags);
+
+            it = requests_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    schedule_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Запуск загрузок в порядке срока
+//-----------------------------------------------------------------------------
+void ASoundPrefetcher::schedule_()
+{
+    while (activeLoads_ < maxLoads_)
+    {
+        // Ближайший по сроку незагруженный звук в пределах упреждения
+        QMap<QString, prefetch_request_t>::iterator next = requests_.end();
+
+        QMap<QString, prefetch_request_t>::iterator it = requests_.begin();
+        while (it != requests_.end())
+        {
+            const prefetch_request_t &request = it.value();
+
+            if (!request.ready && !request.loading &&
+                request.neededAt <= position_ + lookahead_ &&
+                (next == requests_.end() || request.neededAt < next.value().neededAt))
+            {
+                next = it;
+            }
+            ++it;
+        }
+
+        if (next == requests_.end())
+            return;
+
+        prefetch_request_t &request = next.value();
+        request.loading = true;
+        ++activeLoads_;
+
+        QString key = next.key();
+        QString soundname = request.soundname;
+        int loadFlags = request.loadFlags;
+        uint32_t deviceRate = static_cast<uint32_t>(AListener::getInstance().getFrequency());
+
+        QFutureWatcher<prefetch_result_t>* watcher = new QFutureWatcher<prefetch_result_t>(this);
+
+        connect(watcher, &QFutureWatcher<prefetch_result_t>::finished,
+                this, [this, key, watcher]() { onLoaded_(key, watcher); });
+
+        // Разбор файла - в пуле потоков, завершение - в потоке объекта
+        watcher->setFuture(QtConcurrent::run([soundname, loadFlags, deviceRate]() {
+            prefetch_result_t result;
+            result.data = ASoundStore::getInstance().load(soundname, loadFlags,
+                                                          deviceRate, result.error);
+            return result;
+        }));
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Обработка завершения фоновой загрузки
+//-----------------------------------------------------------------------------
+void ASoundPrefetcher::onLoaded_(const QString &key,
+                                 QFutureWatcher<prefetch_result_t>* watcher)
+{
+    --activeLoads_;
+
+    // Результат удерживает данные, пока звук не закреплён
+    prefetch_result_t result = watcher->result();
+    watcher->deleteLater();
+
+    QMap<QString, prefetch_request_t>::iterator it = requests_.find(key);
+
+    // Запрос отменён или звук уже позади - не закрепляем
+    if (it != requests_.end())
+    {
+        prefetch_request_t &request = it.value();
+        request.loading = false;
+
+        if (result.data.isNull())
+        {
+            QString soundname = request.soundname;
+            requests_.erase(it);
+            emit failed(soundname, result.error);
+        }
+        else
+        {
+            ASoundStore::getInstance().pin(request.soundname, request.loadFlags);
+            request.ready = true;
+            emit loaded(request.soundname);
+        }
+    }
+
+    schedule_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Ключ запроса
+//-----------------------------------------------------------------------------
+QString ASoundPrefetcher::key_(const QString &soundname, int loadFlags)
+{
+    return soundname + "|" + QString::number(loadFlags);
+}
@@ -0,0 +1,1438 @@
+//-----------------------------------------------------------------------------
+//
+//      Чтение и хранение данных WAVE файлов
+//      (c) РГУПС, ВЖД 24/03/2017
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-wave.h"
+#include "asound-dsp.h"
+#include "asound-cache.h"
+#include <QFile>
+#include <QByteArray>
+#include <QMutexLocker>
+#include <vector>
+#include <climits>
+#include <cstdint>
+#include <new>
+
+/// Буфер разбора служебных фрагментов файла (общий для загрузок потока)
+static thread_local QByteArray parseScratch;
+
+/// Начальный размер буфера разбора
+static const int DEF_PARSE_SCRATCH = 4096;
+
+/// GUID фрагмента riff (Sony Wave64)
+static const unsigned char W64_GUID_RIFF[16] =
+{
+    'r', 'i', 'f', 'f', 0x2E, 0x91, 0xCF, 0x11,
+    0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00
+};
+
+/// GUID формата wave (Sony Wave64); его "хвост" - общий для фрагментов RIFF
+static const unsigned char W64_GUID_WAVE[16] =
+{
+    'w', 'a', 'v', 'e', 0xF3, 0xAC, 0xD3, 0x11,
+    0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A
+};
+
+/// GUID фрагмента list (Sony Wave64)
+static const unsigned char W64_GUID_LIST[16] =
+{
+    'l', 'i', 's', 't', 0x2F, 0x91, 0xCF, 0x11,
+    0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00
+};
+
+/// GUID фрагмента маркеров Sony Wave64 {ABF76256-392D-11D2-86C7-00C04F8EDB8A}
+static const unsigned char W64_GUID_MARKER[16] =
+{
+    0x56, 0x62, 0xF7, 0xAB, 0x2D, 0x39, 0xD2, 0x11,
+    0x86, 0xC7, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A
+};
+
+// ****************************************************************************
+// *                      Хранилища PCM данных                                *
+// ****************************************************************************
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundStorage::~ASoundStorage()
+{
+
+}
+
+
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundHeapStorage::ASoundHeapStorage(uint64_t size)
+    : data_(size <= SIZE_MAX ? new (std::nothrow) unsigned char[size > 0 ? static_cast<size_t>(size) : 1]
+                             : nullptr)
+{
+
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundHeapStorage::~ASoundHeapStorage()
+{
+    delete[] data_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть указатель на данные
+//-----------------------------------------------------------------------------
+unsigned char* ASoundHeapStorage::data()
+{
+    return data_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundArena::ASoundArena(uint64_t slabSize)
+    : slabSize_(qMax(slabSize, ASOUND_ARENA_ALIGN))
+    , live_(0)
+    , used_(0)
+{
+
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundArena::~ASoundArena()
+{
+    for (const arena_slab_t &slab : slabs_)
+        qFreeAligned(slab.data);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть занятый блоками объём
+//-----------------------------------------------------------------------------
+uint64_t ASoundArena::getUsed() const
+{
+    QMutexLocker locker(&mutex_);
+
+    return used_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть объём страниц
+//-----------------------------------------------------------------------------
+uint64_t ASoundArena::getReserved() const
+{
+    QMutexLocker locker(&mutex_);
+
+    uint64_t reserved = 0;
+
+    for (const arena_slab_t &slab : slabs_)
+        reserved += slab.size;
+
+    return reserved;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть пул промежуточных данных загрузки текущего потока
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundArena> ASoundArena::scratch()
+{
+    static thread_local QSharedPointer<ASoundArena> arena;
+
+    if (arena.isNull())
+        arena.reset(new ASoundArena());
+
+    return arena;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Выделить выровненный блок
+//-----------------------------------------------------------------------------
+unsigned char* ASoundArena::allocate_(uint64_t size)
+{
+    // Блоки идут подряд с выравниванием начала
+    uint64_t aligned = (qMax<uint64_t>(size, 1) + ASOUND_ARENA_ALIGN - 1) & ~(ASOUND_ARENA_ALIGN - 1);
+
+    QMutexLocker locker(&mutex_);
+
+    // Первая страница, где хватает места (в т.ч. освободившегося)
+    int index = 0;
+    while (index < slabs_.count() && slabs_[index].size - slabs_[index].used < aligned)
+        ++index;
+
+    if (index == slabs_.count())
+    {
+        // Крупный блок получает страницу по своему размеру
+        arena_slab_t slab;
+        slab.size = qMax(aligned, slabSize_);
+        slab.used = 0;
+        slab.data = static_cast<unsigned char*>(qMallocAligned(static_cast<size_t>(slab.size),
+                                                               ASOUND_ARENA_ALIGN));
+
+        if (slab.data == nullptr)
+            return nullptr;
+
+        slabs_.append(slab);
+    }
+
+    arena_slab_t &slab = slabs_[index];
+
+    unsigned char* data = slab.data + slab.used;
+    slab.used += aligned;
+
+    ++live_;
+    used_ += aligned;
+
+    return data;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Освободить блок
+//-----------------------------------------------------------------------------
+void ASoundArena::release_(unsigned char *data, uint64_t size)
+{
+    uint64_t aligned = (qMax<uint64_t>(size, 1) + ASOUND_ARENA_ALIGN - 1) & ~(ASOUND_ARENA_ALIGN - 1);
+
+    QMutexLocker locker(&mutex_);
+
+    --live_;
+    used_ -= aligned;
+
+    if (live_ == 0)
+    {
+        // Живых блоков нет - для повторного заполнения остаётся одна
+        // страница обычного размера, крупные и лишние страницы освобождаются
+        QVector<arena_slab_t> kept;
+
+        for (arena_slab_t &slab : slabs_)
+        {
+            if (kept.isEmpty() && slab.size <= slabSize_)
+            {
+                slab.used = 0;
+                kept.append(slab);
+            }
+            else
+            {
+                qFreeAligned(slab.data);
+            }
+        }
+
+        slabs_ = kept;
+        used_ = 0;
+        return;
+    }
+
+    // Последний блок страницы (например, отброшенная копия) возвращается сразу
+    for (arena_slab_t &slab : slabs_)
+    {
+        if (data >= slab.data && data < slab.data + slab.size)
+        {
+            if (data + aligned == slab.data + slab.used)
+                slab.used -= aligned;
+
+            break;
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundArenaStorage::ASoundArenaStorage(QSharedPointer<ASoundArena> arena, uint64_t size)
+    : arena_(arena)
+    , data_(arena->allocate_(size))
+    , size_(size)
+{
+
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundArenaStorage::~ASoundArenaStorage()
+{
+    if (data_ != nullptr)
+        arena_->release_(data_, size_);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть указатель на данные
+//-----------------------------------------------------------------------------
+unsigned char* ASoundArenaStorage::data()
+{
+    return data_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть пул
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundArena> ASoundArenaStorage::getArena() const
+{
+    return arena_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundData::ASoundData()
+    : dataOffset(0)
+    , dataSize(0)
+    , blocksCount(0)
+    , pcmHash(0)
+    , markersDropped(false)
+    , envelopeStep(0)
+{
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        block[i] = nullptr;
+        blockSize[i] = 0;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть PCM данные только для чтения
+//-----------------------------------------------------------------------------
+sound_pcm_span_t ASoundData::span(int index) const
+{
+    sound_pcm_span_t result;
+    result.sampleRate = info.sampleRate;
+    result.channels = info.numChannels;
+    result.bitsPerSample = info.bitsPerSample;
+    result.frameSize = info.bytesPerSample;
+
+    if (result.frameSize <= 0 || block[0] == nullptr || index >= blocksCount)
+        return result;
+
+    const uint64_t frameSize = static_cast<uint64_t>(result.frameSize);
+
+    if (index < 0)
+    {
+        // Весь звук - только если блоки лежат в хранилище подряд
+        uint64_t size = 0;
+
+        for (int i = 0; i < blocksCount; ++i)
+        {
+            if (block[i] != block[0] + size)
+                return result;
+
+            size += blockSize[i];
+        }
+
+        result.data = block[0];
+        result.frames = size / frameSize;
+    }
+    else
+    {
+        result.data = block[index];
+        result.frames = blockSize[index] / frameSize;
+    }
+
+    result.storage = storage;
+
+    return result;
+}
+
+
+
+// ****************************************************************************
+// *                         Класс AWaveReader                                *
+// ****************************************************************************
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+AWaveReader::AWaveReader()
+    : canDo_(false)
+    , canCUE_(false)
+    , canLABL_(false)
+    , withData_(true)
+    , container_(WAVE_RIFF)
+    , ds64DataSize_(0)
+{
+    // Создаём контейнер аудиофайла
+    file_ = new QFile();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+AWaveReader::~AWaveReader()
+{
+    delete file_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Прочитать WAVE файл
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> AWaveReader::read(const QString &soundname, bool withData)
+{
+    // Сбрасываем флаги
+    canDo_ = false;
+    canCUE_ = false;
+    canLABL_ = false;
+    withData_ = withData;
+    lastError_.clear();
+    cue_data_.clear();
+
+    QSharedPointer<ASoundData> data(new ASoundData());
+    data->name = soundname;
+
+    // Загружаем файл
+    loadFile_(soundname);
+
+    ASoundMetaCache &cache = ASoundMetaCache::getInstance();
+
+    if (canDo_ && cache.isEnabled() && cache.lookup(soundname, *data))
+    {
+        // Разметка файла известна - читаем сразу секцию data
+        if (withData_)
+        {
+            readCachedData_(*data);
+
+            // Запись без анализа (разметка читалась без данных) - дополняем
+            if (canDo_ && !data->analysis.valid && analyze_(*data))
+                cache.store(soundname, *data);
+        }
+    }
+    else
+    {
+        // Читаем информационный раздел 44байта
+        readWaveInfo_(*data);
+
+        if (canDo_ && cache.isEnabled())
+            cache.store(soundname, *data);
+    }
+
+    if (file_->isOpen())
+        file_->close();
+
+    if (!canDo_)
+        return QSharedPointer<ASoundData>();
+
+    return data;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть последнюю ошибку
+//-----------------------------------------------------------------------------
+QString AWaveReader::getLastError() const
+{
+    return lastError_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Задать пул для PCM данных
+//-----------------------------------------------------------------------------
+void AWaveReader::setArena(QSharedPointer<ASoundArena> arena)
+{
+    arena_ = arena;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть пул, в котором лежат данные звука
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundArena> AWaveReader::arenaOf(QSharedPointer<ASoundData> data)
+{
+    ASoundArenaStorage* storage = data.isNull() ? nullptr :
+                dynamic_cast<ASoundArenaStorage*>(data->storage.data());
+
+    return (storage != nullptr) ? storage->getArena() : QSharedPointer<ASoundArena>();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Выделить хранилище PCM данных в пуле или в куче
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundStorage> AWaveReader::allocate_(uint64_t size,
+                                                     QSharedPointer<ASoundArena> arena,
+                                                     unsigned char* &data)
+{
+    if (!arena.isNull())
+    {
+        QSharedPointer<ASoundArenaStorage> storage(new ASoundArenaStorage(arena, size));
+        data = storage->data();
+
+        if (data != nullptr)
+            return storage;
+    }
+
+    // Без пула (или пулу не хватило памяти на страницу) - массив в куче
+    QSharedPointer<ASoundHeapStorage> storage(new ASoundHeapStorage(size));
+    data = storage->data();
+
+    return storage;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Перенести данные из пула потока в заданный пул
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> AWaveReader::toArena_(QSharedPointer<ASoundData> data,
+                                                 QSharedPointer<ASoundArena> arena)
+{
+    if (data.isNull() || arena.isNull() || arenaOf(data) != ASoundArena::scratch())
+        return data;
+
+    uint64_t size = 0;
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        if (data->block[i] != nullptr)
+            size += data->blockSize[i];
+    }
+
+    QSharedPointer<ASoundData> moved(new ASoundData(*data));
+    unsigned char* pcm = nullptr;
+    moved->storage = allocate_(size, arena, pcm);
+
+    if (pcm == nullptr)
+        return data;
+
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        if (data->block[i] == nullptr)
+            continue;
+
+        memcpy(pcm, data->block[i], data->blockSize[i]);
+        moved->block[i] = pcm;
+        pcm += data->blockSize[i];
+    }
+
+    return moved;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Загрузка файла (в т.ч. из ресурсов)
+//-----------------------------------------------------------------------------
+void AWaveReader::loadFile_(const QString &soundname)
+{
+    // Загружаем файл в контейнер
+    file_->setFileName(soundname);
+
+    // Проверяем, существует ли файл
+    if (!file_->exists())
+    {
+        lastError_ = "NO_SUCH_FILE: ";
+        lastError_.append(soundname);
+        canDo_ = false;
+        return;
+    }
+
+    // Пытаемся открыть файл
+    if (file_->open(QIODevice::ReadOnly))
+    {
+        canDo_ = true;
+    }
+    else
+    {
+        canDo_ = false;
+        lastError_ = "CANT_OPEN_FILE_FOR_READING: ";
+        lastError_.append(soundname);
+        return;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Чтение информации о файле .wav
+//-----------------------------------------------------------------------------
+void AWaveReader::readWaveInfo_(ASoundData &data)
+{
+    if (canDo_)
+    {
+        // Читаем заголовок файла и определяем контейнер
+        readWaveHeader_();
+
+        // Служебные фрагменты (cue, LIST) собираются в буфер разбора в форме
+        // RIFF, где бы в файле они ни лежали
+        QByteArray &arrDop = parseScratch;
+        if (arrDop.capacity() < DEF_PARSE_SCRATCH)
+            arrDop.reserve(DEF_PARSE_SCRATCH);
+        arrDop.resize(0);
+
+        QSharedPointer<ASoundStorage> storage;
+        unsigned char* pcm = nullptr;
+        bool hasData = false;
+
+        char id[4] = {0, 0, 0, 0};
+        uint64_t size = 0;
+
+        // Обходим фрагменты файла по их размерам
+        while (canDo_ && readChunkHead_(id, size))
+        {
+            qint64 start = file_->pos();
+            uint64_t available = static_cast<uint64_t>(qMax<qint64>(0, file_->size() - start));
+
+            if (strncmp(id, "ds64", 4) == 0)
+            {
+                // 64-битные размеры RF64
+                wave_ds64_t ds64;
+                file_->read(reinterpret_cast<char*>(&ds64),
+                            static_cast<qint64>(qMin<uint64_t>(size, sizeof(wave_ds64_t))));
+                ds64DataSize_ = ds64.dataSize;
+            }
+            else if (strncmp(id, "fmt ", 4) == 0)
+            {
+                // Поля формата после "шапки"; расширение WAVEFORMATEX не нужно
+                memcpy(data.info.subchunk1Id, "fmt ", 4);
+                data.info.subchunk1Size = static_cast<uint32_t>(qMin<uint64_t>(size, UINT32_MAX));
+                file_->read(reinterpret_cast<char*>(&data.info) + 8,
+                            static_cast<qint64>(qMin<uint64_t>(size, sizeof(wave_info_fmt_t) - 8)));
+            }
+            else if (strncmp(id, "data", 4) == 0 && !hasData)
+            {
+                // В RF64 настоящий размер секции data - во фрагменте ds64
+                if (container_ == WAVE_RF64 && size == UINT32_MAX)
+                    size = ds64DataSize_;
+
+                data.dataOffset = static_cast<uint64_t>(start);
+                data.dataSize = qMin(size, available);
+
+                if (withData_)
+                {
+                    // Читаем из файла сами медиа данные зная их размер
+                    // сразу в общее хранилище блоков
+                    storage = allocate_(data.dataSize, arena_, pcm);
+
+                    if (pcm == nullptr)
+                    {
+                        lastError_ = "CANT_ALLOCATE_DATA: ";
+                        lastError_.append(data.name);
+                        canDo_ = false;
+                        break;
+                    }
+
+                    qint64 readSize = file_->read(reinterpret_cast<char*>(pcm),
+                                                  static_cast<qint64>(data.dataSize));
+
+                    if (readSize < static_cast<qint64>(data.dataSize))
+                    {
+                        data.dataSize = readSize > 0 ? static_cast<uint64_t>(readSize) : 0;
+                    }
+                }
+
+                hasData = true;
+            }
+            else if (container_ == WAVE_W64 && strncmp(id, "mrkr", 4) == 0)
+            {
+                // Маркеры и области Sony Wave64 не разбираются: метки из них
+                // не появятся - отмечаем это, а не теряем молча
+                data.markersDropped = true;
+            }
+            else if (strncmp(id, "cue ", 4) == 0 || strncasecmp(id, "list", 4) == 0)
+            {
+                // Фрагмент - в буфер разбора с "шапкой" RIFF (8 байт)
+                uint64_t copySize = qMin(size, available);
+
+                if (copySize <= static_cast<uint64_t>(INT_MAX - arrDop.size() - 8))
+                {
+                    uint32_t chunkSize = static_cast<uint32_t>(copySize);
+                    int offset = arrDop.size();
+
+                    arrDop.resize(offset + 8 + static_cast<int>(chunkSize));
+                    memcpy(arrDop.data() + offset, id, 4);
+                    memcpy(arrDop.data() + offset + 4, &chunkSize, 4);
+
+                    qint64 readSize = file_->read(arrDop.data() + offset + 8, chunkSize);
+                    arrDop.resize(offset + 8 + static_cast<int>(qMax<qint64>(0, readSize)));
+                }
+            }
+
+            // Переходим к следующему фрагменту
+            file_->seek(nextChunk_(start, size));
+        }
+
+        if (canDo_ && !hasData)
+        {
+            lastError_ = "CANT_FIND_DATA: ";
+            lastError_.append(data.name);
+            canDo_ = false;
+        }
+
+        if (canDo_)
+        {
+            getCUE_(arrDop);
+
+            if (canCUE_)
+                getLabels_(arrDop, data);
+
+            // Итератор для data и сдвиг точки копирования в блоке данных звука
+            int32_t i = 0;
+            uint64_t data_offset = 0;
+            // Если присутствуют метки - делим данные на три блока
+            if (canLABL_)
+            {
+                QMap<QString, uint64_t>::const_iterator labl_map = data.labels.constBegin();
+                while (labl_map != data.labels.constEnd()) {
+                    if (labl_map.key() == "loop" || labl_map.key() == "stop")
+                    {
+                        uint64_t end = qMin(labl_map.value(), data.dataSize);
+                        data.block[i] = (pcm != nullptr) ? pcm + data_offset : nullptr;
+                        data.blockSize[i] = end > data_offset ? end - data_offset : 0;
+                        data_offset += data.blockSize[i];
+                        ++i;
+                    }
+                    ++labl_map;
+                }
+            }
+
+            // Оставшиеся данные - в последний блок
+            data.block[i] = (pcm != nullptr) ? pcm + data_offset : nullptr;
+            data.blockSize[i] = data.dataSize - data_offset;
+            ++i;
+
+            data.blocksCount = i;
+            data.storage = storage;
+
+            // Свёртка и анализ - пока данные в кэше процессора
+            if (pcm != nullptr)
+            {
+                data.pcmHash = ASoundDSP::hash64(pcm, data.dataSize);
+                analyze_(data);
+            }
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Чтение секции data по разметке из кэша метаданных
+//-----------------------------------------------------------------------------
+void AWaveReader::readCachedData_(ASoundData &data)
+{
+    if (!file_->seek(static_cast<qint64>(data.dataOffset)))
+    {
+        lastError_ = "CANT_SEEK_DATA: ";
+        lastError_.append(data.name);
+        canDo_ = false;
+        return;
+    }
+
+    unsigned char* pcm = nullptr;
+    QSharedPointer<ASoundStorage> storage = allocate_(data.dataSize, arena_, pcm);
+
+    if (pcm == nullptr)
+    {
+        lastError_ = "CANT_ALLOCATE_DATA: ";
+        lastError_.append(data.name);
+        canDo_ = false;
+        return;
+    }
+
+    qint64 readSize = file_->read(reinterpret_cast<char*>(pcm),
+                                  static_cast<qint64>(data.dataSize));
+
+    if (readSize != static_cast<qint64>(data.dataSize))
+    {
+        lastError_ = "CANT_READ_DATA: ";
+        lastError_.append(data.name);
+        canDo_ = false;
+        return;
+    }
+
+    // Блоки лежат подряд, размеры известны из кэша
+    unsigned char* block = pcm;
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        data.block[i] = (i < data.blocksCount) ? block : nullptr;
+        block += data.blockSize[i];
+    }
+
+    data.storage = storage;
+    data.pcmHash = ASoundDSP::hash64(pcm, data.dataSize);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Анализ PCM данных: уровни блоков и стыки цикла
+//-----------------------------------------------------------------------------
+bool AWaveReader::analyze_(ASoundData &data)
+{
+    data.analysis = sound_analysis_t();
+
+    const int bits = data.info.bitsPerSample;
+    const int channels = data.info.numChannels;
+    const size_t frameBytes = static_cast<size_t>(qMax<short>(0, data.info.bytesPerSample));
+
+    if (data.block[0] == nullptr || data.blocksCount <= 0 || frameBytes == 0 ||
+            (bits != 8 && bits != 16))
+    {
+        return false;
+    }
+
+    // Блоки лежат в хранилище подряд, границы - на целых кадрах
+    size_t frames[BUFFER_BLOCKS] = {0};
+    size_t totalFrames = 0;
+
+    for (int i = 0; i < data.blocksCount; ++i)
+    {
+        if (i + 1 < data.blocksCount && data.blockSize[i] % frameBytes != 0)
+            return false;
+
+        frames[i] = static_cast<size_t>(data.blockSize[i] / frameBytes);
+        totalFrames += frames[i];
+    }
+
+    ASoundDSP::analyze(data.block[0], bits, channels, data.info.sampleRate,
+                       frames, data.blocksCount,
+                       data.analysis.region, &data.analysis.total);
+
+    // Переход из конца блока цикла в его начало (onTimerStartKiller)
+    if (data.blocksCount > 1 && frames[1] >= 2)
+    {
+        const unsigned char* loop = data.block[1];
+        data.analysis.loopSeam = ASoundDSP::seamScore(loop + (frames[1] - 2) * frameBytes, loop,
+                                                      bits, channels, data.analysis.region[1].slope);
+    }
+
+    // Переход из конца звука в начало (AL_LOOPING)
+    if (totalFrames >= 2)
+    {
+        const unsigned char* pcm = data.block[0];
+        data.analysis.wrapSeam = ASoundDSP::seamScore(pcm + (totalFrames - 2) * frameBytes, pcm,
+                                                      bits, channels, data.analysis.total.slope);
+    }
+
+    data.analysis.valid = true;
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Получение заголовка WAVE файла (RIFF, RF64 или Wave64)
+//-----------------------------------------------------------------------------
+void AWaveReader::readWaveHeader_()
+{
+    container_ = WAVE_RIFF;
+    ds64DataSize_ = 0;
+
+    // Читаем 12 байт информации о формате сразу в структуру
+    wave_info_header_ = wave_info_header_t();
+    file_->read(reinterpret_cast<char*>(&wave_info_header_), sizeof(wave_info_header_t));
+
+    if (strncmp(wave_info_header_.chunkId, "riff", 4) == 0)
+    {
+        // Wave64: GUID riff, 64-битный размер, GUID wave - всего 40 байт
+        unsigned char head[40];
+        file_->seek(0);
+
+        if (file_->read(reinterpret_cast<char*>(head), sizeof(head)) != sizeof(head) ||
+                memcmp(head, W64_GUID_RIFF, 16) != 0)
+        {
+            lastError_ = "NOT_RIFF_FILE";
+            canDo_ = false;
+        }
+        else if (memcmp(head + 24, W64_GUID_WAVE, 16) != 0)
+        {
+            lastError_ = "NOT_WAVE_FILE";
+            canDo_ = false;
+        }
+
+        container_ = WAVE_W64;
+        return;
+    }
+
+    // Проверка данных формата
+    if (strncmp(wave_info_header_.chunkId, "RF64", 4) == 0)
+        container_ = WAVE_RF64;
+    else
+        checkValue(wave_info_header_.chunkId, "RIFF", "NOT_RIFF_FILE");
+
+    checkValue(wave_info_header_.format, "WAVE", "NOT_WAVE_FILE");
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Чтение "шапки" очередного фрагмента
+//-----------------------------------------------------------------------------
+bool AWaveReader::readChunkHead_(char id[4], uint64_t &size)
+{
+    if (container_ == WAVE_W64)
+    {
+        wave64_chunk_head_t head;
+
+        if (file_->read(reinterpret_cast<char*>(&head), sizeof(head)) != sizeof(head))
+            return false;
+
+        // Размер фрагмента Wave64 включает его "шапку"
+        size = head.chunkSize > sizeof(head) ? head.chunkSize - sizeof(head) : 0;
+
+        // Фрагменты RIFF в Wave64 - это FOURCC с общим "хвостом" GUID;
+        // у list "хвост" свой
+        if (memcmp(head.guid + 4, W64_GUID_WAVE + 4, 12) == 0 ||
+                memcmp(head.guid, W64_GUID_LIST, 16) == 0)
+        {
+            memcpy(id, head.guid, 4);
+        }
+        else if (memcmp(head.guid, W64_GUID_MARKER, 16) == 0)
+        {
+            // У фрагмента маркеров Sony FOURCC нет - даём условный
+            memcpy(id, "mrkr", 4);
+        }
+        else
+        {
+            memset(id, 0, 4);
+        }
+
+        return true;
+    }
+
+    char head[8];
+
+    if (file_->read(head, sizeof(head)) != sizeof(head))
+        return false;
+
+    uint32_t chunkSize = 0;
+    memcpy(id, head, 4);
+    memcpy(&chunkSize, head + 4, 4);
+    size = chunkSize;
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Позиция следующего фрагмента с учётом выравнивания
+//-----------------------------------------------------------------------------
+qint64 AWaveReader::nextChunk_(qint64 start, uint64_t size) const
+{
+    // RIFF выравнивает фрагменты на 2 байта, Wave64 - на 8
+    uint64_t align = (container_ == WAVE_W64) ? 8 : 2;
+    uint64_t available = static_cast<uint64_t>(qMax<qint64>(0, file_->size() - start));
+    uint64_t padded = (qMin(size, available) + align - 1) & ~(align - 1);
+
+    return start + static_cast<qint64>(qMin(padded, available));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Получение фрагмента CUE *.WAVE формата
+//-----------------------------------------------------------------------------
+void AWaveReader::getCUE_(QByteArray &baseStr)
+{
+    // Находим заголовок фрагмента cue
+    int cueFirstByte = baseStr.indexOf("cue ");
+    // Если заголовок был найден
+    if (cueFirstByte != -1 &&
+            cueFirstByte + static_cast<int>(sizeof(wave_cue_head_t)) <= baseStr.size())
+    {
+        // Загружаем "шапку" фрагмента cue прямо из буфера в структуру
+        memcpy(&cue_head_, baseStr.constData() + cueFirstByte, sizeof(wave_cue_head_t));
+        // Создаем временную структуру данных фрагмента cue
+        wave_cue_data_t cue_data_t_;
+        // Вычисляем смещение к первому блоку данных фрагмента cue
+        int cue_data_offset = cueFirstByte + static_cast<int>(sizeof(wave_cue_head_t));
+        // В цикле загружаем все данные точек cue
+        for (int i = 1; i <= static_cast<int>(cue_head_.cueChunckPNum); ++i)
+        {
+            if (cue_data_offset + static_cast<int>(sizeof(wave_cue_data_t)) > baseStr.size())
+                break;
+
+            // Данные во временную структуру
+            memcpy(&cue_data_t_, baseStr.constData() + cue_data_offset,
+                   sizeof(wave_cue_data_t));
+            // Временную структуру в общий список cue-точек
+            cue_data_.append(cue_data_t_);
+            // Смещение к следующей точку cue
+            cue_data_offset += static_cast<int>(sizeof(wave_cue_data_t));
+        }
+
+        canCUE_ = true;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Получение меток из фрагмента LIST->labls *.WAVE формата
+//-----------------------------------------------------------------------------
+void AWaveReader::getLabels_(QByteArray &baseStr, ASoundData &data)
+{
+    // Читаем шапку блока LIST
+    readWaveListChunckHeader_(baseStr);
+
+    // Если был найден список
+    if (strncasecmp(list_head_.chunckId, "list", 4) == 0)
+    {
+        const char* base = baseStr.constData();
+
+        int labelOffset = 0, labelFirstByte = 0;
+
+        // Крутим пока не достигнем последней метки labl
+        do
+        {
+            labelFirstByte = baseStr.indexOf("labl", labelOffset);
+            int labelLength = 0; ///< Длина блока данных метки
+            int labelCueID = 0; ///< ID связанной точки cue
+            QString labelName; ///< Имя метки
+
+            if (labelFirstByte != -1 && labelFirstByte + 12 > baseStr.size())
+                break;
+
+            if (labelFirstByte != -1)
+            {
+                // Парсим секцию labl прямо в буфере, так как не знаем заранее его длину. . .
+                labelLength = base[labelFirstByte + 4]; // Получаем длину метки в байтах
+                labelCueID = base[labelFirstByte + 8]; // Получаем ID точки cue
+
+                // Получаем имя метки (до нуля или до конца блока)
+                const char* name = base + labelFirstByte + 12;
+                int nameSize = qBound(0, labelLength - 5, baseStr.size() - labelFirstByte - 12);
+                labelName = QString::fromUtf8(name, static_cast<int>(strnlen(name, static_cast<size_t>(nameSize))));
+
+                int index = 0; // Индекс для связанной точки cue в списке точек cue
+
+                for (int k = 0; k < cue_data_.count(); ++k)
+                    if (cue_data_[k].ID == labelCueID)
+                    {
+                        index = k;
+                        break;
+                    }
+
+                data.labels.insert(labelName,
+                                   cue_data_[index].sampleOffset * static_cast<uint64_t>(data.info.bytesPerSample));
+
+                canLABL_ = true;
+            }
+
+            labelOffset = labelFirstByte + 4; // Сдвигаем поиск на следующую метку
+        } while (labelFirstByte != -1);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Чтение шапки фрагмента LIST файла wav
+//-----------------------------------------------------------------------------
+void AWaveReader::readWaveListChunckHeader_(QByteArray &baseStr)
+{
+    // Номер первого байта списка (некоторые программы сохраняют
+    // фрагмент LIST - маленькими буквами)
+    int listFirstByte = baseStr.indexOf("LIST");
+    listFirstByte =
+            (listFirstByte == -1 ?
+                 baseStr.indexOf("list") : listFirstByte);
+    if (listFirstByte != -1 &&
+            listFirstByte + static_cast<int>(sizeof(wave_list_head_t)) <= baseStr.size())
+    {
+        // Данные "шапки" фрагмента LIST - прямо из буфера в структуру
+        memcpy(&list_head_, baseStr.constData() + listFirstByte,
+               sizeof(wave_list_head_t));
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Метод проверки необходимых параметров
+//-----------------------------------------------------------------------------
+void AWaveReader::checkValue(std::string baseStr, const char targStr[], QString err)
+{
+    if (canDo_)
+    {
+        // // /////////////////////////////////////////////// //
+        // // Важно, чтобы подстрока начиналась с 0 элемента! //
+        // //    иначе проверку нельзя считать достоверной    //
+        // // /////////////////////////////////////////////// //
+        if (baseStr.find(targStr) != 0)
+        {
+            lastError_ = err;
+            canDo_ = false;
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Обработать данные согласно флагам загрузки
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> AWaveReader::process(QSharedPointer<ASoundData> data,
+                                                int loadFlags, uint32_t deviceRate,
+                                                QSharedPointer<ASoundArena> arena)
+{
+    // Без PCM данных (только разметка) обрабатывать нечего
+    if (data.isNull() || data->storage.isNull())
+        return data;
+
+    // Промежуточные результаты - в пуле потока, в заданный пул - только итог
+    QSharedPointer<ASoundArena> work = arena.isNull() ? arena : ASoundArena::scratch();
+
+    QSharedPointer<ASoundData> source = data;
+
+    // Сводим стерео в моно, если звук будет позиционироваться
+    if (loadFlags & LOAD_DOWNMIX_MONO)
+        data = downmixToMono_(data, work);
+
+    // Приводим к частоте устройства, чтобы микшер не ресемплировал на лету
+    if (loadFlags & LOAD_RESAMPLE)
+        data = resample_(data, deviceRate, work);
+
+    // Обработанные данные анализируем заново (громкость моно отличается
+    // от стерео, стыки и пики - от исходных)
+    if (data != source)
+        analyze_(*data);
+
+    data = toArena_(data, arena);
+
+    // Огибающая низких частот для внешних потребителей
+    if (loadFlags & LOAD_ENVELOPE)
+        data = envelope_(data);
+
+    return data;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Построить упрощённый вариант звука для дальних источников
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> AWaveReader::makeLodVariant(QSharedPointer<ASoundData> data,
+                                                       int level,
+                                                       QSharedPointer<ASoundArena> arena)
+{
+    if (data.isNull() || data->storage.isNull() || !hasLodVariant(*data, level))
+        return QSharedPointer<ASoundData>();
+
+    uint32_t srcRate = data->info.sampleRate;
+    uint32_t dstRate = qMax(srcRate >> level, ASOUND_LOD_MIN_RATE);
+
+    QSharedPointer<ASoundArena> work = arena.isNull() ? arena : ASoundArena::scratch();
+
+    // Вдали стерео картина всё равно не различима - оставляем моно
+    QSharedPointer<ASoundData> variant = downmixToMono_(data, work);
+
+    if (dstRate < srcRate)
+        variant = resample_(variant, dstRate, work);
+
+    if (variant == data)
+        return QSharedPointer<ASoundData>();
+
+    analyze_(*variant);
+
+    return toArena_(variant, arena);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Будет ли у звука упрощённый вариант
+//-----------------------------------------------------------------------------
+bool AWaveReader::hasLodVariant(const ASoundData &data, int level)
+{
+    if (level <= 0 || level >= ASOUND_LOD_LEVELS)
+        return false;
+
+    // Те же условия, при которых downmixToMono_() и resample_() что-то делают
+    if (data.info.bitsPerSample != 8 && data.info.bitsPerSample != 16)
+        return false;
+
+    uint64_t frameSize = static_cast<uint64_t>(data.info.bytesPerSample);
+
+    if (data.info.numChannels <= 0 || frameSize == 0)
+        return false;
+
+    if (data.info.numChannels == 2)
+        return true;
+
+    uint32_t srcRate = data.info.sampleRate;
+    uint32_t dstRate = qMax(srcRate >> level, ASOUND_LOD_MIN_RATE);
+
+    // Ни частоту, ни число каналов уменьшить нельзя
+    if (dstRate >= srcRate)
+        return false;
+
+    size_t frames = 0;
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+        frames += static_cast<size_t>(data.blockSize[i] / frameSize);
+
+    return ASoundDSP::resampledLength(frames, srcRate, dstRate) > 0;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Построение огибающей низких частот
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> AWaveReader::envelope_(QSharedPointer<ASoundData> data)
+{
+    sound_pcm_span_t pcm = data->span();
+
+    if (pcm.data == nullptr || pcm.frames == 0 ||
+            (pcm.bitsPerSample != 8 && pcm.bitsPerSample != 16))
+    {
+        return data;
+    }
+
+    // Копия разметки ссылается на те же PCM данные
+    QSharedPointer<ASoundData> result(new ASoundData(*data));
+
+    uint64_t step = ASoundDSP::envelopeStep(pcm.sampleRate, ASOUND_ENVELOPE_RATE);
+
+    result->envelope.resize(static_cast<int>((pcm.frames + step - 1) / step));
+    result->envelopeStep = static_cast<uint32_t>(step);
+
+    ASoundDSP::lowEnvelope(pcm.data, pcm.bitsPerSample, pcm.channels, pcm.sampleRate,
+                           static_cast<size_t>(pcm.frames), ASOUND_ENVELOPE_CUTOFF,
+                           ASOUND_ENVELOPE_RATE, result->envelope.data());
+
+    return result;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Сведение стерео в моно
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> AWaveReader::downmixToMono_(QSharedPointer<ASoundData> data,
+                                                       QSharedPointer<ASoundArena> arena)
+{
+    // OpenAL не позиционирует стерео буферы, поэтому для 3D источников
+    // храним только моно вариант - вдвое меньше памяти
+    if (data->info.numChannels != 2)
+        return data;
+
+    // Прочие форматы отклонит ASound::defineFormat_()
+    if (data->info.bitsPerSample != 8 && data->info.bitsPerSample != 16)
+        return data;
+
+    uint64_t frameSize = static_cast<uint64_t>(data->info.bytesPerSample);
+    uint64_t monoSampleSize = frameSize / 2;
+
+    if (frameSize == 0)
+        return data;
+
+    // Исходные данные могут разделяться (банк, кэш) - пишем в новое хранилище
+    QSharedPointer<ASoundData> mono(new ASoundData(*data));
+    unsigned char* pcm = nullptr;
+    QSharedPointer<ASoundStorage> storage = allocate_(data->dataSize / 2, arena, pcm);
+    unsigned char* dst = pcm;
+
+    if (pcm == nullptr)
+        return data;
+
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        if (data->block[i] == nullptr)
+            continue;
+
+        size_t frames = static_cast<size_t>(data->blockSize[i] / frameSize);
+
+        if (data->info.bitsPerSample == 16)
+        {
+            ASoundDSP::downmixStereo16(reinterpret_cast<const int16_t*>(data->block[i]),
+                                       reinterpret_cast<int16_t*>(dst), frames);
+        }
+        else
+        {
+            ASoundDSP::downmixStereo8(data->block[i], dst, frames);
+        }
+
+        mono->block[i] = dst;
+        mono->blockSize[i] = frames * monoSampleSize;
+        dst += mono->blockSize[i];
+    }
+
+    // Метки хранятся в байтах - пересчитываем под новый размер кадра
+    QMap<QString, uint64_t>::iterator labl_map = mono->labels.begin();
+    while (labl_map != mono->labels.end())
+    {
+        labl_map.value() /= 2;
+        ++labl_map;
+    }
+
+    mono->info.numChannels = 1;
+    mono->info.bytesPerSample = static_cast<short>(monoSampleSize);
+    mono->info.byteRate /= 2;
+    mono->dataSize = static_cast<uint64_t>(dst - pcm);
+    mono->storage = storage;
+    mono->pcmHash = ASoundDSP::hash64(pcm, mono->dataSize);
+
+    // Уровни исходных данных к новым не относятся
+    mono->analysis = sound_analysis_t();
+
+    return mono;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Приведение к частоте микширования устройства
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> AWaveReader::resample_(QSharedPointer<ASoundData> data,
+                                                  uint32_t dstRate,
+                                                  QSharedPointer<ASoundArena> arena)
+{
+    uint32_t srcRate = data->info.sampleRate;
+
+    if (dstRate == 0 || srcRate == 0 || srcRate == dstRate)
+        return data;
+
+    if (data->info.bitsPerSample != 8 && data->info.bitsPerSample != 16)
+        return data;
+
+    int channels = data->info.numChannels;
+    int bits = data->info.bitsPerSample;
+    uint64_t frameSize = static_cast<uint64_t>(data->info.bytesPerSample);
+
+    if (channels <= 0 || frameSize == 0)
+        return data;
+
+    // Блоки (старт, цикл, остановка) ресемплируем как единый сигнал,
+    // чтобы на стыках не было краевых эффектов фильтра
+    size_t frames = 0;
+    size_t blockStart[BUFFER_BLOCKS + 1];
+
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        blockStart[i] = frames;
+        frames += static_cast<size_t>(data->blockSize[i] / frameSize);
+    }
+    blockStart[BUFFER_BLOCKS] = frames;
+
+    size_t outFrames = ASoundDSP::resampledLength(frames, srcRate, dstRate);
+
+    if (outFrames == 0)
+        return data;
+
+    // Рабочие массивы переиспользуются от звука к звуку
+    static thread_local std::vector<float> inPlanes;
+    static thread_local std::vector<float> outPlanes;
+
+    inPlanes.resize(frames * static_cast<size_t>(channels));
+    outPlanes.resize(outFrames * static_cast<size_t>(channels));
+    std::vector<float*> in(static_cast<size_t>(channels)), out(static_cast<size_t>(channels));
+
+    for (int c = 0; c < channels; ++c)
+    {
+        in[static_cast<size_t>(c)] = inPlanes.data() + static_cast<size_t>(c) * frames;
+        out[static_cast<size_t>(c)] = outPlanes.data() + static_cast<size_t>(c) * outFrames;
+    }
+
+    // Переводим блоки в float по каналам
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        if (data->block[i] == nullptr)
+            continue;
+
+        std::vector<float*> dst(in);
+        for (float* &plane : dst)
+            plane += blockStart[i];
+
+        ASoundDSP::pcmToFloat(data->block[i], bits, channels,
+                              blockStart[i + 1] - blockStart[i], dst.data());
+    }
+
+    for (int c = 0; c < channels; ++c)
+    {
+        ASoundDSP::resample(in[static_cast<size_t>(c)], frames,
+                            out[static_cast<size_t>(c)], srcRate, dstRate);
+    }
+
+    QSharedPointer<ASoundData> resampled(new ASoundData(*data));
+    unsigned char* pcm = nullptr;
+
+    // Огибающая привязана к исходной частоте
+    resampled->envelope.clear();
+    resampled->envelopeStep = 0;
+    QSharedPointer<ASoundStorage> storage = allocate_(outFrames * frameSize, arena, pcm);
+    unsigned char* block = pcm;
+
+    if (pcm == nullptr)
+        return data;
+
+    // Делим результат на блоки по пересчитанным границам
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        if (data->block[i] == nullptr)
+            continue;
+
+        size_t begin = ASoundDSP::resampledLength(blockStart[i], srcRate, dstRate);
+        size_t end = (blockStart[i + 1] == frames) ?
+                    outFrames : ASoundDSP::resampledLength(blockStart[i + 1], srcRate, dstRate);
+
+        std::vector<const float*> src(out.begin(), out.end());
+        for (const float* &plane : src)
+            plane += begin;
+
+        ASoundDSP::floatToPcm(src.data(), channels, end - begin, bits, block);
+
+        resampled->block[i] = block;
+        resampled->blockSize[i] = (end - begin) * frameSize;
+        block += resampled->blockSize[i];
+    }
+
+    // Метки хранятся в байтах - пересчитываем под новую частоту
+    QMap<QString, uint64_t>::iterator labl_map = resampled->labels.begin();
+    while (labl_map != resampled->labels.end())
+    {
+        size_t frame = static_cast<size_t>(labl_map.value() / frameSize);
+        labl_map.value() = ASoundDSP::resampledLength(frame, srcRate, dstRate) * frameSize;
+        ++labl_map;
+    }
+
+    resampled->info.sampleRate = dstRate;
+    resampled->info.byteRate = static_cast<uint32_t>(dstRate * frameSize);
+    resampled->dataSize = outFrames * frameSize;
+    resampled->storage = storage;
+    resampled->pcmHash = ASoundDSP::hash64(pcm, resampled->dataSize);
+
+    // Уровни исходных данных к новым не относятся
+    resampled->analysis = sound_analysis_t();
+
+    return resampled;
+}
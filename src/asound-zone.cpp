@@ -0,0 +1,322 @@
+//-----------------------------------------------------------------------------
+//
+//      Зоны окружения (тоннели, станции, кабина) на эффектах EFX
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+
+
+#include "asound-zone.h"
+#include "asound.h"
+
+/// Все зоны
+QList<ASoundZone*> ASoundZone::zones_;
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundZone::ASoundZone(QString name, QObject *parent)
+    : QObject(parent)
+    , name_(name)
+    , effectType_(AL_EFFECT_REVERB)
+    , gain_(1.0f)
+    , hasBox_(false)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        boxMin_[i] = 0.0f;
+        boxMax_[i] = 0.0f;
+    }
+
+    zones_.append(this);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASoundZone::~ASoundZone()
+{
+    zones_.removeOne(this);
+
+    // Звуки перестают посылать сигнал в зону
+    QList<ASound*> sounds = sounds_;
+
+    for (ASound* sound : sounds)
+        sound->leaveZone_(this);
+
+    for (QMap<AListener*, zone_slot_t>::const_iterator it = slots_.constBegin();
+         it != slots_.constEnd(); ++it)
+    {
+        const efx_functions_t* efx = it.key()->getEfx();
+
+        if (efx == Q_NULLPTR || it.value().slot == 0)
+            continue;
+
+        it.key()->makeCurrent();
+        efx->alDeleteAuxiliaryEffectSlots(1, &it.value().slot);
+        efx->alDeleteEffects(1, &it.value().effect);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть имя зоны
+//-----------------------------------------------------------------------------
+QString ASoundZone::getName() const
+{
+    return name_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Использовать реверберацию
+//-----------------------------------------------------------------------------
+void ASoundZone::setReverb(const zone_reverb_t &reverb)
+{
+    effectType_ = AL_EFFECT_REVERB;
+    reverb_ = reverb;
+
+    applyEffect_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Использовать эхо
+//-----------------------------------------------------------------------------
+void ASoundZone::setEcho(const zone_echo_t &echo)
+{
+    effectType_ = AL_EFFECT_ECHO;
+    echo_ = echo;
+
+    applyEffect_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть громкость эффекта зоны
+//-----------------------------------------------------------------------------
+float ASoundZone::getGain() const
+{
+    return gain_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить громкость эффекта зоны
+//-----------------------------------------------------------------------------
+void ASoundZone::setGain(float gain)
+{
+    gain_ = qBound(0.0f, gain, 1.0f);
+
+    for (QMap<AListener*, zone_slot_t>::const_iterator it = slots_.constBegin();
+         it != slots_.constEnd(); ++it)
+    {
+        const efx_functions_t* efx = it.key()->getEfx();
+
+        if (efx == Q_NULLPTR || it.value().slot == 0)
+            continue;
+
+        it.key()->makeCurrent();
+        efx->alAuxiliaryEffectSlotf(it.value().slot, AL_EFFECTSLOT_GAIN, gain_);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Задать границы зоны
+//-----------------------------------------------------------------------------
+void ASoundZone::setBox(const float min[3], const float max[3])
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        boxMin_[i] = qMin(min[i], max[i]);
+        boxMax_[i] = qMax(min[i], max[i]);
+    }
+
+    hasBox_ = true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Содержит ли зона точку
+//-----------------------------------------------------------------------------
+bool ASoundZone::contains(float x, float y, float z) const
+{
+    return hasBox_ &&
+            x >= boxMin_[0] && x <= boxMax_[0] &&
+            y >= boxMin_[1] && y <= boxMax_[1] &&
+            z >= boxMin_[2] && z <= boxMax_[2];
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть наименьшую зону, содержащую точку
+//-----------------------------------------------------------------------------
+ASoundZone *ASoundZone::find(float x, float y, float z)
+{
+    ASoundZone* found = Q_NULLPTR;
+    float foundVolume = 0.0f;
+
+    // Вложенные зоны (станция в тоннеле) - побеждает внутренняя
+    for (ASoundZone* zone : zones_)
+    {
+        if (!zone->contains(x, y, z))
+            continue;
+
+        float volume = (zone->boxMax_[0] - zone->boxMin_[0]) *
+                (zone->boxMax_[1] - zone->boxMin_[1]) *
+                (zone->boxMax_[2] - zone->boxMin_[2]);
+
+        if (found == Q_NULLPTR || volume < foundVolume)
+        {
+            found = zone;
+            foundVolume = volume;
+        }
+    }
+
+    return found;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Слот зоны на устройстве
+//-----------------------------------------------------------------------------
+ALuint ASoundZone::slot_(AListener *output)
+{
+    QMap<AListener*, zone_slot_t>::const_iterator it = slots_.constFind(output);
+
+    if (it != slots_.constEnd())
+        return it.value().slot;
+
+    const efx_functions_t* efx = output->getEfx();
+
+    if (efx == Q_NULLPTR)
+        return 0;
+
+    output->makeCurrent();
+
+    // Сбрасываем ошибки предыдущих вызовов - проверяется только создание слота
+    alGetError();
+
+    zone_slot_t slot;
+    efx->alGenAuxiliaryEffectSlots(1, &slot.slot);
+    efx->alGenEffects(1, &slot.effect);
+
+    if (alGetError() != AL_NO_ERROR)
+    {
+        // Удаляем то, что успело создаться
+        if (slot.slot != 0)
+            efx->alDeleteAuxiliaryEffectSlots(1, &slot.slot);
+
+        if (slot.effect != 0)
+            efx->alDeleteEffects(1, &slot.effect);
+
+        alGetError();
+
+        output->log_->notify("E - CANT_CREATE_EFFECT_SLOT: " + name_.toStdString());
+
+        // Запоминаем неудачу: посылы зоны обновляются каждый шаг перехода,
+        // и повторные попытки только засыпали бы журнал
+        slots_.insert(output, zone_slot_t());
+        return 0;
+    }
+
+    applyEffect_(output, slot);
+    efx->alAuxiliaryEffectSlotf(slot.slot, AL_EFFECTSLOT_GAIN, gain_);
+
+    slots_.insert(output, slot);
+
+    return slot.slot;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Передать параметры эффекта в слот
+//-----------------------------------------------------------------------------
+void ASoundZone::applyEffect_(AListener *output, const zone_slot_t &slot)
+{
+    const efx_functions_t* efx = output->getEfx();
+
+    output->makeCurrent();
+
+    efx->alEffecti(slot.effect, AL_EFFECT_TYPE, effectType_);
+
+    if (effectType_ == AL_EFFECT_ECHO)
+    {
+        efx->alEffectf(slot.effect, AL_ECHO_DELAY, echo_.delay);
+        efx->alEffectf(slot.effect, AL_ECHO_LRDELAY, echo_.lrDelay);
+        efx->alEffectf(slot.effect, AL_ECHO_DAMPING, echo_.damping);
+        efx->alEffectf(slot.effect, AL_ECHO_FEEDBACK, echo_.feedback);
+        efx->alEffectf(slot.effect, AL_ECHO_SPREAD, echo_.spread);
+    }
+    else
+    {
+        efx->alEffectf(slot.effect, AL_REVERB_DENSITY, reverb_.density);
+        efx->alEffectf(slot.effect, AL_REVERB_DIFFUSION, reverb_.diffusion);
+        efx->alEffectf(slot.effect, AL_REVERB_GAIN, reverb_.gain);
+        efx->alEffectf(slot.effect, AL_REVERB_GAINHF, reverb_.gainHF);
+        efx->alEffectf(slot.effect, AL_REVERB_DECAY_TIME, reverb_.decayTime);
+        efx->alEffectf(slot.effect, AL_REVERB_DECAY_HFRATIO, reverb_.decayHFRatio);
+        efx->alEffectf(slot.effect, AL_REVERB_REFLECTIONS_GAIN, reverb_.reflectionsGain);
+        efx->alEffectf(slot.effect, AL_REVERB_REFLECTIONS_DELAY, reverb_.reflectionsDelay);
+        efx->alEffectf(slot.effect, AL_REVERB_LATE_REVERB_GAIN, reverb_.lateReverbGain);
+        efx->alEffectf(slot.effect, AL_REVERB_LATE_REVERB_DELAY, reverb_.lateReverbDelay);
+    }
+
+    // Слот копирует параметры эффекта при назначении
+    efx->alAuxiliaryEffectSloti(slot.slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(slot.effect));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Передать параметры эффекта во все слоты
+//-----------------------------------------------------------------------------
+void ASoundZone::applyEffect_()
+{
+    for (QMap<AListener*, zone_slot_t>::const_iterator it = slots_.constBegin();
+         it != slots_.constEnd(); ++it)
+    {
+        if (it.value().slot != 0)
+            applyEffect_(it.key(), it.value());
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Забыть объекты EFX устройства всех зон
+//-----------------------------------------------------------------------------
+void ASoundZone::forgetOutput_(AListener *output, bool destroy)
+{
+    const efx_functions_t* efx = output->getEfx();
+
+    for (ASoundZone* zone : zones_)
+    {
+        QMap<AListener*, zone_slot_t>::iterator it = zone->slots_.find(output);
+
+        if (it == zone->slots_.end())
+            continue;
+
+        if (destroy && efx != Q_NULLPTR && it.value().slot != 0)
+        {
+            output->makeCurrent();
+            efx->alDeleteAuxiliaryEffectSlots(1, &it.value().slot);
+            efx->alDeleteEffects(1, &it.value().effect);
+        }
+
+        zone->slots_.erase(it);
+    }
+}
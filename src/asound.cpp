@@ -9,23 +9,73 @@
 
 #include "asound.h"
 #include "asound-log.h"
-#include <QFile>
+#include "asound-bank.h"
+#include "asound-store.h"
+#include "asound-group.h"
+#include "asound-lod.h"
+#include "asound-device.h"
+#include "asound-zone.h"
+#include "asound-reload.h"
 #include <QTimer>
+#include <QElapsedTimer>
+#include <cmath>
 
 // ****************************************************************************
 // *                         Класс AListener                                  *
 // ****************************************************************************
+/// Открытые устройства вывода
+QList<AListener*> AListener::outputs_;
+
+/// Параметры устройства по умолчанию
+output_config_t AListener::defaultConfig_;
+
+/// Способ вывода звука
+int AListener::backend_ = BACKEND_OPENAL;
+
+/// Модельное время
+double AListener::simTime_ = -1.0;
+
+/// Устройство, контекст которого текущий для всего процесса
+static AListener* processOutput = nullptr;
+
+/// Устройство, контекст которого текущий для данного потока
+static thread_local AListener* threadOutput = nullptr;
+
 //-----------------------------------------------------------------------------
 // КОНСТРУКТОР
 //-----------------------------------------------------------------------------
-AListener::AListener()
+AListener::AListener(const QString &deviceName, LogFileHandler *log,
+                     const output_config_t &config)
+    : config_(config)
+    , deviceName_(deviceName)
+    , defaultLoadFlags_(LOAD_DEFAULT)
+    , normalize_(false)
+    , loudnessTarget_(DEF_LOUDNESS_TARGET)
+    , frequency_(0)
+    , refresh_(0)
+    , deferDepth_(0)
+    , alDeferUpdatesSOFT_(nullptr)
+    , alProcessUpdatesSOFT_(nullptr)
+    , device_(nullptr)
+    , context_(nullptr)
+    , alcSetThreadContext_(nullptr)
+    , alcReopenDeviceSOFT_(nullptr)
+    , disconnectExt_(false)
+    , alcResetDeviceSOFT_(nullptr)
+    , alcGetInteger64vSOFT_(nullptr)
+    , alGetSourcedvSOFT_(nullptr)
+    , alGetSourcei64vSOFT_(nullptr)
+    , alBufferCallbackSOFT_(nullptr)
+    , efxSupported_(false)
+    , sendFilter_(0)
+    , auxSends_(0)
+    , listenerDirty_(0)
 {
-    // Открываем устройство
-    device_ = alcOpenDevice(nullptr);
-    // Создаём контекст
-    context_ = alcCreateContext(device_, nullptr);
-    // Устанавливаем текущий контекст
-    alcMakeContextCurrent(context_);
+    memset(&efx_, 0, sizeof(efx_));
+    memset(occlusionFilters_, 0, sizeof(occlusionFilters_));
+
+    // Журнал общий для всех устройств
+    log_ = (log != nullptr) ? log : new LogFileHandler("asound.log");
 
     // Инициализируем положение слушателя
     memcpy(listenerPosition_,    DEF_LSN_POS, 3 * sizeof(float));
@@ -34,15 +84,48 @@ AListener::AListener()
     // Инициализируем векторы направления слушателя
     memcpy(listenerOrientation_, DEF_LSN_ORI, 6 * sizeof(float));
 
-    // Устанавливаем положение слушателя
-    alListenerfv(AL_POSITION,    listenerPosition_);
-    // Устанавливаем скорость слушателя
-    alListenerfv(AL_VELOCITY,    listenerVelocity_);
-    // Устанавливаем направление слушателя
-    alListenerfv(AL_ORIENTATION, listenerOrientation_);
+    // Устройство по умолчанию регистрируется и без звуковой карты -
+    // монитор откроет его при подключении
+    if (log == nullptr)
+        outputs_.append(this);
+
+    if (log == nullptr && qgetenv("ASOUND_BACKEND") == "null")
+        backend_ = BACKEND_NULL;
+
+    // Без вывода устройство не открывается - только частота для загрузки
+    if (backend_ == BACKEND_NULL)
+    {
+        frequency_ = (config_.frequency > 0) ? config_.frequency : DEF_NULL_FREQUENCY;
+        refresh_ = config_.refresh;
+
+        if (log != nullptr)
+            outputs_.append(this);
+
+        log_->notify("T Null output: " + deviceName.toStdString());
+
+        return;
+    }
+
+    // Открываем устройство
+    QByteArray name = deviceName.toUtf8();
+    device_ = alcOpenDevice(deviceName.isEmpty() ? nullptr : name.constData());
 
-    log_ = new LogFileHandler("asound.log");
+    if (device_ == nullptr)
+        return;
+
+    // Создаём контекст с запрошенными параметрами
+    QVector<ALCint> attributes = attributes_();
+    context_ = alcCreateContext(device_, attributes.constData());
+
+    if (context_ == nullptr)
+        return;
 
+    // Устанавливаем текущий контекст: устройство по умолчанию - для всего
+    // процесса, дополнительные - по мере обращения к ним
+    setupContext_(log == nullptr);
+
+    if (log != nullptr)
+        outputs_.append(this);
 }
 
 
@@ -53,7 +136,7 @@ AListener::AListener()
 AListener& AListener::getInstance()
 {
     // Создаем статичный экземпляр класса
-    static AListener instance;
+    static AListener instance(QString(), nullptr, defaultConfig_);
     // Возвращаем его при каждом вызове метода
     return instance;
 }
@@ -61,802 +144,3365 @@ AListener& AListener::getInstance()
 
 
 //-----------------------------------------------------------------------------
-//
+// Открыть дополнительное устройство вывода
 //-----------------------------------------------------------------------------
-void AListener::closeDevices()
+AListener *AListener::openOutput(const QString &deviceName, const output_config_t &config)
 {
-    alcDestroyContext(context_);
-    alcCloseDevice(device_);
+    // Устройство по умолчанию открывается первым и владеет журналом
+    AListener* output = new AListener(deviceName, getInstance().log_, config);
+
+    if (backend_ != BACKEND_NULL && output->context_ == nullptr)
+    {
+        output->log_->notify("E - CANT_OPEN_OUTPUT: " + deviceName.toStdString());
+        output->closeDevices();
+        delete output;
+        return nullptr;
+    }
+
+    output->log_->notify("T Open output: " + output->getDeviceName().toStdString());
+
+    return output;
 }
 
 
 
-// ****************************************************************************
-// *                            Класс ASound                                  *
-// ****************************************************************************
 //-----------------------------------------------------------------------------
-// КОНСТРУКТОР
+// Выбрать способ вывода звука
 //-----------------------------------------------------------------------------
-ASound::ASound(QString soundname, QObject *parent): QObject(parent),
-    canDo_(false),              // Сбрасываем флаг
-    canPlay_(false),            // Сбрасываем флаг
-    soundName_(soundname),      // Сохраняем название звука
-    source_(0),                 // Обнуляем источник
-    format_(0),                 // Обнуляем формат
-    sourceVolume_(DEF_SRC_VOLUME),  // Громкость по умолч.
-    sourcePitch_(DEF_SRC_PITCH),    // Скорость воспроизведения по умолч.
-    sourceLoop_(false)         // Зацикливание по-умолч.
-{ 
-    // Инициализируем позицию источника
-    memcpy(sourcePosition_, DEF_SRC_POS, 3 * sizeof(float));
-    // Инициализируем вектор "скорости передвижения" источника
-    memcpy(sourceVelocity_, DEF_SRC_VEL, 3 * sizeof(float));
-    // Создаём контейнер аудиофайла
-    file_ = new QFile();
+void AListener::setBackend(int backend)
+{
+    backend_ = backend;
+}
 
-    // Зануляем все буферы и блоки данных
-    for (int i = 0; i < BUFFER_BLOCKS; ++i)
-    {
-        wavData_[i] = nullptr;
-        buffer_[i] = 0;
-        blockSize_[i] = 0;
-    }
 
-    connect(this, &ASound::notify, AListener::getInstance().log_, &LogFileHandler::notify);
-    connect(this, &ASound::lastErrorChanged_, AListener::getInstance().log_, &LogFileHandler::notify);
 
-    emit notify("T Load sound: " + soundname.toStdString());
+//-----------------------------------------------------------------------------
+// Вернуть способ вывода звука
+//-----------------------------------------------------------------------------
+int AListener::getBackend()
+{
+    return backend_;
+}
 
-    // Загружаем звук
-    loadSound_(soundname);
 
-    timerStartKiller_ = Q_NULLPTR;
+
+//-----------------------------------------------------------------------------
+// Задать модельное время
+//-----------------------------------------------------------------------------
+void AListener::setSimTime(double seconds)
+{
+    simTime_ = qMax(0.0, seconds);
 }
 
 
 
 //-----------------------------------------------------------------------------
-// ДЕСТРУКТОР
+// Время для расчёта воспроизведения без вывода
 //-----------------------------------------------------------------------------
-ASound::~ASound()
+double AListener::backendTime_()
 {
-    // Удаляем контейнеры данных
-    deleteWAVEDataContainers();
+    if (simTime_ >= 0.0)
+        return simTime_;
 
-    // Удаляем источник
-    alDeleteSources(1, &source_);
-    // Удаляем буфер
-    alDeleteBuffers(BUFFER_BLOCKS, buffer_);
+    static QElapsedTimer clock;
+
+    if (!clock.isValid())
+        clock.start();
+
+    return 1.0e-9 * static_cast<double>(clock.nsecsElapsed());
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Очистка контейнеров данных дорожки
+// Закрыть дополнительное устройство вывода
 //-----------------------------------------------------------------------------
-void ASound::deleteWAVEDataContainers()
+void AListener::closeOutput(AListener *output)
 {
-    for (int i = 0; i < BUFFER_BLOCKS; ++i)
-    {
-        if (wavData_[i])
-            delete wavData_[i];
-    }
+    if (output == nullptr || output == &getInstance())
+        return;
+
+    outputs_.removeOne(output);
+    ASoundZone::forgetOutput_(output, true);
+    output->closeDevices();
+    delete output;
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Полная подготовка файла
+// Вернуть все открытые устройства вывода
 //-----------------------------------------------------------------------------
-void ASound::loadSound_(QString soundname)
+QList<AListener *> AListener::getOutputs()
 {
-    // Сбрасываем флаги
-    canDo_ = false;
-    canPlay_ = false;
-    canCUE_ = false;
-    canLABL_ = false;
-
-    // Сохраняем название звука
-    soundName_ = soundname;
+    getInstance();
 
-    // Загружаем файл
-    loadFile_(soundname);
+    return outputs_;
+}
 
-    // Читаем информационный раздел 44байта
-    readWaveInfo_();
 
-    // Определяем формат аудио (mono8/16 - stereo8/16) OpenAL
-    defineFormat_();
 
-    // Генерируем буфер и источник
-    generateStuff_();
+//-----------------------------------------------------------------------------
+// Вернуть имена доступных устройств вывода
+//-----------------------------------------------------------------------------
+QStringList AListener::getDeviceNames()
+{
+    QStringList names;
 
-    // Настраиваем источник
-    configureSource_();
+    const ALCchar* list = alcIsExtensionPresent(nullptr, "ALC_ENUMERATE_ALL_EXT")
+            ? alcGetString(nullptr, ALC_ALL_DEVICES_SPECIFIER)
+            : alcGetString(nullptr, ALC_DEVICE_SPECIFIER);
 
-    // Можно играть звук
-    if (canDo_)
+    // Список имён, разделённых нулями, в конце - двойной ноль
+    while (list != nullptr && *list != '\0')
     {
-        canPlay_ = true;
+        names.append(QString::fromUtf8(list));
+        list += strlen(list) + 1;
     }
+
+    return names;
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Загрузка файла (в т.ч. из ресурсов)
+// Начать пакет изменений на всех устройствах
 //-----------------------------------------------------------------------------
-void ASound::loadFile_(QString soundname)
+void AListener::deferAllUpdates()
 {
-    // Загружаем файл в контейнер
-    file_->setFileName(soundname);
+    for (AListener* output : getOutputs())
+        output->deferUpdates();
+}
+
 
-    // Проверяем, существует ли файл
-    if (!file_->exists())
-    {
-        setLastError("NO_SUCH_FILE: " + soundname.toStdString());
-        lastError_ = "NO_SUCH_FILE: ";
-        lastError_.append(soundname);
-        canDo_ = false;
-        return;
-    }
 
-    // Пытаемся открыть файл
-    if (file_->open(QIODevice::ReadOnly))
+//-----------------------------------------------------------------------------
+// Применить пакеты изменений всех устройств
+//-----------------------------------------------------------------------------
+void AListener::processAllUpdates()
+{
+    for (AListener* output : getOutputs())
+        output->processUpdates();
+}
+
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+void AListener::closeDevices()
+{
+    // Текущий контекст удалить нельзя
+    if (threadOutput == this)
     {
-        canDo_ = true;
+        alcSetThreadContext_(nullptr);
+        threadOutput = nullptr;
     }
-    else
+
+    if (processOutput == this)
     {
-        canDo_ = false;
-        lastError_ = "CANT_OPEN_FILE_FOR_READING: ";
-        lastError_.append(soundname);
-        return;
+        alcMakeContextCurrent(nullptr);
+        processOutput = nullptr;
     }
+
+    if (context_ != nullptr)
+        alcDestroyContext(context_);
+
+    if (device_ != nullptr)
+        alcCloseDevice(device_);
+
+    context_ = nullptr;
+    device_ = nullptr;
+
+    // Общие буферы удалены вместе с контекстом
+    buffers_.clear();
+    bufferBlocks_.clear();
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Чтение информации о файле .wav
+// Вернуть имя устройства
 //-----------------------------------------------------------------------------
-void ASound::readWaveInfo_()
+QString AListener::getDeviceName() const
 {
-    if (canDo_)
-    {
-        // Если ранее был загружен другой файл
-        deleteWAVEDataContainers();
-
-        // Читаем первые 12 байт файла
-        readWaveHeader_();
+    if (device_ == nullptr)
+        return QString();
 
-        // Следующие 4 байта
-        QByteArray arr = file_->read(4);
+    const ALCchar* name = alcIsExtensionPresent(device_, "ALC_ENUMERATE_ALL_EXT")
+            ? alcGetString(device_, ALC_ALL_DEVICES_SPECIFIER)
+            : alcGetString(device_, ALC_DEVICE_SPECIFIER);
 
-        if (strncmp(arr.data(), "JUNK", 4) == 0)
-        {
-            // Читаем длину сегмента JUNK
-            arr = file_->read(4);
-            int JUNKLen = arr.at(0);
-            // Читаем данные блока JUNK в "никуда"
-            file_->read(JUNKLen);
-        }
+    return QString::fromUtf8(name);
+}
 
-        readWaveFmtData_(arr);
 
-        if (canDo_)
-        {
-            // Читаем из файла сами медиа данные зная их размер
-            arr = file_->read(wave_info_file_data_.subchunk2Size);
-            // Читаем оставшуюся информацию из WAVE файла
-            uint32_t extraBlockSize =
-                    static_cast<uint32_t>(file_->size()) - wave_info_file_data_.subchunk2Size - sizeof(wave_info_fmt_t);
-            QByteArray arrDop = file_->read(extraBlockSize);
-
-            getCUE_(arrDop);
-
-            if (canCUE_)
-                getLabels_(arrDop);
-
-            // Итератор для data и сдвиг точки копирования в блоке данных звука
-            int32_t i = 0, data_offset = 0;
-            // Массив байтов текущего блока для копирования в data
-            QByteArray blockData;
-            // Если присутствуют метки - грузим их в три буфера
-            if (canLABL_)
-            {
-                QMap<QString, uint64_t>::const_iterator labl_map = wave_labels_.constBegin();
-                while (labl_map != wave_labels_.constEnd()) {
-                    if (labl_map.key() == "loop" || labl_map.key() == "stop")
-                    {
-                        blockSize_[i] = labl_map.value() - static_cast<uint64_t>(data_offset);
-                        wavData_[i] = new unsigned char[blockSize_[i]];
-                        blockData = arr.mid(data_offset, static_cast<int32_t>(labl_map.value()));
-                        memcpy(wavData_[i], blockData.data(),
-                               blockSize_[i]);
-                        data_offset += blockSize_[i];
-                        ++i;
-                    }
-                    ++labl_map;
-                }
-            }
 
-            // Создаем массив для данных
-            blockSize_[i] = wave_info_file_data_.subchunk2Size - static_cast<uint32_t>(data_offset);
-            wavData_[i] = new unsigned char[blockSize_[i]];
-            blockData = arr.mid(data_offset, static_cast<int>(blockSize_[i]));
-            // Переносим данные в массив
-            memcpy(wavData_[i], blockData.data(),
-                   blockSize_[i]);
-            ++i;
-            emit notify("| - File size: " + QString::number(file_->size()).toStdString());
-            emit notify("| - File data size: " + QString::number(wave_info_file_data_.subchunk2Size).toStdString());
-            emit notify("| - Byterate: " + QString::number(wave_info_.byteRate).toStdString());
-            emit notify("| - Sample rate: " + QString::number(wave_info_.sampleRate).toStdString());
-            emit notify("| - Num channels: " + QString::number(wave_info_.numChannels).toStdString());
-            emit notify("| - Bits per sample: " + QString::number(wave_info_.bitsPerSample).toStdString());
-            emit notify("| - Bytes per sample: " + QString::number(wave_info_.bytesPerSample).toStdString());
-            emit notify("| - Buffer blocks: " + QString::number(i).toStdString());
+//-----------------------------------------------------------------------------
+// Сделать контекст устройства текущим
+//-----------------------------------------------------------------------------
+void AListener::makeCurrent()
+{
+    // Контекст потока имеет приоритет над контекстом процесса
+    AListener* current = (threadOutput != nullptr) ? threadOutput : processOutput;
 
-            for (int i = 0; i < BUFFER_BLOCKS; ++i)
-            {
-                emit notify("| - Block #" + QString::number(i).toStdString() +
-                            " size: " + QString::number(blockSize_[i]).toStdString());
-            }
+    if (current == this || context_ == nullptr)
+        return;
 
-            // Закрываем файл
-            file_->close();
+    if (alcSetThreadContext_ != nullptr)
+    {
+        alcSetThreadContext_(context_);
+        threadOutput = this;
+    }
+    else
+    {
+        // Контекст потока, выбранный другим устройством, заслонил бы наш
+        if (threadOutput != nullptr)
+        {
+            threadOutput->alcSetThreadContext_(nullptr);
+            threadOutput = nullptr;
         }
+
+        if (processOutput != this)
+            alcMakeContextCurrent(context_);
+
+        processOutput = this;
     }
 }
 
 
+
 //-----------------------------------------------------------------------------
-// Получение первых 12-и байт WAVE файла
+// Подключено ли устройство
 //-----------------------------------------------------------------------------
-void ASound::readWaveHeader_()
+bool AListener::isConnected() const
 {
-    // Читаем 12 байт информации о формате
-    QByteArray arr = file_->read(sizeof(wave_info_header_));
+    // Устройству без вывода нечего терять
+    if (backend_ == BACKEND_NULL)
+        return true;
+
+    if (device_ == nullptr || context_ == nullptr)
+        return false;
+
+    if (!disconnectExt_)
+        return true;
 
-    // Переносим все значения из массива в струтуру
-    memcpy(&wave_info_header_, arr.data(),
-           sizeof(wave_info_header_t));
-    // Проверка данных формата
-    checkValue(wave_info_header_.chunkId, "RIFF", "NOT_RIFF_FILE");
-    checkValue(wave_info_header_.format, "WAVE", "NOT_WAVE_FILE");
+    ALCint connected = ALC_TRUE;
+    alcGetIntegerv(device_, ALC_CONNECTED, 1, &connected);
+
+    return connected != ALC_FALSE;
 }
 
 
+
 //-----------------------------------------------------------------------------
-// Получение данных о формате файла и секции data
+// Настроить созданный контекст
 //-----------------------------------------------------------------------------
-void ASound::readWaveFmtData_(QByteArray arr)
+void AListener::setupContext_(bool processWide)
 {
-    //QByteArray arr;
-    // Ищем секцию data, откидывая все "ненужное" (PAD Sectors)
-    while (!file_->atEnd())
+    alcSetThreadContext_ = nullptr;
+    alcReopenDeviceSOFT_ = nullptr;
+    alcResetDeviceSOFT_ = nullptr;
+    alcGetInteger64vSOFT_ = nullptr;
+    alDeferUpdatesSOFT_ = nullptr;
+    alProcessUpdatesSOFT_ = nullptr;
+    alGetSourcedvSOFT_ = nullptr;
+    alGetSourcei64vSOFT_ = nullptr;
+    alBufferCallbackSOFT_ = nullptr;
+
+    // Контекст для отдельного потока
+    if (alcIsExtensionPresent(device_, "ALC_EXT_thread_local_context"))
     {
-        if (strncmp(arr.data(), "fmt ", 4) == 0)
-        {
-            arr = file_->read(sizeof(wave_info_) - 4);
-            arr.insert(0, "fmt ");
-            memcpy(&wave_info_, arr.data(), sizeof(wave_info_));
+        alcSetThreadContext_ = reinterpret_cast<PFNALCSETTHREADCONTEXTPROC>(
+                    alcGetProcAddress(device_, "alcSetThreadContext"));
+    }
 
-            do {
-                arr = file_->read(1);
-            } while (strncmp(arr.data(), "\0", 1) == 0);
+    // Обнаружение потери устройства и его переоткрытие
+    disconnectExt_ = alcIsExtensionPresent(device_, "ALC_EXT_disconnect");
 
-            arr = file_->read(3);
-            arr = file_->read(sizeof(wave_info_file_data_) - 4);
-            arr.insert(0, "data");
-            memcpy(&wave_info_file_data_, arr.data(), sizeof(wave_info_file_data_));
+    if (alcIsExtensionPresent(device_, "ALC_SOFT_reopen_device"))
+    {
+        alcReopenDeviceSOFT_ = reinterpret_cast<LPALCREOPENDEVICESOFT>(
+                    alcGetProcAddress(device_, "alcReopenDeviceSOFT"));
+    }
 
-            if (strncmp(wave_info_file_data_.subchunk2Id, "data", 4) == 0)
-                break;
-        }
-        arr = file_->read(4);
+    // Изменение параметров на ходу
+    if (alcIsExtensionPresent(device_, "ALC_SOFT_HRTF"))
+    {
+        alcResetDeviceSOFT_ = reinterpret_cast<LPALCRESETDEVICESOFT>(
+                    alcGetProcAddress(device_, "alcResetDeviceSOFT"));
+    }
+
+    // Часы и задержка устройства
+    if (alcIsExtensionPresent(device_, "ALC_SOFT_device_clock"))
+    {
+        alcGetInteger64vSOFT_ = reinterpret_cast<LPALCGETINTEGER64VSOFT>(
+                    alcGetProcAddress(device_, "alcGetInteger64vSOFT"));
+    }
+
+    if (processWide)
+    {
+        alcMakeContextCurrent(context_);
+        processOutput = this;
+    }
+    else
+    {
+        makeCurrent();
+    }
+
+    // Запоминаем частоту микширования
+    alcGetIntegerv(device_, ALC_FREQUENCY, 1, &frequency_);
+    alcGetIntegerv(device_, ALC_REFRESH, 1, &refresh_);
+
+    log_->notify("| - Output: " + getDeviceName().toStdString() +
+                 ", " + QString::number(frequency_).toStdString() + " Hz" +
+                 ", refresh " + QString::number(refresh_).toStdString() + " Hz" +
+                 ", latency " + QString::number(qMax(0.0, getLatency()) * 1000.0).toStdString() + " ms");
+
+    // Отложенное применение изменений источников
+    if (alIsExtensionPresent("AL_SOFT_deferred_updates"))
+    {
+        alDeferUpdatesSOFT_ = reinterpret_cast<LPALDEFERUPDATESSOFT>(
+                    alGetProcAddress("alDeferUpdatesSOFT"));
+        alProcessUpdatesSOFT_ = reinterpret_cast<LPALPROCESSUPDATESSOFT>(
+                    alGetProcAddress("alProcessUpdatesSOFT"));
+    }
+
+    // Позиция воспроизведения вместе с задержкой вывода
+    if (alIsExtensionPresent("AL_SOFT_source_latency"))
+    {
+        alGetSourcedvSOFT_ = reinterpret_cast<LPALGETSOURCEDVSOFT>(
+                    alGetProcAddress("alGetSourcedvSOFT"));
+        alGetSourcei64vSOFT_ = reinterpret_cast<LPALGETSOURCEI64VSOFT>(
+                    alGetProcAddress("alGetSourcei64vSOFT"));
+    }
+
+    // Буферы, наполняемые микшером (генераторы звука)
+    if (alIsExtensionPresent("AL_SOFT_callback_buffer"))
+    {
+        alBufferCallbackSOFT_ = reinterpret_cast<LPALBUFFERCALLBACKSOFT>(
+                    alGetProcAddress("alBufferCallbackSOFT"));
     }
+
+    // Эффекты окружения и фильтры
+    loadEfx_();
+
+    // Устанавливаем положение слушателя
+    alListenerfv(AL_POSITION,    listenerPosition_);
+    // Устанавливаем скорость слушателя
+    alListenerfv(AL_VELOCITY,    listenerVelocity_);
+    // Устанавливаем направление слушателя
+    alListenerfv(AL_ORIENTATION, listenerOrientation_);
+
+    listenerDirty_ = 0;
 }
 
 
+
 //-----------------------------------------------------------------------------
-// Получение фрагмента CUE *.WAVE формата
+// Получить функции EFX и создать общие объекты EFX контекста
 //-----------------------------------------------------------------------------
-void ASound::getCUE_(QByteArray &baseStr)
+void AListener::loadEfx_()
 {
-    QByteArray cueChunckID("cue ");
-    // Находим заголовок фрагмента cue
-    int cueFirstByte = baseStr.indexOf(cueChunckID);
-    // Если заголовок был найден
-    if (cueFirstByte != -1)
+    efxSupported_ = false;
+    sendFilter_ = 0;
+    auxSends_ = 0;
+    memset(occlusionFilters_, 0, sizeof(occlusionFilters_));
+
+    if (!alcIsExtensionPresent(device_, "ALC_EXT_EFX"))
+        return;
+
+    efx_.alGenEffects = reinterpret_cast<LPALGENEFFECTS>(alGetProcAddress("alGenEffects"));
+    efx_.alDeleteEffects = reinterpret_cast<LPALDELETEEFFECTS>(alGetProcAddress("alDeleteEffects"));
+    efx_.alEffecti = reinterpret_cast<LPALEFFECTI>(alGetProcAddress("alEffecti"));
+    efx_.alEffectf = reinterpret_cast<LPALEFFECTF>(alGetProcAddress("alEffectf"));
+    efx_.alGenFilters = reinterpret_cast<LPALGENFILTERS>(alGetProcAddress("alGenFilters"));
+    efx_.alDeleteFilters = reinterpret_cast<LPALDELETEFILTERS>(alGetProcAddress("alDeleteFilters"));
+    efx_.alFilteri = reinterpret_cast<LPALFILTERI>(alGetProcAddress("alFilteri"));
+    efx_.alFilterf = reinterpret_cast<LPALFILTERF>(alGetProcAddress("alFilterf"));
+    efx_.alGenAuxiliaryEffectSlots = reinterpret_cast<LPALGENAUXILIARYEFFECTSLOTS>(
+                alGetProcAddress("alGenAuxiliaryEffectSlots"));
+    efx_.alDeleteAuxiliaryEffectSlots = reinterpret_cast<LPALDELETEAUXILIARYEFFECTSLOTS>(
+                alGetProcAddress("alDeleteAuxiliaryEffectSlots"));
+    efx_.alAuxiliaryEffectSloti = reinterpret_cast<LPALAUXILIARYEFFECTSLOTI>(
+                alGetProcAddress("alAuxiliaryEffectSloti"));
+    efx_.alAuxiliaryEffectSlotf = reinterpret_cast<LPALAUXILIARYEFFECTSLOTF>(
+                alGetProcAddress("alAuxiliaryEffectSlotf"));
+
+    if (efx_.alGenFilters == nullptr || efx_.alDeleteFilters == nullptr ||
+            efx_.alGenAuxiliaryEffectSlots == nullptr)
+        return;
+
+    // Сбрасываем ошибки предыдущих вызовов - проверяется только настройка EFX
+    alGetError();
+
+    efx_.alGenFilters(1, &sendFilter_);
+    efx_.alFilteri(sendFilter_, AL_FILTER_TYPE, AL_FILTER_LOWPASS);
+    efx_.alFilterf(sendFilter_, AL_LOWPASS_GAINHF, 1.0f);
+
+    // Устройство может выделить меньше посылов, чем запрошено
+    alcGetIntegerv(device_, ALC_MAX_AUXILIARY_SENDS, 1, &auxSends_);
+
+    // Фильтры заглушения общие для всех источников: параметры фильтра
+    // копируются в источник при назначении. Высокие частоты спадают
+    // экспоненциально - равными шагами в децибелах
+    efx_.alGenFilters(OCCLUSION_LEVELS - 1, occlusionFilters_ + 1);
+
+    for (int level = 1; level < OCCLUSION_LEVELS; ++level)
+    {
+        float occlusion = static_cast<float>(level) / (OCCLUSION_LEVELS - 1);
+
+        efx_.alFilteri(occlusionFilters_[level], AL_FILTER_TYPE, AL_FILTER_LOWPASS);
+        efx_.alFilterf(occlusionFilters_[level], AL_LOWPASS_GAIN,
+                       1.0f - occlusion * (1.0f - OCCLUSION_GAIN));
+        efx_.alFilterf(occlusionFilters_[level], AL_LOWPASS_GAINHF,
+                       std::pow(OCCLUSION_GAINHF, occlusion));
+    }
+
+    efxSupported_ = (alGetError() == AL_NO_ERROR);
+
+    if (!efxSupported_)
     {
-        // Загружаем во временный массив "шапку" фрагмента cue
-        QByteArray tmp_data = baseStr.mid(cueFirstByte,
-                                          sizeof(wave_cue_head_t));
-        // Загружаем данные в структуру
-        memcpy(&cue_head_, tmp_data.data(), sizeof(wave_cue_head_t));
-        // Создаем временную структуру данных фрагмента cue
-        wave_cue_data_t cue_data_t_;
-        // Вычисляем смещение к первому блоку данных фрагмента cue
-        int cue_data_offset = cueFirstByte + static_cast<int>(sizeof(wave_cue_head_t));
-        // В цикле загружаем все данные точек cue
-        for (int i = 1; i <= static_cast<int>(cue_head_.cueChunckPNum); ++i)
+        // Без EFX фильтры никому не нужны - удаляем созданные
+        if (sendFilter_ != 0)
+            efx_.alDeleteFilters(1, &sendFilter_);
+
+        for (int level = 1; level < OCCLUSION_LEVELS; ++level)
         {
-            // Во временный массив - блок данных cue
-            tmp_data = baseStr.mid(cue_data_offset,
-                                   sizeof (wave_cue_data_t));
-            // Данные во временную структуру
-            memcpy(&cue_data_t_, tmp_data.data(),
-                   sizeof(wave_cue_data_t));
-            // Временную структуру в общий список cue-точек
-            cue_data_.append(cue_data_t_);
-            // Смещение к следующей точку cue
-            cue_data_offset += static_cast<int>(sizeof(wave_cue_data_t));
+            if (occlusionFilters_[level] != 0)
+                efx_.alDeleteFilters(1, &occlusionFilters_[level]);
         }
 
-        canCUE_ = true;
+        sendFilter_ = 0;
+        memset(occlusionFilters_, 0, sizeof(occlusionFilters_));
+
+        alGetError();
     }
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Получение меток из фрагмента LIST->labls *.WAVE формата
+// Получить общий буфер блока PCM данных
 //-----------------------------------------------------------------------------
-void ASound::getLabels_(QByteArray &baseStr)
+ALuint AListener::acquireBuffer_(const unsigned char *pcm, uint64_t size,
+                                 ALenum format, ALsizei rate)
 {
-    // Читаем шапку блока LIST
-    readWaveListChunckHeader_(baseStr);
+    pcm_block_t block;
+    block.pcm = pcm;
+    block.size = size;
+    block.format = format;
+    block.rate = rate;
 
-    // Если был найден список
-    if (strncasecmp(list_head_.chunckId, "list", 4) == 0)
+    QMap<pcm_block_t, shared_buffer_t>::iterator it = buffers_.find(block);
+
+    if (it != buffers_.end())
     {
-        QByteArray lablChunckId("labl"), tmp_data;
+        ++it.value().refs;
+        return it.value().buffer;
+    }
 
-        int labelOffset = 0, labelFirstByte = 0;
+    // Размер буфера OpenAL - ALsizei
+    if (size > ASOUND_MAX_BLOCK)
+        return 0;
 
-        // Крутим пока не достигнем последней метки labl
-        do
-        {
-            labelFirstByte = baseStr.indexOf(lablChunckId, labelOffset);
-            int labelLength = 0; ///< Длина блока данных метки
-            int labelCueID = 0; ///< ID связанной точки cue
-            std::string labelName; ///< Имя метки
+    shared_buffer_t shared;
+    shared.refs = 1;
 
-            if (labelFirstByte != -1)
-            {
-                // Парсим секцию labl вручную, так как не знаем заранее его длину. . .
-                tmp_data = baseStr.mid(labelFirstByte + 4, 4);
-                labelLength = tmp_data.at(0); // Получаем длину метки в байтах
-                tmp_data = baseStr.mid(labelFirstByte + 8, 4);
-                labelCueID = tmp_data.at(0); // Получаем ID точки cue
-                tmp_data = baseStr.mid(labelFirstByte + 12, labelLength - 5);
-                labelName = tmp_data.data(); // Получаем имя метки
-
-                int index = 0; // Индекс для связанной точки cue в списке точек cue
-
-                for (int k = 0; k < cue_data_.count(); ++k)
-                    if (cue_data_[k].ID == labelCueID)
-                    {
-                        index = k;
-                        break;
-                    }
-
-                wave_labels_.insert(QString::fromStdString(labelName),
-                                    cue_data_[index].sampleOffset * static_cast<uint64_t>(wave_info_.bytesPerSample));
-
-                canLABL_ = true;
-            }
+    alGenBuffers(1, &shared.buffer);
+
+    if (alGetError() != AL_NO_ERROR)
+        return 0;
 
-            labelOffset = labelFirstByte + 4; // Сдвигаем поиск на следующую метку
-        } while (labelFirstByte != -1);
+    alBufferData(shared.buffer, format, pcm, static_cast<ALsizei>(size), rate);
+
+    if (alGetError() != AL_NO_ERROR)
+    {
+        alDeleteBuffers(1, &shared.buffer);
+        return 0;
     }
+
+    buffers_.insert(block, shared);
+    bufferBlocks_.insert(shared.buffer, block);
+
+    return shared.buffer;
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Чтение шапки фрагмента LIST файла wav
+// Освободить общие буферы
 //-----------------------------------------------------------------------------
-void ASound::readWaveListChunckHeader_(QByteArray &baseStr)
+void AListener::releaseBuffers_(const ALuint *buffers, int count)
 {
-    QByteArray listChunckID("LIST");
-    // Некоторые программы сохраняют фрагмент LIST - маленькими буквами
-    QByteArray listChunckIDLower("list");
-    // Номер первого байта списка
-    int listFirstByte = baseStr.indexOf(listChunckID);
-    listFirstByte =
-            (listFirstByte == -1 ?
-                 baseStr.indexOf(listChunckIDLower) : listFirstByte);
-    if (listFirstByte != -1)
+    for (int i = 0; i < count; ++i)
     {
-        // Загружаем во временный массив блок "шапки" фрагмента LIST
-        QByteArray tmp_data = baseStr.mid(listFirstByte,
-                                          sizeof(wave_list_head_t));
+        QMap<ALuint, pcm_block_t>::iterator block = bufferBlocks_.find(buffers[i]);
 
-        // Данные со временного массива - в структуру
-        memcpy(&list_head_, tmp_data.data(),
-               sizeof(wave_list_head_t));
+        if (block == bufferBlocks_.end())
+            continue;
+
+        QMap<pcm_block_t, shared_buffer_t>::iterator it = buffers_.find(block.value());
+
+        if (--it.value().refs > 0)
+            continue;
+
+        alDeleteBuffers(1, &it.value().buffer);
+
+        buffers_.erase(it);
+        bufferBlocks_.erase(block);
     }
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Определение формата аудио (mono8/16 - stereo8/16)
+// Вернуть функции EFX
 //-----------------------------------------------------------------------------
-void ASound::defineFormat_()
+const efx_functions_t *AListener::getEfx() const
 {
-    if (canDo_)
-    {
-        if (wave_info_.bitsPerSample == 8)      // Если бит в сэмпле 8
-        {
-            if (wave_info_.numChannels == 1)    // Если 1 канал
-            {
-                format_ = AL_FORMAT_MONO8;
-            }
-            else                                // Если 2 канала
-            {
-                format_ = AL_FORMAT_STEREO8;
-            }
-        }
-        else if (wave_info_.bitsPerSample == 16)// Если бит в сэмпле 16
-        {
-            if (wave_info_.numChannels == 1)    // Если 1 канал
-            {
-                format_ = AL_FORMAT_MONO16;
-            }
-            else                                // Если 2 канала
-            {
-                format_ = AL_FORMAT_STEREO16;
-            }
-        }
-        else                                    // Если все плохо
-        {
-            setLastError("UNKNOWN_AUDIO_FORMAT");
-            lastError_ = "UNKNOWN_AUDIO_FORMAT";
-            canDo_ = false;
-        }
-    }
+    return efxSupported_ ? &efx_ : nullptr;
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Генерация буфера и источника
+// Переоткрыть устройство
 //-----------------------------------------------------------------------------
-void ASound::generateStuff_()
+bool AListener::reopen_(bool &rebuilt)
 {
-    if (canDo_)
+    rebuilt = false;
+
+    QByteArray name = deviceName_.toUtf8();
+    const ALCchar* spec = deviceName_.isEmpty() ? nullptr : name.constData();
+
+    // Устройство переоткрывается под тем же контекстом - буферы и
+    // источники сохраняются, источники лишь остановлены
+    if (alcReopenDeviceSOFT_ != nullptr)
     {
-        // Генерируем буфер
-        alGenBuffers(BUFFER_BLOCKS, buffer_);
+        QVector<ALCint> attributes = attributes_();
 
-        if (alGetError() != AL_NO_ERROR)
+        if (!alcReopenDeviceSOFT_(device_, spec, attributes.constData()))
+            return false;
+
+        alcGetIntegerv(device_, ALC_FREQUENCY, 1, &frequency_);
+        alcGetIntegerv(device_, ALC_REFRESH, 1, &refresh_);
+
+        return true;
+    }
+
+    // Иначе пересоздаём контекст; прежний держим, пока не откроем новый
+    ALCdevice* device = alcOpenDevice(spec);
+
+    if (device == nullptr)
+        return false;
+
+    QVector<ALCint> attributes = attributes_();
+    ALCcontext* context = alcCreateContext(device, attributes.constData());
+
+    if (context == nullptr)
+    {
+        alcCloseDevice(device);
+        return false;
+    }
+
+    closeDevices();
+
+    device_ = device;
+    context_ = context;
+
+    setupContext_(this == &getInstance());
+
+    rebuilt = true;
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить флаги загрузки, применяемые ко всем создаваемым звукам
+//-----------------------------------------------------------------------------
+void AListener::setDefaultLoadFlags(int flags)
+{
+    defaultLoadFlags_ = flags;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть флаги загрузки по умолчанию
+//-----------------------------------------------------------------------------
+int AListener::getDefaultLoadFlags() const
+{
+    return defaultLoadFlags_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Выравнивать громкость звуков по результатам анализа при загрузке
+//-----------------------------------------------------------------------------
+void AListener::setNormalization(bool enabled, float target)
+{
+    normalize_ = enabled;
+    loudnessTarget_ = target;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Выравнивается ли громкость звуков
+//-----------------------------------------------------------------------------
+bool AListener::isNormalizationEnabled() const
+{
+    return normalize_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть целевую громкость выравнивания
+//-----------------------------------------------------------------------------
+float AListener::getLoudnessTarget() const
+{
+    return loudnessTarget_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть частоту микширования устройства
+//-----------------------------------------------------------------------------
+int AListener::getFrequency() const
+{
+    return frequency_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть частоту обновления микшера
+//-----------------------------------------------------------------------------
+int AListener::getRefresh() const
+{
+    return refresh_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Задать параметры устройства по умолчанию
+//-----------------------------------------------------------------------------
+void AListener::setDefaultConfig(const output_config_t &config)
+{
+    defaultConfig_ = config;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть запрошенные параметры контекста
+//-----------------------------------------------------------------------------
+output_config_t AListener::getConfig() const
+{
+    return config_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Изменить параметры работающего устройства
+//-----------------------------------------------------------------------------
+bool AListener::configure(const output_config_t &config)
+{
+    if (alcResetDeviceSOFT_ == nullptr || device_ == nullptr)
+        return false;
+
+    output_config_t previous = config_;
+    config_ = config;
+
+    QVector<ALCint> attributes = attributes_();
+
+    if (!alcResetDeviceSOFT_(device_, attributes.constData()))
+    {
+        config_ = previous;
+        return false;
+    }
+
+    alcGetIntegerv(device_, ALC_FREQUENCY, 1, &frequency_);
+    alcGetIntegerv(device_, ALC_REFRESH, 1, &refresh_);
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть количество моно-источников
+//-----------------------------------------------------------------------------
+int AListener::getMonoSources() const
+{
+    ALCint sources = 0;
+
+    if (device_ != nullptr)
+        alcGetIntegerv(device_, ALC_MONO_SOURCES, 1, &sources);
+
+    return sources;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть количество стерео-источников
+//-----------------------------------------------------------------------------
+int AListener::getStereoSources() const
+{
+    ALCint sources = 0;
+
+    if (device_ != nullptr)
+        alcGetIntegerv(device_, ALC_STEREO_SOURCES, 1, &sources);
+
+    return sources;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Включён ли HRTF
+//-----------------------------------------------------------------------------
+bool AListener::isHrtfEnabled() const
+{
+    ALCint hrtf = ALC_FALSE;
+
+    if (device_ != nullptr && alcIsExtensionPresent(device_, "ALC_SOFT_HRTF"))
+        alcGetIntegerv(device_, ALC_HRTF_SOFT, 1, &hrtf);
+
+    return hrtf != ALC_FALSE;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть задержку вывода устройства
+//-----------------------------------------------------------------------------
+double AListener::getLatency() const
+{
+    if (alcGetInteger64vSOFT_ == nullptr)
+        return -1.0;
+
+    ALCint64SOFT latency = 0;
+    alcGetInteger64vSOFT_(device_, ALC_DEVICE_LATENCY_SOFT, 1, &latency);
+
+    return 1.0e-9 * static_cast<double>(latency);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть часы устройства
+//-----------------------------------------------------------------------------
+qint64 AListener::getDeviceClock() const
+{
+    // Без вывода "микширование" идёт по часам расчёта
+    if (backend_ == BACKEND_NULL)
+        return static_cast<qint64>(1.0e9 * backendTime_());
+
+    if (alcGetInteger64vSOFT_ == nullptr)
+        return -1;
+
+    ALCint64SOFT clock = 0;
+    alcGetInteger64vSOFT_(device_, ALC_DEVICE_CLOCK_SOFT, 1, &clock);
+
+    return static_cast<qint64>(clock);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Список атрибутов контекста по параметрам
+//-----------------------------------------------------------------------------
+QVector<ALCint> AListener::attributes_() const
+{
+    QVector<ALCint> attributes;
+
+    if (config_.frequency > 0)
+        attributes << ALC_FREQUENCY << config_.frequency;
+
+    if (config_.refresh > 0)
+        attributes << ALC_REFRESH << config_.refresh;
+
+    if (config_.monoSources > 0)
+        attributes << ALC_MONO_SOURCES << config_.monoSources;
+
+    if (config_.stereoSources > 0)
+        attributes << ALC_STEREO_SOURCES << config_.stereoSources;
+
+    // Без ALC_SOFT_HRTF атрибут игнорируется
+    if (config_.hrtf >= 0)
+        attributes << ALC_HRTF_SOFT << (config_.hrtf > 0 ? ALC_TRUE : ALC_FALSE);
+
+    if (config_.auxSends > 0)
+        attributes << ALC_MAX_AUXILIARY_SENDS << config_.auxSends;
+
+    attributes << 0;
+
+    return attributes;
+}
+
+
+
+/// Изменённые параметры слушателя
+enum
+{
+    LSN_POSITION    = 0x01,
+    LSN_VELOCITY    = 0x02,
+    LSN_ORIENTATION = 0x04
+};
+
+//-----------------------------------------------------------------------------
+// Начать пакет изменений
+//-----------------------------------------------------------------------------
+void AListener::deferUpdates()
+{
+    if (deferDepth_++ > 0 || context_ == nullptr)
+        return;
+
+    makeCurrent();
+
+    if (alDeferUpdatesSOFT_ != nullptr && alProcessUpdatesSOFT_ != nullptr)
+        alDeferUpdatesSOFT_();
+    else
+        alcSuspendContext(context_);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Применить накопленный пакет изменений
+//-----------------------------------------------------------------------------
+void AListener::processUpdates()
+{
+    if (deferDepth_ == 0 || --deferDepth_ > 0 || context_ == nullptr)
+        return;
+
+    makeCurrent();
+
+    // Слушатель обновляется в том же пакете, что и источники
+    flushListener_();
+
+    if (alDeferUpdatesSOFT_ != nullptr && alProcessUpdatesSOFT_ != nullptr)
+        alProcessUpdatesSOFT_();
+    else
+        alcProcessContext(context_);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить положение слушателя
+//-----------------------------------------------------------------------------
+void AListener::setPosition(float x, float y, float z)
+{
+    const float position[3] = {x, y, z};
+
+    if (memcmp(listenerPosition_, position, sizeof(position)) == 0)
+        return;
+
+    memcpy(listenerPosition_, position, sizeof(position));
+    listenerDirty_ |= LSN_POSITION;
+
+    if (deferDepth_ == 0)
+        flushListener_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить "скорость передвижения" слушателя
+//-----------------------------------------------------------------------------
+void AListener::setVelocity(float x, float y, float z)
+{
+    const float velocity[3] = {x, y, z};
+
+    if (memcmp(listenerVelocity_, velocity, sizeof(velocity)) == 0)
+        return;
+
+    memcpy(listenerVelocity_, velocity, sizeof(velocity));
+    listenerDirty_ |= LSN_VELOCITY;
+
+    if (deferDepth_ == 0)
+        flushListener_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить направление слушателя
+//-----------------------------------------------------------------------------
+void AListener::setOrientation(const float orientation[6])
+{
+    if (memcmp(listenerOrientation_, orientation, 6 * sizeof(float)) == 0)
+        return;
+
+    memcpy(listenerOrientation_, orientation, 6 * sizeof(float));
+    listenerDirty_ |= LSN_ORIENTATION;
+
+    if (deferDepth_ == 0)
+        flushListener_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить положение, направление и "скорость передвижения" слушателя
+//-----------------------------------------------------------------------------
+void AListener::setPose(const float position[3], const float orientation[6],
+                        const float velocity[3])
+{
+    deferUpdates();
+
+    setPosition(position[0], position[1], position[2]);
+    setOrientation(orientation);
+
+    if (velocity != Q_NULLPTR)
+        setVelocity(velocity[0], velocity[1], velocity[2]);
+
+    processUpdates();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Переместить слушателя, вычислив "скорость передвижения"
+//-----------------------------------------------------------------------------
+void AListener::movePose(const float position[3], const float orientation[6], float dt)
+{
+    if (dt <= 0.0f)
+    {
+        setPose(position, orientation);
+        return;
+    }
+
+    float velocity[3];
+
+    for (int i = 0; i < 3; ++i)
+        velocity[i] = (position[i] - listenerPosition_[i]) / dt;
+
+    setPose(position, orientation, velocity);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть положение слушателя
+//-----------------------------------------------------------------------------
+void AListener::getPosition(float &x, float &y, float &z) const
+{
+    x = listenerPosition_[0];
+    y = listenerPosition_[1];
+    z = listenerPosition_[2];
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть "скорость передвижения" слушателя
+//-----------------------------------------------------------------------------
+void AListener::getVelocity(float &x, float &y, float &z) const
+{
+    x = listenerVelocity_[0];
+    y = listenerVelocity_[1];
+    z = listenerVelocity_[2];
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть направление слушателя
+//-----------------------------------------------------------------------------
+void AListener::getOrientation(float orientation[6]) const
+{
+    memcpy(orientation, listenerOrientation_, 6 * sizeof(float));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Передать в OpenAL изменённые параметры слушателя
+//-----------------------------------------------------------------------------
+void AListener::flushListener_()
+{
+    if (listenerDirty_ == 0)
+        return;
+
+    makeCurrent();
+
+    if (listenerDirty_ & LSN_POSITION)
+        alListenerfv(AL_POSITION, listenerPosition_);
+
+    if (listenerDirty_ & LSN_VELOCITY)
+        alListenerfv(AL_VELOCITY, listenerVelocity_);
+
+    if (listenerDirty_ & LSN_ORIENTATION)
+        alListenerfv(AL_ORIENTATION, listenerOrientation_);
+
+    listenerDirty_ = 0;
+}
+
+
+
+
+// ****************************************************************************
+// *                            Класс ASound                                  *
+// ****************************************************************************
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР
+//-----------------------------------------------------------------------------
+ASound::ASound(QString soundname, QObject *parent, int loadFlags, AListener *output): QObject(parent),
+    listener_(output != Q_NULLPTR ? output : &AListener::getInstance()),
+    canDo_(false),              // Сбрасываем флаг
+    canPlay_(false),            // Сбрасываем флаг
+    loadFlags_(loadFlags | AListener::getInstance().getDefaultLoadFlags()),
+    soundName_(soundname),      // Сохраняем название звука
+    source_(0),                 // Обнуляем источник
+    format_(0),                 // Обнуляем формат
+    sourceGain_(0.01f * DEF_SRC_VOLUME),  // Громкость по умолч.
+    sourcePitch_(DEF_SRC_PITCH),    // Скорость воспроизведения по умолч.
+    sourceLoop_(false)         // Зацикливание по-умолч.
+{ 
+    init_();
+
+    emit notify("T Load sound: " + soundname.toStdString());
+
+    // Загружаем звук
+    loadSound_(soundname);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР (из банка звуков)
+//-----------------------------------------------------------------------------
+ASound::ASound(ASoundBank *bank, QString soundname, QObject *parent, int loadFlags,
+               AListener *output): QObject(parent),
+    listener_(output != Q_NULLPTR ? output : &AListener::getInstance()),
+    canDo_(false),              // Сбрасываем флаг
+    canPlay_(false),            // Сбрасываем флаг
+    loadFlags_(loadFlags | AListener::getInstance().getDefaultLoadFlags()),
+    soundName_(soundname),      // Сохраняем название звука
+    source_(0),                 // Обнуляем источник
+    format_(0),                 // Обнуляем формат
+    sourceGain_(0.01f * DEF_SRC_VOLUME),  // Громкость по умолч.
+    sourcePitch_(DEF_SRC_PITCH),    // Скорость воспроизведения по умолч.
+    sourceLoop_(false)         // Зацикливание по-умолч.
+{
+    init_();
+
+    emit notify("T Load sound from bank: " + soundname.toStdString());
+
+    if (bank != nullptr)
+        data_ = bank->getSound(soundname);
+
+    if (data_.isNull())
+    {
+        setLastError("NO_SUCH_SOUND_IN_BANK: " + soundname.toStdString());
+        lastError_ = "NO_SUCH_SOUND_IN_BANK: ";
+        lastError_.append(soundname);
+        return;
+    }
+
+    // Сводим в моно и/или ресемплируем согласно флагам загрузки (в пул
+    // хранилища, если он задан)
+    data_ = AWaveReader::process(data_, loadFlags_,
+                                 static_cast<uint32_t>(listener_->getFrequency()),
+                                 ASoundStore::getInstance().getArena());
+
+    setupSound_(bank);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// КОНСТРУКТОР (источник генератора звука)
+//-----------------------------------------------------------------------------
+ASound::ASound(QObject *parent, AListener *output): QObject(parent),
+    listener_(output != Q_NULLPTR ? output : &AListener::getInstance()),
+    canDo_(false),              // Сбрасываем флаг
+    canPlay_(false),            // Сбрасываем флаг
+    loadFlags_(LOAD_DEFAULT),
+    source_(0),                 // Обнуляем источник
+    format_(0),                 // Обнуляем формат
+    sourceGain_(0.01f * DEF_SRC_VOLUME),  // Громкость по умолч.
+    sourcePitch_(DEF_SRC_PITCH),    // Скорость воспроизведения по умолч.
+    sourceLoop_(false)         // Зацикливание по-умолч.
+{
+    init_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// ДЕСТРУКТОР
+//-----------------------------------------------------------------------------
+ASound::~ASound()
+{
+    // Покидаем группу
+    if (group_ != Q_NULLPTR)
+        group_->removeSound_(this);
+
+    // Прекращаем плавные изменения
+    ASoundRamper::getInstance().remove(this);
+
+    // Покидаем зоны окружения
+    if (zone_ != Q_NULLPTR)
+        zone_->sounds_.removeOne(this);
+
+    if (prevZone_ != Q_NULLPTR)
+        prevZone_->sounds_.removeOne(this);
+
+    // Выходим из-под управления детализацией (варианты могли пропасть при
+    // перезагрузке, а звук - остаться в списке)
+    ASoundLodManager::getInstance().remove(this);
+
+    // Восстанавливать после потери устройства больше нечего
+    ASoundDeviceMonitor::getInstance().remove(this);
+
+    // Файл звука больше не отслеживается
+    if (!data_.isNull())
+        ASoundReloader::getInstance().remove(this);
+
+    select_();
+
+    // Удаляем источник
+    if (source_ != 0)
+        alDeleteSources(1, &source_);
+
+    // Удаляем буфер (общие - с последним источником)
+    if (lods_.isEmpty())
+    {
+        if (data_.isNull())
+            alDeleteBuffers(BUFFER_BLOCKS, buffer_);
+        else
+            listener_->releaseBuffers_(buffer_, BUFFER_BLOCKS);
+    }
+    else
+    {
+        for (const lod_variant_t &lod : lods_)
+            listener_->releaseBuffers_(lod.buffer, BUFFER_BLOCKS);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Общая инициализация конструкторов
+//-----------------------------------------------------------------------------
+void ASound::init_()
+{
+    canLABL_ = false;
+    timerStartKiller_ = Q_NULLPTR;
+    group_ = Q_NULLPTR;
+    priority_ = 0;
+    currentLod_ = 0;
+    pendingLod_ = -1;
+    queuedLod_ = -1;
+    lodChained_ = false;
+    timerLodBoundary_ = Q_NULLPTR;
+    savedState_ = AL_INITIAL;
+    savedOffset_ = 0;
+    savedAt_ = 0;
+    streamRate_ = 0;
+    streamCallback_ = nullptr;
+    streamUser_ = nullptr;
+    zone_ = Q_NULLPTR;
+    prevZone_ = Q_NULLPTR;
+    zoneMix_ = 1.0f;
+    occlusion_ = 0.0f;
+    occlusionLevel_ = -1;
+    normGain_ = 1.0f;
+    stub_ = AListener::getBackend() == BACKEND_NULL;
+    stubState_ = AL_INITIAL;
+    stubFrames_ = 0.0;
+    stubAt_ = 0.0;
+    stubPitch_ = DEF_SRC_PITCH;
+    stubLooping_ = false;
+
+    // Инициализируем позицию источника
+    memcpy(sourcePosition_, DEF_SRC_POS, 3 * sizeof(float));
+    // Инициализируем вектор "скорости передвижения" источника
+    memcpy(sourceVelocity_, DEF_SRC_VEL, 3 * sizeof(float));
+
+    // Зануляем все буферы
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        buffer_[i] = 0;
+    }
+
+    connect(this, &ASound::notify, AListener::getInstance().log_, &LogFileHandler::notify);
+    connect(this, &ASound::lastErrorChanged_, AListener::getInstance().log_, &LogFileHandler::notify);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Сделать текущим контекст устройства звука
+//-----------------------------------------------------------------------------
+void ASound::select_()
+{
+    listener_->makeCurrent();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Полная подготовка файла
+//-----------------------------------------------------------------------------
+void ASound::loadSound_(QString soundname)
+{
+    // Сбрасываем флаги
+    canDo_ = false;
+    canPlay_ = false;
+    canLABL_ = false;
+
+    // Сохраняем название звука
+    soundName_ = soundname;
+
+    // Берём из хранилища (общие с другими источниками или предзагруженные
+    // данные) либо читаем, разбираем и обрабатываем по флагам загрузки
+    QString error;
+    data_ = ASoundStore::getInstance().load(soundname, loadFlags_,
+                                            static_cast<uint32_t>(listener_->getFrequency()),
+                                            error);
+
+    if (data_.isNull())
+    {
+        setLastError(error.toStdString());
+        lastError_ = error;
+        return;
+    }
+
+    setupSound_();
+
+    // Изменения файла подхватываются без перезапуска (без вывода
+    // перезагружать нечего)
+    if (canPlay_ && !stub_)
+        ASoundReloader::getInstance().add(this);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Подготовка источника по загруженным данным
+//-----------------------------------------------------------------------------
+void ASound::setupSound_(ASoundBank *bank)
+{
+    canDo_ = true;
+
+    // Буферы и источник создаются в контексте устройства звука
+    select_();
+
+    canLABL_ = !data_->labels.isEmpty();
+
+    updateNormGain_();
+
+    logSoundInfo_();
+
+    // Определяем формат аудио (mono8/16 - stereo8/16) OpenAL
+    defineFormat_();
+
+    // Без вывода хватает разметки: буферов и источника нет
+    if (stub_)
+    {
+        canPlay_ = canDo_;
+        stubPitch_ = effectivePitch_();
+        return;
+    }
+
+    // Блок длиннее ASOUND_MAX_BLOCK буфер OpenAL не примет - отказываем
+    // явно, а не обрезаем звук при приведении размера к ALsizei
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        if (data_->blockSize[i] > ASOUND_MAX_BLOCK)
+        {
+            canDo_ = false;
+            lastError_ = "BLOCK_TOO_LARGE: ";
+            lastError_.append(soundName_);
+            setLastError(lastError_.toStdString());
+            return;
+        }
+    }
+
+    // Генерируем буфер и источник
+    generateStuff_();
+
+    // Настраиваем источник
+    configureSource_();
+
+    // Можно играть звук
+    if (canDo_)
+    {
+        canPlay_ = true;
+    }
+
+    // Упрощённые варианты для дальних источников
+    if (canPlay_ && (loadFlags_ & LOAD_LOD))
+        buildLods_(bank);
+
+    // Восстановление после потери устройства
+    if (canPlay_)
+        ASoundDeviceMonitor::getInstance().add(this);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Создать источник генератора звука
+//-----------------------------------------------------------------------------
+bool ASound::setupStream_(ALenum format, ALsizei rate,
+                          ALBUFFERCALLBACKTYPESOFT callback, void *userptr)
+{
+    // Без вывода микшер к генератору не обращается
+    if (stub_)
+    {
+        format_ = format;
+        streamRate_ = rate;
+        canDo_ = true;
+        canPlay_ = true;
+        stubPitch_ = effectivePitch_();
+        return true;
+    }
+
+    if (listener_->alBufferCallbackSOFT_ == nullptr)
+    {
+        setLastError("CALLBACK_BUFFER_NOT_SUPPORTED");
+        lastError_ = "CALLBACK_BUFFER_NOT_SUPPORTED";
+        return false;
+    }
+
+    select_();
+
+    format_ = format;
+    streamRate_ = rate;
+    streamCallback_ = callback;
+    streamUser_ = userptr;
+
+    canDo_ = true;
+
+    // Генерируем буфер и источник
+    generateStuff_();
+
+    // Настраиваем источник
+    configureSource_();
+
+    canPlay_ = canDo_;
+
+    if (!canPlay_)
+    {
+        setLastError(lastError_.toStdString());
+        return false;
+    }
+
+    // Восстановление после потери устройства
+    ASoundDeviceMonitor::getInstance().add(this);
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Удалить источник генератора
+//-----------------------------------------------------------------------------
+void ASound::releaseStream_()
+{
+    ASoundDeviceMonitor::getInstance().remove(this);
+
+    if (stub_)
+    {
+        stubState_ = AL_STOPPED;
+        canPlay_ = false;
+    }
+
+    if (source_ == 0)
+        return;
+
+    select_();
+
+    // Удаление источника останавливает его - микшер больше не обратится
+    // к данным генератора
+    alSourceStop(source_);
+    alDeleteSources(1, &source_);
+
+    source_ = 0;
+    canPlay_ = false;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вывод в журнал информации о загруженных данных
+//-----------------------------------------------------------------------------
+void ASound::logSoundInfo_()
+{
+    emit notify("| - File data size: " + QString::number(data_->dataSize).toStdString());
+    emit notify("| - Byterate: " + QString::number(data_->info.byteRate).toStdString());
+    emit notify("| - Sample rate: " + QString::number(data_->info.sampleRate).toStdString());
+    emit notify("| - Num channels: " + QString::number(data_->info.numChannels).toStdString());
+    emit notify("| - Bits per sample: " + QString::number(data_->info.bitsPerSample).toStdString());
+    emit notify("| - Bytes per sample: " + QString::number(data_->info.bytesPerSample).toStdString());
+    emit notify("| - Buffer blocks: " + QString::number(data_->blocksCount).toStdString());
+
+    // Метки и области цикла в маркерах Wave64 не поддерживаются
+    if (data_->markersDropped)
+        emit notify("E - W64_MARKERS_NOT_SUPPORTED: " + soundName_.toStdString());
+
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        emit notify("| - Block #" + QString::number(i).toStdString() +
+                    " size: " + QString::number(data_->blockSize[i]).toStdString());
+    }
+
+    const sound_analysis_t &analysis = data_->analysis;
+
+    if (analysis.valid)
+    {
+        emit notify("| - Peak: " + QString::number(analysis.total.peak).toStdString() +
+                    " RMS: " + QString::number(analysis.total.rms).toStdString() +
+                    " Loudness: " + QString::number(analysis.total.loudness).toStdString() + " LUFS");
+
+        if (normGain_ != 1.0f)
+            emit notify("| - Normalization gain: " + QString::number(normGain_).toStdString());
+
+        if (canLABL_)
+        {
+            emit notify("| - Loop seam: " + QString::number(analysis.loopSeam).toStdString());
+
+            // Заметный разрыв на стыке цикла слышен щелчком
+            if (analysis.loopSeam > LOOP_SEAM_WARNING)
+                emit notify("E - LOOP_SEAM_DISCONTINUITY: " + soundName_.toStdString());
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Определение формата аудио (mono8/16 - stereo8/16)
+//-----------------------------------------------------------------------------
+void ASound::defineFormat_()
+{
+    if (canDo_)
+    {
+        format_ = alFormat_(data_->info);
+
+        if (format_ == 0)                       // Если все плохо
+        {
+            setLastError("UNKNOWN_AUDIO_FORMAT");
+            lastError_ = "UNKNOWN_AUDIO_FORMAT";
+            canDo_ = false;
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Формат OpenAL для формата данных
+//-----------------------------------------------------------------------------
+ALenum ASound::alFormat_(const wave_info_fmt_t &info)
+{
+    if (info.bitsPerSample == 8)            // Если бит в сэмпле 8
+    {
+        if (info.numChannels == 1)          // Если 1 канал
+            return AL_FORMAT_MONO8;
+        else                                // Если 2 канала
+            return AL_FORMAT_STEREO8;
+    }
+    else if (info.bitsPerSample == 16)      // Если бит в сэмпле 16
+    {
+        if (info.numChannels == 1)          // Если 1 канал
+            return AL_FORMAT_MONO16;
+        else                                // Если 2 канала
+            return AL_FORMAT_STEREO16;
+    }
+
+    return 0;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Генерация буфера и источника
+//-----------------------------------------------------------------------------
+void ASound::generateStuff_()
+{
+    if (canDo_)
+    {
+        // Генерируем буфер генератора (буферы звука из файла - общие,
+        // берутся ниже)
+        if (data_.isNull())
+            alGenBuffers(BUFFER_BLOCKS, buffer_);
+
+        if (alGetError() != AL_NO_ERROR)
+        {
+            canDo_ = false;
+            lastError_ = "CANT_GENERATE_BUFFER";
+            return;
+        }
+
+        // Генерируем источник
+        alGenSources(1, &source_);
+
+        if (alGetError() != AL_NO_ERROR)
+        {
+            canDo_ = false;
+            lastError_ = "CANT_GENERATE_SOURCE";
+            return;
+        }
+
+        // Настраиваем буфер
+        if (data_.isNull())
+        {
+            // Генератор: буфер наполняет микшер через обратный вызов
+            listener_->alBufferCallbackSOFT_(buffer_[0], format_, streamRate_,
+                                             streamCallback_, streamUser_);
+        }
+        else
+        {
+            // Одинаковые PCM данные других источников уже загружены
+            for (int i = 0; i < BUFFER_BLOCKS; ++i)
+            {
+                buffer_[i] = listener_->acquireBuffer_(data_->block[i], data_->blockSize[i], format_,
+                                                       static_cast<ALsizei>(data_->info.sampleRate));
+
+                if (buffer_[i] == 0)
+                {
+                    listener_->releaseBuffers_(buffer_, i);
+                    memset(buffer_, 0, sizeof(buffer_));
+                    canDo_ = false;
+                    lastError_ = "CANT_MAKE_BUFFER_DATA";
+                    return;
+                }
+            }
+        }
+
+        if (alGetError() != AL_NO_ERROR)
+        {
+            canDo_ = false;
+            lastError_ = "CANT_MAKE_BUFFER_DATA";
+            return;
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Настройка источника
+//-----------------------------------------------------------------------------
+void ASound::configureSource_()
+{
+    if (canDo_)
+    {
+        // Передаём источнику буфер
+        if (data_.isNull())
+            alSourcei(source_, AL_BUFFER, static_cast<ALint>(buffer_[0]));
+        else
+            alSourceQueueBuffers(source_, BUFFER_BLOCKS, buffer_);
+
+        if (alGetError() != AL_NO_ERROR)
+        {
+            canDo_ = false;
+            lastError_ = "CANT_ADD_BUFFER_TO_SOURCE";
+            return;
+        }
+
+        // Выравнивание громкости может поднимать звук выше 1.0
+        alSourcef(source_, AL_MAX_GAIN, qMax(1.0f, normGain_));
+
+        // Устанавливаем громкость
+        alSourcef(source_, AL_GAIN, effectiveGain_());
+
+        if (alGetError() != AL_NO_ERROR)
+        {
+            canDo_ = false;
+            lastError_ = "CANT_APPLY_VOLUME";
+            return;
+        }
+
+        // Устанавливаем скорость воспроизведения
+        alSourcef(source_, AL_PITCH, effectivePitch_());
+
+        if (alGetError() != AL_NO_ERROR)
+        {
+            canDo_ = false;
+            lastError_ = "CANT_APPLY_PITCH";
+            return;
+        }
+
+        // Устанавливаем зацикливание
+        alSourcei(source_, AL_LOOPING, static_cast<char>(sourceLoop_));
+
+        if (alGetError() != AL_NO_ERROR)
+        {
+            canDo_ = false;
+            lastError_ = "CANT_APPLY_LOOPING";
+            return;
+        }
+
+        // Устанавливаем положение
+        alSourcefv(source_, AL_POSITION, sourcePosition_);
+
+        if (alGetError() != AL_NO_ERROR)
+        {
+            canDo_ = false;
+            lastError_ = "CANT_APPLY_POSITION";
+            return;
+        }
+
+        // Устанавливаем вектор "скорости передвижения"
+        alSourcefv(source_, AL_VELOCITY, sourceVelocity_);
+
+        if (alGetError() != AL_NO_ERROR)
+        {
+            canDo_ = false;
+            lastError_ = "CANT_APPLY_VELOCITY";
+            return;
+        }
+
+        // Фильтр заглушения (без EFX звук остаётся незаглушённым)
+        occlusionLevel_ = -1;
+        applyOcclusion_();
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Длительность звука, мс
+//-----------------------------------------------------------------------------
+int ASound::getDuration()
+{
+    return qRound(1000.0 * getDurationSeconds());
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Длительность звука, сэмплов
+//-----------------------------------------------------------------------------
+qint64 ASound::getDurationFrames()
+{
+    if (!canDo_ || data_.isNull())
+        return 0;
+
+    // В сэмплах исходного звука, как и getPcm(), при любом уровне детализации
+    QSharedPointer<ASoundData> data = baseData_();
+
+    return static_cast<qint64>(data->dataSize / static_cast<uint64_t>(qMax<short>(1, data->info.bytesPerSample)));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Длительность звука, с
+//-----------------------------------------------------------------------------
+double ASound::getDurationSeconds()
+{
+    if (!canDo_ || data_.isNull() || data_->info.sampleRate == 0)
+        return 0.0;
+
+    return static_cast<double>(getDurationFrames()) / data_->info.sampleRate;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Позиция воспроизведения, сэмплов
+//-----------------------------------------------------------------------------
+qint64 ASound::getPositionFrames()
+{
+    if (!canPlay_ || data_.isNull() || data_->info.sampleRate == 0)
+        return 0;
+
+    // Звучащий уровень детализации может иметь свою частоту - переводим
+    // позицию в сэмплы исходного звука
+    double scale = static_cast<double>(baseData_()->info.sampleRate) / data_->info.sampleRate;
+
+    return static_cast<qint64>(playbackFrames_() * scale);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Позиция воспроизведения, с
+//-----------------------------------------------------------------------------
+double ASound::getPositionSeconds()
+{
+    if (!canPlay_ || data_.isNull() || data_->info.sampleRate == 0)
+        return 0.0;
+
+    return playbackFrames_() / data_->info.sampleRate;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Позиция воспроизведения и часы устройства
+//-----------------------------------------------------------------------------
+bool ASound::getPositionClock(double &seconds, qint64 &clock)
+{
+    seconds = 0.0;
+    clock = 0;
+
+    if (!canPlay_ || data_.isNull() || listener_->alGetSourcei64vSOFT_ == nullptr ||
+            listener_->alcGetInteger64vSOFT_ == nullptr || data_->info.sampleRate == 0)
+    {
+        return false;
+    }
+
+    select_();
+
+    // Позиция в формате 32.32 и часы устройства, нс
+    ALint64SOFT values[2] = {0, 0};
+    listener_->alGetSourcei64vSOFT_(source_, AL_SAMPLE_OFFSET_CLOCK_SOFT, values);
+
+    seconds = static_cast<double>(values[0]) / 4294967296.0 / data_->info.sampleRate;
+    clock = static_cast<qint64>(values[1]);
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить громкость
+//-----------------------------------------------------------------------------
+void ASound::setVolume(int volume)
+{
+    setGain(0.01f * qBound(MIN_SRC_VOLUME, volume, MAX_SRC_VOLUME));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть громкость
+//-----------------------------------------------------------------------------
+int ASound::getVolume()
+{
+    return qRound(100.0f * sourceGain_);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить громкость (0.0 - 1.0)
+//-----------------------------------------------------------------------------
+void ASound::setGain(float gain)
+{
+    if (canPlay_)
+    {
+        select_();
+
+        gainRamp_.stop();
+        sourceGain_ = qBound(0.0f, gain, 1.0f);
+        alSourcef(source_, AL_GAIN, effectiveGain_());
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть громкость (0.0 - 1.0)
+//-----------------------------------------------------------------------------
+float ASound::getGain()
+{
+    return sourceGain_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть усиление выравнивания громкости
+//-----------------------------------------------------------------------------
+float ASound::getNormalizationGain()
+{
+    return normGain_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть результаты анализа данных звука
+//-----------------------------------------------------------------------------
+sound_analysis_t ASound::getAnalysis()
+{
+    if (data_.isNull())
+        return sound_analysis_t();
+
+    return data_->analysis;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть PCM данные звука только для чтения
+//-----------------------------------------------------------------------------
+sound_pcm_span_t ASound::getPcm(int block)
+{
+    QSharedPointer<ASoundData> data = baseData_();
+
+    if (data.isNull())
+        return sound_pcm_span_t();
+
+    return data->span(block);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть огибающую низких частот
+//-----------------------------------------------------------------------------
+QVector<float> ASound::getEnvelope()
+{
+    QSharedPointer<ASoundData> data = baseData_();
+
+    if (data.isNull())
+        return QVector<float>();
+
+    return data->envelope;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть частоту отсчётов огибающей низких частот
+//-----------------------------------------------------------------------------
+float ASound::getEnvelopeRate()
+{
+    QSharedPointer<ASoundData> data = baseData_();
+
+    if (data.isNull() || data->envelopeStep == 0)
+        return 0.0f;
+
+    return static_cast<float>(data->info.sampleRate) / data->envelopeStep;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить скорость воспроизведения
+//-----------------------------------------------------------------------------
+void ASound::setPitch(float pitch)
+{
+    if (canPlay_)
+    {
+        select_();
+
+        pitchRamp_.stop();
+        sourcePitch_ = pitch;
+        applyPitch_();
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть скорость воспроизведения
+//-----------------------------------------------------------------------------
+float ASound::getPitch()
+{
+    return sourcePitch_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Плавно изменить громкость
+//-----------------------------------------------------------------------------
+void ASound::rampGain(float target, int ms, int curve)
+{
+    target = qBound(0.0f, target, 1.0f);
+
+    if (ms <= 0)
+    {
+        setGain(target);
+        return;
+    }
+
+    if (canPlay_)
+    {
+        ASoundRamper &ramper = ASoundRamper::getInstance();
+        gainRamp_.start(sourceGain_, target, ramper.now(), ms, curve);
+        ramper.add(this);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Плавно изменить громкость (0 - 100)
+//-----------------------------------------------------------------------------
+void ASound::rampVolume(int target, int ms, int curve)
+{
+    rampGain(0.01f * qBound(MIN_SRC_VOLUME, target, MAX_SRC_VOLUME), ms, curve);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Плавно изменить скорость воспроизведения
+//-----------------------------------------------------------------------------
+void ASound::rampPitch(float target, int ms, int curve)
+{
+    if (ms <= 0)
+    {
+        setPitch(target);
+        return;
+    }
+
+    if (canPlay_)
+    {
+        ASoundRamper &ramper = ASoundRamper::getInstance();
+        pitchRamp_.start(sourcePitch_, target, ramper.now(), ms, curve);
+        ramper.add(this);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить зацикливание
+//-----------------------------------------------------------------------------
+void ASound::setLoop(bool loop)
+{
+    if (canPlay_)
+    {
+        select_();
+
+        // Пройденный отрезок досчитываем с прежним зацикливанием
+        if (stub_)
+            stubAdvance_();
+
+        // Отложенный до конца прохода переход зависит от зацикливания
+        cancelLod_();
+
+        sourceLoop_ = loop;
+        alSourcei(source_, AL_LOOPING, static_cast<char>(sourceLoop_));
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить заглушение прямого пути
+//-----------------------------------------------------------------------------
+void ASound::setOcclusion(float occlusion)
+{
+    occlusion_ = qBound(0.0f, occlusion, 1.0f);
+
+    if (canPlay_)
+        applyOcclusion_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Перевести звук в зону окружения
+//-----------------------------------------------------------------------------
+void ASound::setZone(ASoundZone *zone, int ms)
+{
+    if (!canPlay_ || zone == zone_)
+        return;
+
+    // Возврат в покидаемую зону продолжается с текущей доли её посыла
+    ASoundZone* dropped = prevZone_;
+    float from = (zone == dropped) ? 1.0f - zoneMix_ : 0.0f;
+
+    prevZone_ = zone_;
+    zone_ = zone;
+
+    // Зона, прерванная новым переходом, глохнет сразу
+    if (dropped != Q_NULLPTR && dropped != zone_)
+        dropped->sounds_.removeOne(this);
+
+    if (zone_ != Q_NULLPTR && !zone_->sounds_.contains(this))
+        zone_->sounds_.append(this);
+
+    if (ms <= 0 || prevZone_ == zone_)
+    {
+        if (prevZone_ != Q_NULLPTR && prevZone_ != zone_)
+            prevZone_->sounds_.removeOne(this);
+
+        prevZone_ = Q_NULLPTR;
+        zoneMix_ = 1.0f;
+        zoneRamp_.stop();
+    }
+    else
+    {
+        ASoundRamper &ramper = ASoundRamper::getInstance();
+        zoneMix_ = from;
+        zoneRamp_.start(from, 1.0f, ramper.now(), ms, RAMP_SMOOTH);
+        ramper.add(this);
+    }
+
+    applyZoneSends_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть зацикливание
+//-----------------------------------------------------------------------------
+bool ASound::getLoop()
+{
+    return sourceLoop_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить положение
+//-----------------------------------------------------------------------------
+void ASound::setPosition(float x, float y, float z)
+{
+    if (canPlay_)
+    {
+        select_();
+
+        sourcePosition_[0] = x;
+        sourcePosition_[1] = y;
+        sourcePosition_[2] = z;
+        alSourcefv(source_, AL_POSITION, sourcePosition_);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть положение
+//-----------------------------------------------------------------------------
+void ASound::getPosition(float &x, float &y, float &z)
+{
+    x = sourcePosition_[0];
+    y = sourcePosition_[1];
+    z = sourcePosition_[2];
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Установить вектор "скорости передвижения"
+//-----------------------------------------------------------------------------
+void ASound::setVelocity(float x, float y, float z)
+{
+    if (canPlay_)
+    {
+        select_();
+
+        sourceVelocity_[0] = x;
+        sourceVelocity_[1] = y;
+        sourceVelocity_[2] = z;
+        alSourcefv(source_, AL_VELOCITY, sourceVelocity_);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть вектор "скорости перемещения"
+//-----------------------------------------------------------------------------
+void ASound::getVelocity(float &x, float &y, float &z)
+{
+    x = sourceVelocity_[0];
+    y = sourceVelocity_[1];
+    z = sourceVelocity_[2];
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Играть звук
+//-----------------------------------------------------------------------------
+void ASound::play()
+{
+    select_();
+
+    if (!isPlaying())
+    {
+        if (canPlay_)
         {
-            canDo_ = false;
-            lastError_ = "CANT_GENERATE_BUFFER";
-            return;
+            if (canLABL_ && stub_)
+            {
+                // Переход на начало цикла рассчитывается без таймера
+                stubLooping_ = true;
+            }
+            else if (canLABL_)
+            {
+                timerStartKiller_ = new QTimer(this);
+                connect(timerStartKiller_, SIGNAL(timeout()),
+                        this, SLOT(onTimerStartKiller()));
+                timerStartKiller_->setInterval(15);
+                timerStartKiller_->start();
+            }
+
+            // Группа на паузе - звук запустится при её снятии
+            if (group_ != Q_NULLPTR && group_->isEffectivePaused())
+                group_->holdSource_(this);
+            else
+                setSourceState_(AL_PLAYING);
+        }
+    }
+    else
+    {
+        setSourceState_(AL_PLAYING);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Приостановить звук
+//-----------------------------------------------------------------------------
+void ASound::pause()
+{
+    if (canPlay_)
+    {
+        select_();
+
+        // Отменяем запуск, отложенный паузой группы
+        if (group_ != Q_NULLPTR)
+            group_->releaseSource_(this);
+
+        setSourceState_(AL_PAUSED);
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// (слот) Остановить звук
+//-----------------------------------------------------------------------------
+void ASound::stop()
+{
+    if (canPlay_)
+    {
+        select_();
+
+        // Если у файла есть метки
+        if (canLABL_)
+        {
+            setLoop(false);
+
+            if (stub_)
+            {
+                // Переходим на блок звука остановки по метке
+                stubLooping_ = false;
+                stubFrames_ = static_cast<double>(data_->blockSize[0] + data_->blockSize[1]) /
+                        qMax<short>(1, data_->info.bytesPerSample);
+            }
+            else
+            {
+                // Задаём смещение на блок звука остановки по метке
+                alSourcei(source_, AL_BYTE_OFFSET,
+                          static_cast<ALint>(data_->blockSize[0] + data_->blockSize[1]));
+            }
+
+            if (timerStartKiller_ != Q_NULLPTR)
+                if (timerStartKiller_->isActive())
+                    timerStartKiller_->stop();
+        }
+        else
+        {
+            if (group_ != Q_NULLPTR)
+                group_->releaseSource_(this);
+
+            setSourceState_(AL_STOPPED);
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть устройство вывода звука
+//-----------------------------------------------------------------------------
+AListener *ASound::getOutput() const
+{
+    return listener_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть задержку до выхода звука из устройства
+//-----------------------------------------------------------------------------
+double ASound::getLatency()
+{
+    if (!canPlay_ || listener_->alGetSourcedvSOFT_ == nullptr)
+        return -1.0;
+
+    select_();
+
+    // Позиция воспроизведения и задержка вывода, с
+    ALdouble values[2] = {0.0, 0.0};
+    listener_->alGetSourcedvSOFT_(source_, AL_SEC_OFFSET_LATENCY_SOFT, values);
+
+    return values[1];
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть зону окружения звука
+//-----------------------------------------------------------------------------
+ASoundZone *ASound::getZone() const
+{
+    return zone_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть заглушение прямого пути
+//-----------------------------------------------------------------------------
+float ASound::getOcclusion() const
+{
+    return occlusion_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Отнести звуки к зонам по их положению
+//-----------------------------------------------------------------------------
+void ASound::assignZones(ASound * const *sounds, int count, int ms)
+{
+    AListener::deferAllUpdates();
+
+    for (int i = 0; i < count; ++i)
+    {
+        ASound* sound = sounds[i];
+
+        sound->setZone(ASoundZone::find(sound->sourcePosition_[0],
+                                        sound->sourcePosition_[1],
+                                        sound->sourcePosition_[2]), ms);
+    }
+
+    AListener::processAllUpdates();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Включить звук в группу
+//-----------------------------------------------------------------------------
+void ASound::setGroup(ASoundGroup *group)
+{
+    select_();
+
+    if (group_ == group)
+        return;
+
+    // Запуск, отложенный паузой прежней группы
+    bool held = false;
+
+    if (group_ != Q_NULLPTR)
+        held = group_->removeSound_(this);
+
+    group_ = group;
+
+    if (group_ != Q_NULLPTR)
+        group_->addSound_(this);
+
+    bool paused = group_ != Q_NULLPTR && group_->isEffectivePaused();
+
+    if (paused && canPlay_ && isPlaying())
+    {
+        // Новая группа на паузе - приостанавливаем вместе с ней
+        setSourceState_(AL_PAUSED);
+        group_->holdSource_(this);
+    }
+    else if (held)
+    {
+        if (paused)
+            group_->holdSource_(this);
+        else
+            setSourceState_(AL_PLAYING);
+    }
+
+    if (canPlay_)
+    {
+        alSourcef(source_, AL_GAIN, effectiveGain_());
+        applyPitch_();
+        applyOcclusion_();
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть группу звука
+//-----------------------------------------------------------------------------
+ASoundGroup *ASound::getGroup() const
+{
+    return group_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Обновить параметры множества звуков за один проход
+//-----------------------------------------------------------------------------
+int ASound::updateMany(ASound * const *sounds, int count,
+                       const float *positions, const float *velocities,
+                       const float *gains, const float *pitches,
+                       const float *occlusions)
+{
+    int changed = 0;
+
+    AListener::deferAllUpdates();
+
+    for (int i = 0; i < count; ++i)
+    {
+        ASound* sound = sounds[i];
+
+        if (sound == Q_NULLPTR || !sound->canPlay_)
+            continue;
+
+        // Звуки могут принадлежать разным устройствам
+        sound->select_();
+
+        bool dirty = false;
+
+        if (positions != Q_NULLPTR)
+        {
+            const float* pos = positions + 3 * i;
+
+            if (pos[0] != sound->sourcePosition_[0] ||
+                pos[1] != sound->sourcePosition_[1] ||
+                pos[2] != sound->sourcePosition_[2])
+            {
+                memcpy(sound->sourcePosition_, pos, 3 * sizeof(float));
+                alSourcefv(sound->source_, AL_POSITION, sound->sourcePosition_);
+                dirty = true;
+            }
+        }
+
+        if (velocities != Q_NULLPTR)
+        {
+            const float* vel = velocities + 3 * i;
+
+            if (vel[0] != sound->sourceVelocity_[0] ||
+                vel[1] != sound->sourceVelocity_[1] ||
+                vel[2] != sound->sourceVelocity_[2])
+            {
+                memcpy(sound->sourceVelocity_, vel, 3 * sizeof(float));
+                alSourcefv(sound->source_, AL_VELOCITY, sound->sourceVelocity_);
+                dirty = true;
+            }
         }
 
-        // Генерируем источник
-        alGenSources(1, &source_);
+        if (gains != Q_NULLPTR)
+        {
+            ALfloat gain = qBound(0.0f, gains[i], 1.0f);
+
+            if (gain != sound->sourceGain_)
+            {
+                sound->gainRamp_.stop();
+                sound->sourceGain_ = gain;
+                alSourcef(sound->source_, AL_GAIN, sound->effectiveGain_());
+                dirty = true;
+            }
+        }
+
+        if (pitches != Q_NULLPTR && pitches[i] != sound->sourcePitch_)
+        {
+            sound->pitchRamp_.stop();
+            sound->sourcePitch_ = pitches[i];
+            sound->applyPitch_();
+            dirty = true;
+        }
+
+        // Источник получает новый фильтр лишь при смене уровня заглушения
+        if (occlusions != Q_NULLPTR)
+        {
+            ALfloat occlusion = qBound(0.0f, occlusions[i], 1.0f);
+
+            if (occlusion != sound->occlusion_)
+            {
+                sound->occlusion_ = occlusion;
+                sound->applyOcclusion_();
+                dirty = true;
+            }
+        }
+
+        if (dirty)
+            ++changed;
+    }
+
+    AListener::processAllUpdates();
+
+    return changed;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Установить приоритет звука
+//-----------------------------------------------------------------------------
+void ASound::setPriority(int priority)
+{
+    priority_ = qMax(0, priority);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть приоритет звука
+//-----------------------------------------------------------------------------
+int ASound::getPriority() const
+{
+    return priority_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть текущий уровень детализации
+//-----------------------------------------------------------------------------
+int ASound::getLodLevel() const
+{
+    return currentLod_;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вернуть количество уровней детализации звука
+//-----------------------------------------------------------------------------
+int ASound::getLodCount() const
+{
+    return qMax(1, lods_.count());
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Рассчитать усиление выравнивания громкости
+//-----------------------------------------------------------------------------
+void ASound::updateNormGain_()
+{
+    normGain_ = 1.0f;
+
+    if (data_.isNull() || !data_->analysis.valid || !listener_->isNormalizationEnabled())
+        return;
+
+    const sound_level_t &level = data_->analysis.total;
+
+    // Тишину не поднимаем
+    if (level.loudness <= ASoundDSP::LOUDNESS_SILENCE)
+        return;
+
+    float gain = std::pow(10.0f, (listener_->getLoudnessTarget() - level.loudness) / 20.0f);
+
+    // Пик не выводим за полную шкалу
+    if (level.peak > 0.0f)
+        gain = qMin(gain, 1.0f / level.peak);
+
+    normGain_ = qBound(0.0f, gain, MAX_NORMALIZE_GAIN);
+}
+
+
 
-        if (alGetError() != AL_NO_ERROR)
-        {
-            canDo_ = false;
-            lastError_ = "CANT_GENERATE_SOURCE";
-            return;
-        }
+//-----------------------------------------------------------------------------
+// Данные исходного уровня детализации
+//-----------------------------------------------------------------------------
+QSharedPointer<ASoundData> ASound::baseData_() const
+{
+    // Пока играет упрощённый вариант, исходные данные - у нулевого уровня
+    if (!lods_.isEmpty())
+        return lods_[0].data;
 
-        // Настраиваем буфер
-        for (int i = 0; i < BUFFER_BLOCKS; ++i)
-        {
-            alBufferData(buffer_[i], format_, wavData_[i], static_cast<ALsizei>(blockSize_[i]),
-                         static_cast<ALsizei>(wave_info_.sampleRate));
-        }
+    return data_;
+}
 
-        if (alGetError() != AL_NO_ERROR)
-        {
-            canDo_ = false;
-            lastError_ = "CANT_MAKE_BUFFER_DATA";
-            return;
-        }
+
+
+//-----------------------------------------------------------------------------
+// Итоговая громкость источника с учётом группы и выравнивания
+//-----------------------------------------------------------------------------
+ALfloat ASound::effectiveGain_() const
+{
+    ALfloat gain = sourceGain_ * normGain_;
+
+    if (group_ != Q_NULLPTR)
+        gain *= group_->getEffectiveGain();
+
+    return gain;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Итоговая скорость воспроизведения с учётом группы
+//-----------------------------------------------------------------------------
+ALfloat ASound::effectivePitch_() const
+{
+    ALfloat pitch = sourcePitch_;
+
+    if (group_ != Q_NULLPTR)
+        pitch *= group_->getEffectivePitch();
+
+    return pitch;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Итоговое заглушение с учётом группы
+//-----------------------------------------------------------------------------
+float ASound::effectiveOcclusion_() const
+{
+    if (group_ == Q_NULLPTR)
+        return occlusion_;
+
+    // Перемножаются доли прошедшего звука
+    return 1.0f - (1.0f - occlusion_) * (1.0f - group_->getEffectiveOcclusion());
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Назначить источнику фильтр уровня заглушения
+//-----------------------------------------------------------------------------
+void ASound::applyOcclusion_()
+{
+    if (listener_->getEfx() == Q_NULLPTR || source_ == 0)
+        return;
+
+    int level = qRound(effectiveOcclusion_() * (OCCLUSION_LEVELS - 1));
+
+    if (level == occlusionLevel_)
+        return;
+
+    select_();
+
+    occlusionLevel_ = level;
+    alSourcei(source_, AL_DIRECT_FILTER, static_cast<ALint>(listener_->occlusionFilters_[level]));
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Позиция воспроизведения с поправкой на задержку вывода
+//-----------------------------------------------------------------------------
+double ASound::playbackFrames_()
+{
+    if (!canPlay_ || data_.isNull())
+        return 0.0;
+
+    if (stub_)
+    {
+        stubAdvance_();
+        return stubFrames_;
+    }
+
+    select_();
+
+    if (listener_->alGetSourcei64vSOFT_ == nullptr)
+    {
+        ALint offset = 0;
+        alGetSourcei(source_, AL_SAMPLE_OFFSET, &offset);
+        return offset;
     }
+
+    // Позиция в формате 32.32 и задержка вывода, нс
+    ALint64SOFT values[2] = {0, 0};
+    listener_->alGetSourcei64vSOFT_(source_, AL_SAMPLE_OFFSET_LATENCY_SOFT, values);
+
+    double frames = static_cast<double>(values[0]) / 4294967296.0;
+
+    // Сэмплы, ещё не дошедшие до выхода, звучат с текущей скоростью
+    frames -= 1.0e-9 * static_cast<double>(values[1]) * data_->info.sampleRate * effectivePitch_();
+
+    return qMax(0.0, frames);
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Настройка источника
+// Досчитать расчётную позицию до текущего момента
 //-----------------------------------------------------------------------------
-void ASound::configureSource_()
+void ASound::stubAdvance_()
 {
-    if (canDo_)
+    double now = AListener::backendTime_();
+    double elapsed = now - stubAt_;
+    stubAt_ = now;
+
+    // Генератор играет, пока его не остановят
+    if (stubState_ != AL_PLAYING || elapsed <= 0.0 || data_.isNull())
+        return;
+
+    double bytesPerFrame = qMax<short>(1, data_->info.bytesPerSample);
+    double frames = data_->dataSize / bytesPerFrame;
+
+    stubFrames_ += elapsed * data_->info.sampleRate * stubPitch_;
+
+    if (stubLooping_)
     {
-        // Передаём источнику буфер
-        alSourceQueueBuffers(source_, BUFFER_BLOCKS, buffer_);
+        // Блок цикла крутится до stop()
+        double loopBegin = data_->blockSize[0] / bytesPerFrame;
+        double loopEnd = loopBegin + data_->blockSize[1] / bytesPerFrame;
 
-        if (alGetError() != AL_NO_ERROR)
+        if (loopEnd > loopBegin && stubFrames_ >= loopEnd)
+            stubFrames_ = loopBegin + fmod(stubFrames_ - loopBegin, loopEnd - loopBegin);
+    }
+
+    if (stubFrames_ < frames)
+        return;
+
+    if (sourceLoop_ && frames > 0.0)
+    {
+        stubFrames_ = fmod(stubFrames_, frames);
+    }
+    else
+    {
+        // Доиграл - позиция сбрасывается, как у остановленного источника
+        stubFrames_ = 0.0;
+        stubState_ = AL_STOPPED;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Запустить, приостановить или остановить источник
+//-----------------------------------------------------------------------------
+void ASound::setSourceState_(ALint state)
+{
+    if (!stub_)
+    {
+        if (state == AL_PLAYING)
+            alSourcePlay(source_);
+        else if (state == AL_PAUSED)
+            alSourcePause(source_);
+        else
         {
-            canDo_ = false;
-            lastError_ = "CANT_ADD_BUFFER_TO_SOURCE";
-            return;
+            alSourceStop(source_);
+            cancelLod_();
         }
 
-        // Устанавливаем громкость
-        alSourcef(source_, AL_GAIN, 0.01f * sourceVolume_);
+        return;
+    }
 
-        if (alGetError() != AL_NO_ERROR)
+    stubAdvance_();
+
+    if (state == AL_PLAYING)
+    {
+        // Как и alSourcePlay(): с паузы - продолжение, иначе - с начала
+        if (stubState_ != AL_PAUSED)
+            stubFrames_ = 0.0;
+
+        stubState_ = AL_PLAYING;
+    }
+    else if (state == AL_PAUSED)
+    {
+        if (stubState_ == AL_PLAYING)
+            stubState_ = AL_PAUSED;
+    }
+    else
+    {
+        stubFrames_ = 0.0;
+        stubState_ = AL_STOPPED;
+        stubLooping_ = false;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Передать источнику итоговую скорость воспроизведения
+//-----------------------------------------------------------------------------
+void ASound::applyPitch_()
+{
+    if (stub_)
+    {
+        // Пройденный отрезок досчитываем с прежней скоростью
+        stubAdvance_();
+        stubPitch_ = effectivePitch_();
+        return;
+    }
+
+    alSourcef(source_, AL_PITCH, effectivePitch_());
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Продвинуть плавные изменения
+//-----------------------------------------------------------------------------
+bool ASound::advanceRamps_(qint64 now)
+{
+    select_();
+
+    if (gainRamp_.isActive())
+    {
+        sourceGain_ = gainRamp_.step(now);
+        alSourcef(source_, AL_GAIN, effectiveGain_());
+    }
+
+    if (pitchRamp_.isActive())
+    {
+        sourcePitch_ = pitchRamp_.step(now);
+        applyPitch_();
+    }
+
+    if (zoneRamp_.isActive())
+    {
+        zoneMix_ = zoneRamp_.step(now);
+
+        // Переход завершён - посыл в прежнюю зону освобождается
+        if (!zoneRamp_.isActive())
         {
-            canDo_ = false;
-            lastError_ = "CANT_APPLY_VOLUME";
-            return;
+            if (prevZone_ != Q_NULLPTR)
+                prevZone_->sounds_.removeOne(this);
+
+            prevZone_ = Q_NULLPTR;
+            zoneMix_ = 1.0f;
         }
 
-        // Устанавливаем скорость воспроизведения
-        alSourcef(source_, AL_PITCH, sourcePitch_);
+        applyZoneSends_();
+    }
 
-        if (alGetError() != AL_NO_ERROR)
+    return gainRamp_.isActive() || pitchRamp_.isActive() || zoneRamp_.isActive();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Передать посылы в слоты зон
+//-----------------------------------------------------------------------------
+void ASound::applyZoneSends_()
+{
+    const efx_functions_t* efx = listener_->getEfx();
+
+    if (efx == Q_NULLPTR || source_ == 0)
+        return;
+
+    select_();
+
+    ASoundZone* zones[2] = {zone_, prevZone_};
+    float gains[2] = {zoneMix_, 1.0f - zoneMix_};
+
+    int sends = qMin(2, static_cast<int>(listener_->auxSends_));
+
+    for (int i = 0; i < sends; ++i)
+    {
+        ALuint slot = (zones[i] != Q_NULLPTR) ? zones[i]->slot_(listener_) : 0;
+
+        // Параметры фильтра копируются в посыл - один фильтр на все источники
+        efx->alFilterf(listener_->sendFilter_, AL_LOWPASS_GAIN, gains[i]);
+        alSource3i(source_, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(slot), i,
+                   static_cast<ALint>(listener_->sendFilter_));
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Отсоединиться от удаляемой зоны
+//-----------------------------------------------------------------------------
+void ASound::leaveZone_(ASoundZone *zone)
+{
+    if (zone_ == zone)
+        zone_ = Q_NULLPTR;
+
+    if (prevZone_ == zone)
+        prevZone_ = Q_NULLPTR;
+
+    applyZoneSends_();
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Построить варианты уровней детализации
+//-----------------------------------------------------------------------------
+void ASound::buildLods_(ASoundBank *bank)
+{
+    lod_variant_t base;
+    base.data = data_;
+    base.format = format_;
+    memcpy(base.buffer, buffer_, sizeof(buffer_));
+    lods_.append(base);
+
+    for (int level = 1; level < ASOUND_LOD_LEVELS; ++level)
+    {
+        QSharedPointer<ASoundData> variant;
+
+        // Банк может хранить заранее подготовленные варианты
+        if (bank != Q_NULLPTR)
         {
-            canDo_ = false;
-            lastError_ = "CANT_APPLY_PITCH";
-            return;
+            variant = bank->getSound(soundName_ + ASOUND_BANK_LOD_SUFFIX + QString::number(level));
+
+            if (variant.isNull())
+                variant = AWaveReader::makeLodVariant(lods_[0].data, level,
+                                                      AWaveReader::arenaOf(lods_[0].data));
+        }
+        else
+        {
+            variant = ASoundStore::getInstance().lodVariant(soundName_, loadFlags_,
+                                                            level, lods_[0].data);
         }
 
-        // Устанавливаем зацикливание
-        alSourcei(source_, AL_LOOPING, static_cast<char>(sourceLoop_));
+        if (variant.isNull())
+            continue;
 
-        if (alGetError() != AL_NO_ERROR)
+        // Упёрлись в минимальную частоту - следующий уровень ничего не даст
+        const ASoundData &prev = *lods_.last().data;
+        if (variant->info.sampleRate == prev.info.sampleRate &&
+            variant->info.numChannels == prev.info.numChannels)
         {
-            canDo_ = false;
-            lastError_ = "CANT_APPLY_LOOPING";
-            return;
+            continue;
         }
 
-        // Устанавливаем положение
-        alSourcefv(source_, AL_POSITION, sourcePosition_);
+        lod_variant_t lod;
+        lod.data = variant;
+        lod.format = alFormat_(variant->info);
 
-        if (alGetError() != AL_NO_ERROR)
+        if (lod.format == 0)
+            continue;
+
+        if (!uploadLod_(lod))
+            break;
+
+        emit notify("| - LOD #" + QString::number(lods_.count()).toStdString() +
+                    ": " + QString::number(variant->info.sampleRate).toStdString() + " Hz, " +
+                    QString::number(variant->info.numChannels).toStdString() + " ch");
+
+        lods_.append(lod);
+    }
+
+    if (lods_.count() < 2)
+    {
+        lods_.clear();
+        return;
+    }
+
+    ASoundLodManager::getInstance().add(this);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Создать и заполнить буферы варианта детализации
+//-----------------------------------------------------------------------------
+bool ASound::uploadLod_(lod_variant_t &lod)
+{
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        if (lod.data->blockSize[i] > ASOUND_MAX_BLOCK)
         {
-            canDo_ = false;
-            lastError_ = "CANT_APPLY_POSITION";
-            return;
+            lastError_ = "BLOCK_TOO_LARGE: ";
+            lastError_.append(soundName_);
+            return false;
         }
+    }
 
-        // Устанавливаем вектор "скорости передвижения"
-        alSourcefv(source_, AL_VELOCITY, sourceVelocity_);
+    for (int i = 0; i < BUFFER_BLOCKS; ++i)
+    {
+        lod.buffer[i] = listener_->acquireBuffer_(lod.data->block[i], lod.data->blockSize[i], lod.format,
+                                                  static_cast<ALsizei>(lod.data->info.sampleRate));
 
-        if (alGetError() != AL_NO_ERROR)
+        if (lod.buffer[i] == 0)
         {
-            canDo_ = false;
-            lastError_ = "CANT_APPLY_VELOCITY";
-            return;
+            listener_->releaseBuffers_(lod.buffer, i);
+            lastError_ = "CANT_MAKE_BUFFER_DATA";
+            return false;
         }
     }
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Запросить уровень детализации
+//-----------------------------------------------------------------------------
+void ASound::requestLod_(int level)
+{
+    select_();
+
+    // Идёт переход в конце прохода - новый уровень ждёт его завершения
+    if (queuedLod_ >= 0)
+    {
+        pendingLod_ = (level >= 0 && level < lods_.count() && level != queuedLod_) ? level : -1;
+        return;
+    }
+
+    if (level < 0 || level >= lods_.count() || level == currentLod_)
+    {
+        pendingLod_ = -1;
+        return;
+    }
+
+    ALint state;
+    alGetSourcei(source_, AL_SOURCE_STATE, &state);
+
+    // Молчащий источник переключаем сразу, звучащий - на границе цикла
+    if (state != AL_PLAYING && state != AL_PAUSED)
+        switchLod_(level, false);
+    else
+        pendingLod_ = level;
 }
 
 
 
 //-----------------------------------------------------------------------------
-//
+// Проверить прохождение границы цикла
 //-----------------------------------------------------------------------------
-int ASound::getDuration()
+void ASound::pollLod_()
 {
-    if (canDo_)
+    // Звуки с метками переключаются из onTimerStartKiller()
+    if (canLABL_ || lods_.isEmpty())
+        return;
+
+    select_();
+
+    if (queuedLod_ >= 0)
     {
-        double subchunk2Size = wave_info_file_data_.subchunk2Size;
-        double byteRate = wave_info_.byteRate;
-        int duration = static_cast<int>(subchunk2Size/byteRate)*100;
-        return 10*duration;
+        finishLod_();
+        return;
     }
-    return 0;
+
+    if (pendingLod_ < 0 || !sourceLoop_)
+        return;
+
+    ALint state;
+    alGetSourcei(source_, AL_SOURCE_STATE, &state);
+
+    // Молчащий источник (или звук без вывода) переключаем сразу
+    if (stub_ || (state != AL_PLAYING && state != AL_PAUSED))
+        switchLod_(pendingLod_, false);
+    else
+        queueLod_(pendingLod_);
 }
 
 
 
 //-----------------------------------------------------------------------------
-// (слот) Установить громкость
+// Доиграть текущий проход цикла и перейти на уровень в его конце
 //-----------------------------------------------------------------------------
-void ASound::setVolume(int volume)
+void ASound::queueLod_(int level)
 {
-    if (canPlay_)
-    {
-        sourceVolume_ = volume;
+    const lod_variant_t &lod = lods_[level];
 
-        if (sourceVolume_ > MAX_SRC_VOLUME)
-            sourceVolume_ = MAX_SRC_VOLUME;
+    alGetError();
 
-        if (sourceVolume_ < MIN_SRC_VOLUME)
-            sourceVolume_ = MIN_SRC_VOLUME;
+    // Проход доигрывается до конца и не заворачивается на середину цикла
+    alSourcei(source_, AL_LOOPING, AL_FALSE);
 
-        alSourcef(source_, AL_GAIN, 0.01f * sourceVolume_);
+    // Вариант того же формата и частоты встаёт в очередь следом и звучит
+    // без разрыва, иначе источник перезапускается с начала цикла
+    lodChained_ = lod.format == format_ &&
+            lod.data->info.sampleRate == data_->info.sampleRate;
+
+    if (lodChained_)
+    {
+        alSourceQueueBuffers(source_, BUFFER_BLOCKS, lod.buffer);
+        lodChained_ = (alGetError() == AL_NO_ERROR);
     }
+
+    queuedLod_ = level;
+    pendingLod_ = -1;
+
+    armLodBoundary_();
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Вернуть громкость
+// Завершить переход на уровень, если проход цикла доигран
 //-----------------------------------------------------------------------------
-int ASound::getVolume()
+void ASound::finishLod_()
 {
-    return sourceVolume_;
-}
+    if (queuedLod_ < 0)
+        return;
 
+    select_();
 
+    ALint state, processed = 0;
+    alGetSourcei(source_, AL_SOURCE_STATE, &state);
+    alGetSourcei(source_, AL_BUFFERS_PROCESSED, &processed);
 
-//-----------------------------------------------------------------------------
-// (слот) Установить скорость воспроизведения
-//-----------------------------------------------------------------------------
-void ASound::setPitch(float pitch)
-{
-    if (canPlay_)
+    int level = queuedLod_;
+
+    if (state != AL_STOPPED)
     {
-        sourcePitch_ = pitch;
-        alSourcef(source_, AL_PITCH, sourcePitch_);
+        // Проход ещё звучит
+        if (!lodChained_ || processed < BUFFER_BLOCKS)
+        {
+            armLodBoundary_();
+            return;
+        }
+
+        // Прежний проход доигран - снимаем его буферы, вариант звучит дальше
+        const lod_variant_t &lod = lods_[level];
+        ALuint done[BUFFER_BLOCKS];
+
+        alSourceUnqueueBuffers(source_, BUFFER_BLOCKS, done);
+        alSourcei(source_, AL_LOOPING, static_cast<char>(sourceLoop_));
+
+        data_ = lod.data;
+        format_ = lod.format;
+        memcpy(buffer_, lod.buffer, sizeof(buffer_));
+        currentLod_ = level;
+        queuedLod_ = -1;
+
+        return;
     }
+
+    // Проход закончился - следующий начинаем уже с варианта
+    queuedLod_ = -1;
+
+    alSourcei(source_, AL_LOOPING, static_cast<char>(sourceLoop_));
+    switchLod_(level, false);
+    alSourcePlay(source_);
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Вернуть скорость воспроизведения
+// Отменить переход на уровень в конце прохода
 //-----------------------------------------------------------------------------
-float ASound::getPitch()
+void ASound::cancelLod_()
 {
-    return sourcePitch_;
-}
+    if (queuedLod_ < 0)
+        return;
 
+    if (timerLodBoundary_ != Q_NULLPTR)
+        timerLodBoundary_->stop();
 
+    queuedLod_ = -1;
 
-//-----------------------------------------------------------------------------
-// (слот) Установить зацикливание
-//-----------------------------------------------------------------------------
-void ASound::setLoop(bool loop)
-{
-    if (canPlay_)
+    if (lodChained_)
     {
-        sourceLoop_ = loop;
-        alSourcei(source_, AL_LOOPING, static_cast<char>(sourceLoop_));
+        // Буферы варианта из очереди не снять, пока они не сыграны -
+        // собираем очередь из текущих буферов заново
+        ALint state, offset = 0;
+        alGetSourcei(source_, AL_SOURCE_STATE, &state);
+        alGetSourcei(source_, AL_SAMPLE_OFFSET, &offset);
+
+        uint64_t frames = data_->dataSize / static_cast<uint64_t>(qMax<short>(1, data_->info.bytesPerSample));
+
+        alSourceStop(source_);
+        alSourcei(source_, AL_BUFFER, 0);
+        alSourceQueueBuffers(source_, BUFFER_BLOCKS, buffer_);
+        alSourcei(source_, AL_SAMPLE_OFFSET,
+                  static_cast<uint64_t>(offset) < frames ? offset : 0);
+
+        if (state == AL_PLAYING)
+        {
+            alSourcePlay(source_);
+        }
+        else if (state == AL_PAUSED)
+        {
+            alSourcePlay(source_);
+            alSourcePause(source_);
+        }
     }
+
+    alSourcei(source_, AL_LOOPING, static_cast<char>(sourceLoop_));
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Вернуть зацикливание
+// Завести таймер на конец текущего прохода
 //-----------------------------------------------------------------------------
-bool ASound::getLoop()
+void ASound::armLodBoundary_()
 {
-    return sourceLoop_;
-}
+    ALint state, offset = 0;
+    alGetSourcei(source_, AL_SOURCE_STATE, &state);
+
+    // На паузе конец прохода дождётся pollLod_()
+    if (state != AL_PLAYING)
+        return;
 
+    alGetSourcei(source_, AL_SAMPLE_OFFSET, &offset);
 
+    double frames = static_cast<double>(data_->dataSize / static_cast<uint64_t>(qMax<short>(1, data_->info.bytesPerSample)));
+    double rest = qMax(0.0, frames - offset) / data_->info.sampleRate / qMax(0.001f, effectivePitch_());
 
-//-----------------------------------------------------------------------------
-// (слот) Установить положение
-//-----------------------------------------------------------------------------
-void ASound::setPosition(float x, float y, float z)
-{
-    if (canPlay_)
+    if (timerLodBoundary_ == Q_NULLPTR)
     {
-        sourcePosition_[0] = x;
-        sourcePosition_[1] = y;
-        sourcePosition_[2] = z;
-        alSourcefv(source_, AL_POSITION, sourcePosition_);
+        timerLodBoundary_ = new QTimer(this);
+        timerLodBoundary_->setSingleShot(true);
+        timerLodBoundary_->setTimerType(Qt::PreciseTimer);
+        connect(timerLodBoundary_, SIGNAL(timeout()),
+                this, SLOT(onTimerLodBoundary()));
     }
+
+    // Срабатываем сразу за границей, а не раз в интервал пересчёта
+    timerLodBoundary_->start(static_cast<int>(std::ceil(rest * 1000.0)) + 1);
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Вернуть положение
+// Переключить источник на вариант уровня детализации
 //-----------------------------------------------------------------------------
-void ASound::getPosition(float &x, float &y, float &z)
+void ASound::switchLod_(int level, bool toLoopStart)
 {
-    x = sourcePosition_[0];
-    y = sourcePosition_[1];
-    z = sourcePosition_[2];
-}
+    select_();
 
+    const lod_variant_t &lod = lods_[level];
 
+    ALint state, offset = 0;
+    alGetSourcei(source_, AL_SOURCE_STATE, &state);
+    alGetSourcei(source_, AL_SAMPLE_OFFSET, &offset);
 
-//-----------------------------------------------------------------------------
-// (слот) Установить вектор "скорости передвижения"
-//-----------------------------------------------------------------------------
-void ASound::setVelocity(float x, float y, float z)
-{
-    if (canPlay_)
+    // Позицию переносим во времени: у вариантов разная частота
+    double seconds = static_cast<double>(offset) / data_->info.sampleRate;
+
+    alSourceStop(source_);
+    alSourcei(source_, AL_BUFFER, 0);
+    alSourceQueueBuffers(source_, BUFFER_BLOCKS, lod.buffer);
+
+    data_ = lod.data;
+    format_ = lod.format;
+    memcpy(buffer_, lod.buffer, sizeof(buffer_));
+    currentLod_ = level;
+    pendingLod_ = -1;
+
+    if (toLoopStart)
     {
-        sourceVelocity_[0] = x;
-        sourceVelocity_[1] = y;
-        sourceVelocity_[2] = z;
-        alSourcefv(source_, AL_VELOCITY, sourceVelocity_);
+        alSourcei(source_, AL_BYTE_OFFSET, static_cast<ALint>(data_->blockSize[0]));
+    }
+    else
+    {
+        uint64_t frames = data_->dataSize / static_cast<uint64_t>(qMax<short>(1, data_->info.bytesPerSample));
+        uint64_t frame = static_cast<uint64_t>(seconds * data_->info.sampleRate);
+        alSourcei(source_, AL_SAMPLE_OFFSET, static_cast<ALint>(frame < frames ? frame : 0));
+    }
+
+    if (state == AL_PLAYING)
+    {
+        alSourcePlay(source_);
+    }
+    else if (state == AL_PAUSED)
+    {
+        alSourcePlay(source_);
+        alSourcePause(source_);
     }
 }
 
 
 
 //-----------------------------------------------------------------------------
-// Вернуть вектор "скорости перемещения"
+// Запомнить состояние и позицию воспроизведения источника
 //-----------------------------------------------------------------------------
-void ASound::getVelocity(float &x, float &y, float &z)
+void ASound::saveState_(qint64 now)
 {
-    x = sourceVelocity_[0];
-    y = sourceVelocity_[1];
-    z = sourceVelocity_[2];
+    if (!canPlay_)
+        return;
+
+    select_();
+
+    alGetSourcei(source_, AL_SOURCE_STATE, &savedState_);
+    alGetSourcei(source_, AL_SAMPLE_OFFSET, &savedOffset_);
+    savedAt_ = now;
 }
 
 
 
 //-----------------------------------------------------------------------------
-// (слот) Играть звук
+// Восстановить звук после переоткрытия устройства
 //-----------------------------------------------------------------------------
-void ASound::play()
+void ASound::restoreState_(qint64 now, bool rebuild)
 {
-    if (!isPlaying())
+    if (!canPlay_)
+        return;
+
+    select_();
+
+    if (rebuild)
     {
-        if (canPlay_)
+        // Прежние буферы и источник исчезли вместе с контекстом - заполняем
+        // новые из уже разобранных данных, без повторного чтения файла
+        canDo_ = true;
+        source_ = 0;
+
+        // Вариант, стоявший в очереди прежнего источника, пропал вместе с ним
+        queuedLod_ = -1;
+
+        if (timerLodBoundary_ != Q_NULLPTR)
+            timerLodBoundary_->stop();
+
+        generateStuff_();
+
+        if (canDo_ && !lods_.isEmpty())
         {
-            if (canLABL_)
+            memcpy(lods_[currentLod_].buffer, buffer_, sizeof(buffer_));
+
+            for (int i = 0; i < lods_.count() && canDo_; ++i)
             {
-                timerStartKiller_ = new QTimer(this);
-                connect(timerStartKiller_, SIGNAL(timeout()),
-                        this, SLOT(onTimerStartKiller()));
-                timerStartKiller_->setInterval(15);
-                timerStartKiller_->start();
+                if (i != currentLod_ && !uploadLod_(lods_[i]))
+                {
+                    canDo_ = false;
+                    lastError_ = "CANT_GENERATE_BUFFER";
+                }
             }
+        }
 
-            alSourcePlay(source_);
+        configureSource_();
+
+        canPlay_ = canDo_;
+
+        if (!canPlay_)
+        {
+            setLastError(lastError_.toStdString());
+            return;
         }
+
+        // Слоты зон создаются на новом контексте заново
+        applyZoneSends_();
     }
-    else
+
+    if (savedState_ != AL_PLAYING && savedState_ != AL_PAUSED)
+        return;
+
+    // У генератора позиции нет - просто возобновляем
+    if (data_.isNull())
     {
         alSourcePlay(source_);
+
+        if (savedState_ == AL_PAUSED)
+            alSourcePause(source_);
+
+        return;
     }
+
+    // Позицию продвигаем на время, прошедшее с сохранения
+    double offset = savedOffset_;
+
+    if (savedState_ == AL_PLAYING)
+        offset += 0.001 * (now - savedAt_) * data_->info.sampleRate * effectivePitch_();
+
+    uint64_t frameSize = static_cast<uint64_t>(qMax<short>(1, data_->info.bytesPerSample));
+    double frames = static_cast<double>(data_->dataSize / frameSize);
+    double loopBegin = static_cast<double>(data_->blockSize[0] / frameSize);
+    double loopEnd = loopBegin + static_cast<double>(data_->blockSize[1] / frameSize);
+
+    // Звук с метками, ещё не ушедший на блок остановки, крутится в цикле
+    bool labelLoop = canLABL_ && timerStartKiller_ != Q_NULLPTR &&
+            timerStartKiller_->isActive() && savedOffset_ < loopEnd;
+
+    if (labelLoop && offset >= loopEnd && loopEnd > loopBegin)
+        offset = loopBegin + std::fmod(offset - loopBegin, loopEnd - loopBegin);
+    else if (sourceLoop_ && offset >= frames && frames > 0)
+        offset = std::fmod(offset, frames);
+    else if (offset >= frames)
+        return;     // Звук успел бы доиграть
+
+    alSourcei(source_, AL_SAMPLE_OFFSET, static_cast<ALint>(offset));
+    alSourcePlay(source_);
+
+    if (savedState_ == AL_PAUSED)
+        alSourcePause(source_);
 }
 
 
 
 //-----------------------------------------------------------------------------
-// (слот) Приостановить звук
+// Заменить данные звука перечитанными с диска
 //-----------------------------------------------------------------------------
-void ASound::pause()
+void ASound::swapData_(QSharedPointer<ASoundData> data, qint64 now)
 {
-    if (canPlay_)
+    if (!canPlay_ || data == data_)
+        return;
+
+    lod_variant_t base;
+    base.data = data;
+    base.format = alFormat_(data->info);
+
+    // Неподдерживаемый формат - остаёмся на прежних данных
+    if (base.format == 0)
     {
-        alSourcePause(source_);
+        setLastError("UNKNOWN_AUDIO_FORMAT");
+        return;
     }
-}
 
+    select_();
 
+    // Очередь источника собирается заново ниже
+    cancelLod_();
 
-//-----------------------------------------------------------------------------
-// (слот) Остановить звук
-//-----------------------------------------------------------------------------
-void ASound::stop()
-{
-    if (canPlay_)
+    if (!uploadLod_(base))
     {
-        // Если у файла есть метки
-        if (canLABL_)
-        {
-            setLoop(false);
-            // Задаём смещение на блок звука остановки по метке
-            alSourcei(source_, AL_BYTE_OFFSET,
-                      static_cast<ALint>(blockSize_[0] + blockSize_[1]));
+        setLastError(lastError_.toStdString());
+        return;
+    }
 
-            if (timerStartKiller_ != Q_NULLPTR)
-                if (timerStartKiller_->isActive())
-                    timerStartKiller_->stop();
-        }
-        else
-        {
-            alSourceStop(source_);
-        }
+    saveState_(now);
+
+    // Позицию переносим во времени: частота новых данных может отличаться
+    // и от звучащего уровня детализации, и от прежнего файла
+    savedOffset_ = static_cast<ALint>(static_cast<double>(savedOffset_) *
+                                      data->info.sampleRate /
+                                      qMax<uint32_t>(1, data_->info.sampleRate));
+
+    alSourceStop(source_);
+    alSourcei(source_, AL_BUFFER, 0);
+
+    if (lods_.isEmpty())
+    {
+        listener_->releaseBuffers_(buffer_, BUFFER_BLOCKS);
+    }
+    else
+    {
+        for (const lod_variant_t &lod : lods_)
+            listener_->releaseBuffers_(lod.buffer, BUFFER_BLOCKS);
+
+        lods_.clear();
+        currentLod_ = 0;
+        pendingLod_ = -1;
+
+        // Без вариантов управлять нечем; buildLods_() вернёт звук, если
+        // варианты у новых данных будут
+        ASoundLodManager::getInstance().remove(this);
+    }
+
+    data_ = data;
+    format_ = base.format;
+    memcpy(buffer_, base.buffer, sizeof(buffer_));
+    canLABL_ = !data_->labels.isEmpty();
+
+    // Метки из файла убраны - цикл по меткам больше не ведём
+    if (!canLABL_ && timerStartKiller_ != Q_NULLPTR)
+        timerStartKiller_->stop();
+
+    updateNormGain_();
+
+    configureSource_();
+
+    if (!canDo_)
+    {
+        canPlay_ = false;
+        setLastError(lastError_.toStdString());
+        return;
     }
+
+    if (loadFlags_ & LOAD_LOD)
+        buildLods_(Q_NULLPTR);
+
+    restoreState_(now, false);
+
+    emit notify("| - Reloaded: " + soundName_.toStdString());
 }
 
 
@@ -878,6 +3524,15 @@ QString ASound::getLastError()
 //-----------------------------------------------------------------------------
 bool ASound::isPlaying()
 {
+    // Без вывода источника нет - состояние расчётное
+    if (stub_)
+    {
+        stubAdvance_();
+        return stubState_ == AL_PLAYING;
+    }
+
+    select_();
+
     ALint state;
     alGetSourcei(source_, AL_SOURCE_STATE, &state);
     return(state == AL_PLAYING);
@@ -890,6 +3545,15 @@ bool ASound::isPlaying()
 //-----------------------------------------------------------------------------
 bool ASound::isPaused()
 {
+    // Без вывода источника нет - состояние расчётное
+    if (stub_)
+    {
+        stubAdvance_();
+        return stubState_ == AL_PAUSED;
+    }
+
+    select_();
+
     ALint state;
     alGetSourcei(source_, AL_SOURCE_STATE, &state);
     return(state == AL_PAUSED);
@@ -902,6 +3566,15 @@ bool ASound::isPaused()
 //-----------------------------------------------------------------------------
 bool ASound::isStopped()
 {
+    // Без вывода источника нет - состояние расчётное
+    if (stub_)
+    {
+        stubAdvance_();
+        return stubState_ == AL_STOPPED;
+    }
+
+    select_();
+
     ALint state;
     alGetSourcei(source_, AL_SOURCE_STATE, &state);
     return(state == AL_STOPPED);
@@ -909,33 +3582,13 @@ bool ASound::isStopped()
 
 
 
-//-----------------------------------------------------------------------------
-// Метод проверки необходимых параметров
-//-----------------------------------------------------------------------------
-void ASound::checkValue(std::string baseStr, const char targStr[], QString err)
-{
-    if (canDo_)
-    {
-        // // /////////////////////////////////////////////// //
-        // // Важно, чтобы подстрока начиналась с 0 элемента! //
-        // //    иначе проверку нельзя считать достоверной    //
-        // // /////////////////////////////////////////////// //
-        if (baseStr.find(targStr) != 0)
-        {
-            setLastError(err.toStdString());
-            lastError_ = err;
-            canDo_ = false;
-        }
-    }
-}
-
-
-
 //-----------------------------------------------------------------------------
 // Уничтожение блока старта
 //-----------------------------------------------------------------------------
 void ASound::onTimerStartKiller()
 {
+    select_();
+
     ALint buffer, curPosByte;
 
     alGetSourcei(source_, AL_BUFFER, &buffer);
@@ -943,14 +3596,28 @@ void ASound::onTimerStartKiller()
 
 
     //if (static_cast<ALuint>(buffer) == buffer_[1])
-    if (curPosByte >= static_cast<ALint>(blockSize_[0] + blockSize_[1]))
+    if (curPosByte >= static_cast<ALint>(data_->blockSize[0] + data_->blockSize[1]))
     {
-        alSourcei(source_, AL_BYTE_OFFSET, static_cast<ALint>(blockSize_[0]));
+        // Граница цикла - удобный момент сменить уровень детализации
+        if (pendingLod_ >= 0)
+            switchLod_(pendingLod_, true);
+        else
+            alSourcei(source_, AL_BYTE_OFFSET, static_cast<ALint>(data_->blockSize[0]));
     }
 }
 
 
 
+//-----------------------------------------------------------------------------
+// (слот) Конец прохода цикла при смене детализации
+//-----------------------------------------------------------------------------
+void ASound::onTimerLodBoundary()
+{
+    finishLod_();
+}
+
+
+
 //-----------------------------------------------------------------------------
 //
 //      Класс управления очередью запуска звуков
@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# Утилита сборки банка звуков
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+CONFIG(debug, debug|release){
+    TARGET = asound-bank_d
+    DESTDIR = ../../../../bin
+    LIBS += -L../../../../lib -lasound_d
+} else {
+    TARGET = asound-bank
+    DESTDIR = ../../../../bin
+    LIBS += -L../../../../lib -lasound
+}
+
+INCLUDEPATH += ../../include/
+
+SOURCES += main.cpp
+
+win32{
+
+    OPENAL_INCLUDE_BIN = $$(OPENAL_INCLUDE)
+    INCLUDEPATH += $$OPENAL_INCLUDE_BIN
+}
+
+unix{
+
+    INCLUDEPATH += /usr/include/AL
+}
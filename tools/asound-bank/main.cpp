@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+//
+//      Утилита сборки банка звуков
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Утилита сборки банка звуков
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ *
+ *  Использование:
+ *      asound-bank [--lod N] <файл банка> <каталог звуков> [файл.wav ...]
+ *
+ *  --lod N - добавить к каждому звуку N упрощённых вариантов для дальних
+ *  источников (моно, частота ниже в 2, 4 ... раз).
+ *
+ *  Если список файлов не задан, в банк собираются все *.wav из каталога
+ *  звуков (рекурсивно). Имена звуков в банке - пути относительно каталога.
+ */
+
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QStringList>
+#include <iostream>
+
+#include "asound-bank.h"
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList args = QCoreApplication::arguments();
+    int lodLevels = 0;
+
+    if (args.count() > 2 && args[1] == "--lod")
+    {
+        lodLevels = args[2].toInt();
+        args.removeAt(1);
+        args.removeAt(1);
+    }
+
+    if (args.count() < 3)
+    {
+        std::cerr << "Usage: asound-bank [--lod N] <bank file> <sounds dir> [file.wav ...]" << std::endl;
+        return 1;
+    }
+
+    QString bankname = args[1];
+    QString baseDir = args[2];
+    QStringList files;
+
+    for (int i = 3; i < args.count(); ++i)
+        files.append(args[i]);
+
+    if (files.isEmpty())
+    {
+        QDirIterator it(baseDir, QStringList() << "*.wav" << "*.WAV",
+                        QDir::Files, QDirIterator::Subdirectories);
+
+        while (it.hasNext())
+            files.append(it.next());
+    }
+
+    QString error;
+
+    if (!ASoundBank::write(bankname, baseDir, files, error, lodLevels))
+    {
+        std::cerr << "Error: " << error.toStdString() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Bank " << bankname.toStdString() << ": "
+              << files.count() << " sounds" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# Проверка ядер обработки звука
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+CONFIG(debug, debug|release){
+    TARGET = asound-check_d
+    DESTDIR = ../../../../bin
+    LIBS += -L../../../../lib -lasound_d
+} else {
+    TARGET = asound-check
+    DESTDIR = ../../../../bin
+    LIBS += -L../../../../lib -lasound
+}
+
+INCLUDEPATH += ../../include/
+
+SOURCES += main.cpp
+
+win32{
+
+    OPENAL_INCLUDE_BIN = $$(OPENAL_INCLUDE)
+    INCLUDEPATH += $$OPENAL_INCLUDE_BIN
+}
+
+unix{
+
+    INCLUDEPATH += /usr/include/AL
+}
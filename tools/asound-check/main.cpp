@@ -0,0 +1,402 @@
+//-----------------------------------------------------------------------------
+//
+//      Проверка ядер обработки и разбора звука
+//      (c) РГУПС, ВЖД 18/10/2026
+//
+//-----------------------------------------------------------------------------
+/*!
+ *  \file
+ *  \brief Проверка ядер обработки и разбора звука
+ *  \copyright РГУПС, ВЖД
+ *  \date 18/10/2026
+ *
+ *  Использование:
+ *      asound-check
+ *
+ *  Каждое ядро ASoundDSP с векторной (SSE2) веткой прогоняется на одних и
+ *  тех же данных дважды - с векторной и со скалярной веткой - и результаты
+ *  сравниваются. Сведение каналов, свёртка и генератор шума должны совпасть
+ *  побитно; ресемплер и анализ уровней суммируют в другом порядке и
+ *  сравниваются с допуском.
+ *
+ *  Разбор файлов проверяется на файлах, собранных здесь же (Sony Wave64 с
+ *  фрагментом маркеров). Код возврата - количество несовпадений.
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+#include "asound-dsp.h"
+#include "asound-wave.h"
+
+/// Допуск ресемплера (доли полной шкалы)
+const float CHECK_RESAMPLE_TOLERANCE = 1.0e-5f;
+
+/// Относительный допуск сумм анализа уровней
+const float CHECK_LEVEL_TOLERANCE = 1.0e-5f;
+
+/// Допуск громкости, LU
+const float CHECK_LOUDNESS_TOLERANCE = 0.01f;
+
+/// Количество несовпадений
+static int failures = 0;
+
+//-----------------------------------------------------------------------------
+// Воспроизводимый псевдослучайный поток (xorshift32)
+//-----------------------------------------------------------------------------
+static uint32_t nextRandom(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Вывести результат проверки
+//-----------------------------------------------------------------------------
+static void report(const char* name, bool ok, const std::string &detail = std::string())
+{
+    std::cout << (ok ? "OK   " : "FAIL ") << name;
+
+    if (!detail.empty())
+        std::cout << ": " << detail;
+
+    std::cout << std::endl;
+
+    if (!ok)
+        ++failures;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Сведение стерео в моно: побитное совпадение веток
+//-----------------------------------------------------------------------------
+static void checkDownmix()
+{
+    // Длина не кратна шагу векторной ветки - хвост тоже проверяется
+    const size_t frames = 100003;
+    uint32_t state = 0x1234567u;
+
+    std::vector<int16_t> src16(2 * frames);
+    std::vector<uint8_t> src8(2 * frames);
+
+    for (size_t i = 0; i < 2 * frames; ++i)
+    {
+        uint32_t r = nextRandom(state);
+        src16[i] = static_cast<int16_t>(r);
+        src8[i] = static_cast<uint8_t>(r >> 16);
+    }
+
+    std::vector<int16_t> simd16(frames), scalar16(frames);
+    std::vector<uint8_t> simd8(frames), scalar8(frames);
+
+    ASoundDSP::setSimdEnabled(true);
+    ASoundDSP::downmixStereo16(src16.data(), simd16.data(), frames);
+    ASoundDSP::downmixStereo8(src8.data(), simd8.data(), frames);
+
+    ASoundDSP::setSimdEnabled(false);
+    ASoundDSP::downmixStereo16(src16.data(), scalar16.data(), frames);
+    ASoundDSP::downmixStereo8(src8.data(), scalar8.data(), frames);
+
+    report("downmixStereo16", simd16 == scalar16);
+    report("downmixStereo8", simd8 == scalar8);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Свёртка данных: побитное совпадение веток для разных длин
+//-----------------------------------------------------------------------------
+static void checkHash()
+{
+    std::vector<unsigned char> data(1 << 20);
+    uint32_t state = 0x89ABCDEu;
+
+    for (unsigned char &byte : data)
+        byte = static_cast<unsigned char>(nextRandom(state));
+
+    const size_t sizes[] = {0, 1, 7, 8, 31, 32, 33, 63, 64, 1000, 65537, data.size()};
+    bool ok = true;
+
+    for (size_t size : sizes)
+    {
+        ASoundDSP::setSimdEnabled(true);
+        uint64_t simd = ASoundDSP::hash64(data.data(), size);
+
+        ASoundDSP::setSimdEnabled(false);
+        uint64_t scalar = ASoundDSP::hash64(data.data(), size);
+
+        if (simd != scalar)
+        {
+            report("hash64", false, "size " + std::to_string(size));
+            ok = false;
+        }
+    }
+
+    if (ok)
+        report("hash64", true);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Генератор полосового шума: побитное совпадение веток
+//-----------------------------------------------------------------------------
+static void checkNoise()
+{
+    noise_lanes_t lanes;
+    const float frequency[NOISE_LANES] = {700.0f, 1200.0f, 3500.0f, 90.0f};
+    const float q[NOISE_LANES] = {0.7f, 1.5f, 8.0f, 0.7f};
+    const float rate = 44100.0f;
+
+    for (int l = 0; l < NOISE_LANES; ++l)
+    {
+        float w0 = 6.2831853f * frequency[l] / rate;
+        float alpha = std::sin(w0) / (2.0f * q[l]);
+        float a0 = 1.0f + alpha;
+
+        lanes.seed[l] = (0xC0FFEEu + 0x9E3779B9u * static_cast<uint32_t>(l + 1)) | 1u;
+        lanes.b0[l] = alpha / a0;
+        lanes.a1[l] = -2.0f * std::cos(w0) / a0;
+        lanes.a2[l] = (1.0f - alpha) / a0;
+        lanes.step[l] = 0.5f / 44100.0f;
+    }
+
+    // Блоками, как генератор качения: состояние переходит между вызовами
+    const size_t count = 44100;
+    const size_t block = 64;
+    noise_lanes_t simdLanes = lanes, scalarLanes = lanes;
+    std::vector<int16_t> simd(count), scalar(count);
+
+    for (size_t n = 0; n < count; n += block)
+    {
+        size_t len = std::min(block, count - n);
+
+        ASoundDSP::setSimdEnabled(true);
+        ASoundDSP::noiseLanes(simdLanes, simd.data() + n, len);
+
+        ASoundDSP::setSimdEnabled(false);
+        ASoundDSP::noiseLanes(scalarLanes, scalar.data() + n, len);
+    }
+
+    report("noiseLanes", simd == scalar);
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Ресемплер: совпадение веток с допуском
+//-----------------------------------------------------------------------------
+static void checkResample()
+{
+    const uint32_t rates[][2] = {{44100, 22050}, {22050, 48000}, {48000, 11025}};
+    const size_t frames = 20011;
+    uint32_t state = 0x5EEDu;
+
+    std::vector<float> src(frames);
+
+    for (size_t i = 0; i < frames; ++i)
+    {
+        float noise = static_cast<float>(static_cast<int32_t>(nextRandom(state))) / 2147483648.0f;
+        src[i] = 0.5f * std::sin(0.05f * i) + 0.25f * noise;
+    }
+
+    for (const uint32_t* pair : rates)
+    {
+        size_t dstFrames = ASoundDSP::resampledLength(frames, pair[0], pair[1]);
+        std::vector<float> simd(dstFrames), scalar(dstFrames);
+
+        ASoundDSP::setSimdEnabled(true);
+        ASoundDSP::resample(src.data(), frames, simd.data(), pair[0], pair[1]);
+
+        ASoundDSP::setSimdEnabled(false);
+        ASoundDSP::resample(src.data(), frames, scalar.data(), pair[0], pair[1]);
+
+        float worst = 0.0f;
+
+        for (size_t i = 0; i < dstFrames; ++i)
+            worst = std::max(worst, std::fabs(simd[i] - scalar[i]));
+
+        report("resample", worst <= CHECK_RESAMPLE_TOLERANCE,
+               std::to_string(pair[0]) + " -> " + std::to_string(pair[1]) +
+               " Hz, max diff " + std::to_string(worst));
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Сравнить уровни с допуском
+//-----------------------------------------------------------------------------
+static bool sameLevel(const sound_level_t &a, const sound_level_t &b)
+{
+    auto close = [](float x, float y) {
+        return std::fabs(x - y) <= CHECK_LEVEL_TOLERANCE * std::max(1.0f, std::fabs(x));
+    };
+
+    return a.peak == b.peak && close(a.rms, b.rms) && close(a.slope, b.slope) &&
+            std::fabs(a.loudness - b.loudness) <= CHECK_LOUDNESS_TOLERANCE;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Анализ уровней: совпадение веток с допуском
+//-----------------------------------------------------------------------------
+static void checkAnalyze()
+{
+    const uint32_t rate = 48000;
+    const int channels = 2;
+
+    // Три участка (начало, цикл, остановка), длины не кратны шагу
+    const size_t frames[3] = {12345, 5 * rate + 7, 3001};
+    const size_t total = frames[0] + frames[1] + frames[2];
+    uint32_t state = 0xA11CEu;
+
+    std::vector<int16_t> pcm(total * channels);
+
+    for (size_t i = 0; i < pcm.size(); ++i)
+    {
+        float tone = 8000.0f * std::sin(0.0131f * (i / channels));
+        pcm[i] = static_cast<int16_t>(tone + static_cast<int16_t>(nextRandom(state)) / 8);
+    }
+
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(pcm.data());
+    sound_level_t simd[3], scalar[3], simdTotal, scalarTotal;
+
+    ASoundDSP::setSimdEnabled(true);
+    ASoundDSP::analyze(src, 16, channels, rate, frames, 3, simd, &simdTotal);
+
+    ASoundDSP::setSimdEnabled(false);
+    ASoundDSP::analyze(src, 16, channels, rate, frames, 3, scalar, &scalarTotal);
+
+    bool ok = sameLevel(simdTotal, scalarTotal);
+
+    for (int r = 0; r < 3; ++r)
+        ok = ok && sameLevel(simd[r], scalar[r]);
+
+    report("analyze", ok, "loudness " + std::to_string(simdTotal.loudness) +
+           " / " + std::to_string(scalarTotal.loudness) + " LUFS");
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Дописать фрагмент Wave64 (GUID, 64-битный размер с "шапкой", выравнивание 8)
+//-----------------------------------------------------------------------------
+static void appendChunk64(QByteArray &file, const unsigned char guid[16], const QByteArray &body)
+{
+    uint64_t size = 24 + static_cast<uint64_t>(body.size());
+
+    file.append(reinterpret_cast<const char*>(guid), 16);
+    file.append(reinterpret_cast<const char*>(&size), 8);
+    file.append(body);
+
+    while (file.size() % 8 != 0)
+        file.append('\0');
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Wave64 с маркерами: данные читаются, потеря меток отмечается
+//-----------------------------------------------------------------------------
+static void checkWave64Markers()
+{
+    const unsigned char riff[16] = {'r', 'i', 'f', 'f', 0x2E, 0x91, 0xCF, 0x11,
+                                    0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00};
+    const unsigned char wave[16] = {'w', 'a', 'v', 'e', 0xF3, 0xAC, 0xD3, 0x11,
+                                    0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A};
+    const unsigned char marker[16] = {0x56, 0x62, 0xF7, 0xAB, 0x2D, 0x39, 0xD2, 0x11,
+                                      0x86, 0xC7, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A};
+
+    unsigned char fmtGuid[16], dataGuid[16];
+    memcpy(fmtGuid, wave, 16);
+    memcpy(fmtGuid, "fmt ", 4);
+    memcpy(dataGuid, wave, 16);
+    memcpy(dataGuid, "data", 4);
+
+    // PCM, моно, 8 кГц, 16 бит
+    QByteArray fmt;
+    const uint16_t format[8] = {1, 1, 8000, 0, 16000, 0, 2, 16};
+    fmt.append(reinterpret_cast<const char*>(format), sizeof(format));
+
+    const int frames = 8000;
+    QByteArray pcm(2 * frames, '\0');
+
+    // Один маркер; содержимое фрагмента читателю не важно
+    QByteArray markers(64, '\0');
+    markers[0] = 1;
+
+    QByteArray body;
+    appendChunk64(body, fmtGuid, fmt);
+    appendChunk64(body, marker, markers);
+    appendChunk64(body, dataGuid, pcm);
+
+    QByteArray file(reinterpret_cast<const char*>(riff), 16);
+    uint64_t total = 40 + static_cast<uint64_t>(body.size());
+    file.append(reinterpret_cast<const char*>(&total), 8);
+    file.append(reinterpret_cast<const char*>(wave), 16);
+    file.append(body);
+
+    QString name = QDir::temp().filePath("asound-check-markers.w64");
+    QFile out(name);
+
+    if (!out.open(QIODevice::WriteOnly) || out.write(file) != file.size())
+    {
+        report("wave64 markers", false, "can't write " + name.toStdString());
+        return;
+    }
+
+    out.close();
+
+    AWaveReader reader;
+    QSharedPointer<ASoundData> data = reader.read(name);
+
+    QFile::remove(name);
+
+    if (data.isNull())
+    {
+        report("wave64 markers", false, reader.getLastError().toStdString());
+        return;
+    }
+
+    report("wave64 markers",
+           data->dataSize == static_cast<uint64_t>(pcm.size()) &&
+           data->info.sampleRate == 8000 && data->markersDropped,
+           "data " + std::to_string(data->dataSize) + " bytes, markers " +
+           (data->markersDropped ? "reported" : "lost silently"));
+}
+
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    if (!ASoundDSP::isSimdEnabled())
+        std::cout << "SSE2 is not in this build - both runs use the scalar path" << std::endl;
+
+    checkDownmix();
+    checkHash();
+    checkNoise();
+    checkResample();
+    checkAnalyze();
+    checkWave64Markers();
+
+    ASoundDSP::setSimdEnabled(true);
+
+    return failures;
+}